@@ -84,6 +84,17 @@
     return self.privateRequestData;
 }
 
+- (id)highWaterMark {
+    return self.maxID;
+}
+
++ (NSDictionary *)requestData:(NSDictionary *)requestData forRecordsNewerThanHighWaterMark:(id)highWaterMark {
+    NSMutableDictionary *dict = [NSMutableDictionary dictionaryWithDictionary:requestData];
+    [dict setObject:highWaterMark forKey:@"since_id"];
+    
+    return dict;
+}
+
 - (NSInteger)totalResultsCount {    
     return 0;
 }
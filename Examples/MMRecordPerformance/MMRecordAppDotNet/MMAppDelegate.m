@@ -9,6 +9,7 @@
 #import "MMAppDelegate.h"
 
 #import "ADNRecord.h"
+#import "MMDecodingPerformanceTesting.h"
 #import "MMJSONPerformanceTestingServer.h"
 #import "MMJSONServer.h"
 
@@ -19,7 +20,25 @@
     [ADNRecord registerServerClass:[MMJSONPerformanceTestingServer class]];
     //[MMRecord setLoggingLevel:MMRecordLoggingLevelAll];
     
+    // Pass "-MMRunDecodingBenchmarks YES" as a launch argument to run the decoder checks.
+    if ([[NSUserDefaults standardUserDefaults] boolForKey:@"MMRunDecodingBenchmarks"]) {
+        [self runDecodingBenchmarks];
+    }
+    
     return YES;
 }
 
+// The benchmarks take several seconds, so they run on a background queue to keep launch responsive.
+- (void)runDecodingBenchmarks {
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0), ^{
+        if ([MMDecodingPerformanceTesting verifyBinaryDecoderRoundTrip] == NO) {
+            NSLog(@"Binary decoder round trip failed.");
+        }
+        
+        if ([MMDecodingPerformanceTesting compareJSONDecodingPerformanceWithResultSetSize:10000 iterations:10] == NO) {
+            NSLog(@"JSON decoder comparison failed.");
+        }
+    });
+}
+
 @end
@@ -0,0 +1,27 @@
+//
+//  MMDecodingPerformanceTesting.h
+//  MMRecordPerformance
+//
+//  Copyright (c) 2013 Mutual Mobile. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+// These checks are run by MMAppDelegate on a background queue when the app is launched with the
+// "-MMRunDecodingBenchmarks YES" argument.  Each one creates its own contexts, so they can be called
+// from any thread.
+@interface MMDecodingPerformanceTesting : NSObject
+
+// Decodes a post encoded as MessagePack and as CBOR, with its date and text sent as native timestamp
+// and binary values, populates a Post record from each one, saves it to an in-memory store and fetches
+// it back.  Returns YES if both posts come back with the values that were encoded.
++ (BOOL)verifyBinaryDecoderRoundTrip;
+
+// Builds a response of resultSetSize posts from posts.json, the same way that the performance testing
+// server does, and decodes it the given number of times with NSJSONSerialization and with
+// MMSIMDJSONDecoder.  Logs the average time each decoder takes.  Returns YES if the SIMD decoder
+// produces the same objects as NSJSONSerialization, both for the response and for the response with a
+// UTF-8 byte order mark in front of it.
++ (BOOL)compareJSONDecodingPerformanceWithResultSetSize:(NSUInteger)resultSetSize iterations:(NSUInteger)iterations;
+
+@end
@@ -0,0 +1,178 @@
+//
+//  MMDecodingPerformanceTesting.m
+//  MMRecordPerformance
+//
+//  Copyright (c) 2013 Mutual Mobile. All rights reserved.
+//
+
+#import "MMDecodingPerformanceTesting.h"
+
+#import "MMCBORDecoder.h"
+#import "MMMessagePackDecoder.h"
+#import "MMRecord.h"
+#import "MMRecordMarshaler.h"
+#import "MMSIMDJSONDecoder.h"
+#import "Post.h"
+
+// {"id": "1", "text": bin("hello"), "created_at": timestamp32(2013-06-13T00:00:00Z)}
+static const uint8_t MMMessagePackPost[] = {
+    0x83, 0xa2, 0x69, 0x64, 0xa1, 0x31, 0xa4, 0x74, 0x65, 0x78, 0x74, 0xc4, 0x05, 0x68, 0x65, 0x6c,
+    0x6c, 0x6f, 0xaa, 0x63, 0x72, 0x65, 0x61, 0x74, 0x65, 0x64, 0x5f, 0x61, 0x74, 0xd6, 0xff, 0x51,
+    0xb9, 0x0b, 0x80
+};
+
+// {"id": "1", "text": h'68656c6c6f', "created_at": 1(1371081600)}
+static const uint8_t MMCBORPost[] = {
+    0xa3, 0x62, 0x69, 0x64, 0x61, 0x31, 0x64, 0x74, 0x65, 0x78, 0x74, 0x45, 0x68, 0x65, 0x6c, 0x6c,
+    0x6f, 0x6a, 0x63, 0x72, 0x65, 0x61, 0x74, 0x65, 0x64, 0x5f, 0x61, 0x74, 0xc1, 0x1a, 0x51, 0xb9,
+    0x0b, 0x80
+};
+
+static const NSTimeInterval MMEncodedPostDate = 1371081600;
+
+@implementation MMDecodingPerformanceTesting
+
++ (BOOL)verifyBinaryDecoderRoundTrip {
+    NSData *messagePackData = [NSData dataWithBytes:MMMessagePackPost length:sizeof(MMMessagePackPost)];
+    NSData *CBORData = [NSData dataWithBytes:MMCBORPost length:sizeof(MMCBORPost)];
+    
+    BOOL verified = YES;
+    verified = [self verifyRoundTripForDecoder:[MMMessagePackDecoder class] data:messagePackData] && verified;
+    verified = [self verifyRoundTripForDecoder:[MMCBORDecoder class] data:CBORData] && verified;
+    
+    return verified;
+}
+
++ (BOOL)verifyRoundTripForDecoder:(Class<MMServerResponseDecoder>)decoderClass data:(NSData *)data {
+    NSError *error = nil;
+    NSDictionary *dictionary = [decoderClass responseObjectWithData:data error:&error];
+    
+    if (dictionary == nil) {
+        NSLog(@"%@ failed to decode the post. %@", NSStringFromClass(decoderClass), error);
+        return NO;
+    }
+    
+    NSManagedObjectContext *context = [self inMemoryContext];
+    NSEntityDescription *entity = [NSEntityDescription entityForName:@"Post" inManagedObjectContext:context];
+    Post *post = [[Post alloc] initWithEntity:entity insertIntoManagedObjectContext:context];
+    
+    for (NSAttributeDescription *attribute in [[entity attributesByName] allValues]) {
+        NSString *key = [[attribute userInfo] objectForKey:MMRecordAttributeAlternateNameKey] ?: [attribute name];
+        
+        [MMRecordMarshaler setValue:[dictionary valueForKeyPath:key]
+                           onRecord:post
+                          attribute:attribute
+                      dateFormatter:nil];
+    }
+    
+    if ([context save:&error] == NO) {
+        NSLog(@"%@ post could not be saved. %@", NSStringFromClass(decoderClass), error);
+        return NO;
+    }
+    
+    [context reset];
+    
+    NSFetchRequest *fetchRequest = [NSFetchRequest fetchRequestWithEntityName:@"Post"];
+    Post *fetchedPost = [[context executeFetchRequest:fetchRequest error:NULL] lastObject];
+    
+    BOOL verified = ([fetchedPost.id isEqualToString:@"1"] &&
+                     [fetchedPost.text isEqualToString:@"hello"] &&
+                     [fetchedPost.date isEqualToDate:[NSDate dateWithTimeIntervalSince1970:MMEncodedPostDate]]);
+    
+    if (verified == NO) {
+        NSLog(@"%@ post did not round trip. id: %@, text: %@, date: %@",
+              NSStringFromClass(decoderClass), fetchedPost.id, fetchedPost.text, fetchedPost.date);
+    }
+    
+    return verified;
+}
+
++ (BOOL)compareJSONDecodingPerformanceWithResultSetSize:(NSUInteger)resultSetSize iterations:(NSUInteger)iterations {
+    NSData *data = [self postsDataWithResultSetSize:resultSetSize];
+    
+    if (data == nil) {
+        NSLog(@"The posts resource could not be loaded.");
+        return NO;
+    }
+    
+    id foundationObject = [NSJSONSerialization JSONObjectWithData:data options:0 error:NULL];
+    id SIMDObject = [MMSIMDJSONDecoder responseObjectWithData:data error:NULL];
+    
+    NSMutableData *byteOrderMarkData = [NSMutableData dataWithBytes:"\xEF\xBB\xBF" length:3];
+    [byteOrderMarkData appendData:data];
+    
+    id byteOrderMarkObject = [MMSIMDJSONDecoder responseObjectWithData:byteOrderMarkData error:NULL];
+    
+    BOOL verified = ([SIMDObject isEqual:foundationObject] && [byteOrderMarkObject isEqual:foundationObject]);
+    
+    if (verified == NO) {
+        NSLog(@"MMSIMDJSONDecoder did not produce the same posts as NSJSONSerialization.");
+    }
+    
+    CFAbsoluteTime foundationTime = 0;
+    CFAbsoluteTime SIMDTime = 0;
+    
+    for (NSUInteger iteration = 0; iteration < iterations; iteration++) {
+        @autoreleasepool {
+            CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+            [NSJSONSerialization JSONObjectWithData:data options:0 error:NULL];
+            foundationTime += CFAbsoluteTimeGetCurrent() - startTime;
+        }
+        
+        @autoreleasepool {
+            CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+            [MMSIMDJSONDecoder responseObjectWithData:data error:NULL];
+            SIMDTime += CFAbsoluteTimeGetCurrent() - startTime;
+        }
+    }
+    
+    if (iterations > 0) {
+        NSLog(@"Decoded %lu posts (%lu bytes). NSJSONSerialization: %.2f ms, MMSIMDJSONDecoder: %.2f ms",
+              (unsigned long)resultSetSize,
+              (unsigned long)[data length],
+              foundationTime * 1000.0 / iterations,
+              SIMDTime * 1000.0 / iterations);
+    }
+    
+    return verified;
+}
+
++ (NSData *)postsDataWithResultSetSize:(NSUInteger)resultSetSize {
+    NSString *path = [[NSBundle mainBundle] pathForResource:@"posts" ofType:@"json"];
+    NSData *resourceData = [NSData dataWithContentsOfFile:path];
+    
+    if (resourceData == nil) {
+        return nil;
+    }
+    
+    NSDictionary *responseData = [NSJSONSerialization JSONObjectWithData:resourceData options:0 error:NULL];
+    NSArray *data = [responseData valueForKey:@"data"];
+    
+    if ([data count] == 0) {
+        return nil;
+    }
+    
+    NSDictionary *firstObject = [data objectAtIndex:0];
+    NSMutableArray *newDataArray = [NSMutableArray arrayWithCapacity:resultSetSize];
+    
+    for (NSUInteger item = 0; item < resultSetSize; ++item) {
+        NSMutableDictionary *dict = [firstObject mutableCopy];
+        [dict setValue:[@(item) stringValue] forKey:@"id"];
+        [newDataArray addObject:dict];
+    }
+    
+    return [NSJSONSerialization dataWithJSONObject:@{@"data" : newDataArray} options:0 error:NULL];
+}
+
++ (NSManagedObjectContext *)inMemoryContext {
+    NSManagedObjectModel *model = [NSManagedObjectModel mergedModelFromBundles:nil];
+    NSPersistentStoreCoordinator *coordinator = [[NSPersistentStoreCoordinator alloc] initWithManagedObjectModel:model];
+    [coordinator addPersistentStoreWithType:NSInMemoryStoreType configuration:nil URL:nil options:nil error:NULL];
+    
+    NSManagedObjectContext *context = [[NSManagedObjectContext alloc] init];
+    context.persistentStoreCoordinator = coordinator;
+    
+    return context;
+}
+
+@end
@@ -31,6 +31,9 @@
  
  MMRecordAttributeAlternateNameKey  
  MMRecordEntityPrimaryAttributeKey
+ MMRecordRelationshipReplacesExistingRecordsKey
+ MMRecordRelationshipLinksWithoutFaultingKey
+ MMRecordEntityPrefetchesRelationshipsKey
  
  MMRecordAttributeAlternateNameKey is used to specify an alernate name for an attribute.  It should 
  be used if the name of an attribute's dictionary key changes, or if the user wants the attribute 
@@ -43,10 +46,36 @@
  MMRecordEntityPrimaryAttributeKey is used to designate the name of the primary attribute for an 
  entity.  It should be set on an Entity's user info dictionary.  In the latest version of MMRecord 
  this can be set to a relationship.  More information on that is available below.
+ 
+ MMRecordRelationshipReplacesExistingRecordsKey is used to replace the contents of a to-many 
+ relationship with the records in a response, instead of adding them to the records it already 
+ contains.  It should be set to YES on a Relationship's user info dictionary.
+ 
+ MMRecordRelationshipLinksWithoutFaultingKey is used to keep a large to-many relationship, such as 
+ a user's posts, from being faulted in when records from a response are linked to it.  It should be
+ set to YES on the user info dictionary of a to-many relationship that has a to-one inverse.  While
+ the to-many relationship is a fault, records are linked by setting only the to-one side, and the 
+ store derives the to-many side when the context is saved.  Because only the to-one side changes, 
+ the record that owns the to-many relationship is not included in the updated objects of the save 
+ notification.  MMRecord refreshes those records in the main context it imports into after each 
+ save, but other contexts that have already loaded the to-many relationship do not see the new 
+ records until they refresh the record that owns it with refreshObject:mergeChanges:.
+ 
+ MMRecordEntityPrefetchesRelationshipsKey is used to control whether the relationships that a 
+ response links are prefetched along with the existing records of an entity.  It should be set on an
+ Entity's user info dictionary.  By default existing records are fetched fully populated, together 
+ with the to-one relationships in the response that they will be linked through, so that updating 
+ them does not fire a fault for each record and relationship.  To-many relationships can hold any 
+ number of records, so they are only prefetched if this key is set to YES.  Set it to NO for an 
+ entity whose relationships should not be prefetched at all.  Relationships that use 
+ MMRecordRelationshipLinksWithoutFaultingKey are never prefetched.
  */
 
 extern NSString * const MMRecordEntityPrimaryAttributeKey;
 extern NSString * const MMRecordAttributeAlternateNameKey;
+extern NSString * const MMRecordRelationshipReplacesExistingRecordsKey;
+extern NSString * const MMRecordRelationshipLinksWithoutFaultingKey;
+extern NSString * const MMRecordEntityPrefetchesRelationshipsKey;
 
 @class MMRecordOptions, MMServer, MMServerPageManager;
 
@@ -62,6 +91,32 @@ typedef NS_ENUM(NSInteger, MMRecordLoggingLevel) {
     MMRecordLoggingLevelAll = 999
 };
 
+/**
+ Describes where the records passed to a result block were obtained from.  Records are either the 
+ product of parsing a response from the server, or they were returned from MMRecord's record level 
+ cache without waiting for the server.
+ */
+
+typedef NS_ENUM(NSInteger, MMRecordResponseSource) {
+    MMRecordResponseSourceNetwork = 0,
+    MMRecordResponseSourceCache = 1
+};
+
+/**
+ Describes the priority of a request.  The priority is passed to the server so that it can order 
+ the network requests it sends, and it also decides the order in which MMRecord imports responses.
+ User initiated requests are imported before default requests, which are imported before background
+ requests.  Background imports are performed in chunks and will pause between chunks to allow 
+ higher priority imports to run first.  The chunks imported before a pause are saved first, so a 
+ cancelled background import only rolls back the chunks it had not yet saved.
+ */
+
+typedef NS_ENUM(NSInteger, MMRecordRequestPriority) {
+    MMRecordRequestPriorityBackground = -1,
+    MMRecordRequestPriorityDefault = 0,
+    MMRecordRequestPriorityUserInitiated = 1
+};
+
 /**
  `MMRecord` provides a pattern for interfacing with a server to retrieve records.  A record is 
  an object that lives on a server.  MMRecord depends on the interface from MMServer for making 
@@ -208,7 +263,13 @@ typedef NS_ENUM(NSInteger, MMRecordLoggingLevel) {
  USED!  The methods required to support caching are listed below in the optional subclass methods.  
  The primary one is +isRecordLevelCachingEnabled, which should return YES if caching is desired.  
  In addition, the optional method +requestWithURN:data: on MMServer must be implemented as a 
- NSURLRequest object is required for accessing information in NSURLCache.
+ NSURLRequest object is required for accessing information in NSURLCache.  By default a cache hit 
+ will skip the server request entirely.  If you would rather display cached results immediately and 
+ still refresh them from the server, use the revalidatesCachedResults option or the 
+ -startRevalidatingRequestWithURN: method described below.  When the server returns ETag or 
+ Last-Modified headers, MMRecord stores them with the cached records and sends them with the next 
+ request through MMServer's startConditionalRequestWithURN: method.  If the server responds with 
+ 304 Not Modified the cached records are returned without downloading or parsing the response again.
  
  ## Queues
  
@@ -261,6 +322,18 @@ typedef NS_ENUM(NSInteger, MMRecordLoggingLevel) {
  */
 + (Class)representationClass;
 
+/**
+ This method returns key paths in a record's dictionary that should be decoded when the 
+ decodesOnlyMappedKeyPaths option is enabled, even though they are not mapped by the record's 
+ representation.  Return the keys that are read by +shouldUseSubEntityRecordClassToRepresentData: 
+ or by a custom marshaler here.  The key paths are also requested from servers that support sparse 
+ fieldsets.
+ 
+ @return An array of key paths relative to a record's dictionary.
+ @discussion The default implementation returns nil.
+ */
++ (NSArray *)additionalKeyPathsForResponseSchema;
+
 /**
  This method is used by the -startDetailRequestWithDomain: method to locate and obtain the resource 
  data for a specific record.  This URN should be everything after the base URL that is necesary to 
@@ -304,6 +377,26 @@ typedef NS_ENUM(NSInteger, MMRecordLoggingLevel) {
  */
 + (NSString *)keyPathForMetaData;
 
+/**
+ This method indicates whether requests for this record class are full refreshes by default.  If it
+ returns YES then records of this entity that are not in a response are deleted when the response 
+ is imported.  See the deletesOrphanedRecords option for more information.
+ */
++ (BOOL)deletesOrphanedRecords;
+
+/**
+ This method indicates whether responses for this record class only need to be decoded as far as 
+ the key paths mapped by its representation.  See the decodesOnlyMappedKeyPaths option for more 
+ information.
+ */
++ (BOOL)decodesOnlyMappedKeyPaths;
+
+/**
+ This method returns the number of levels of nested relationships that are imported from responses 
+ for this record class.  See the maximumRelationshipDepth option for more information.
+ */
++ (NSUInteger)maximumRelationshipDepth;
+
 
 ///-----------------------------------------------
 /// @name Setting and Accessing the MMServer Class
@@ -351,12 +444,44 @@ typedef NS_ENUM(NSInteger, MMRecordLoggingLevel) {
  */
 + (MMRecordLoggingLevel)loggingLevel;
 
+/**
+ Enables or disables tracing.  While tracing is enabled, the beginning and end of each request, 
+ import and import phase, along with errors, are recorded as binary events in a fixed size ring 
+ buffer that keeps the most recent 4096 events.  Each event holds a timestamp, the request it belongs
+ to, an entity name and a count, such as the number of records in the phase.  Recording an event 
+ takes no locks and does no string formatting.  Tracing is disabled by default.
+ 
+ @param tracingEnabled YES to record trace events, NO to stop recording them.
+ @discussion Tracing is compiled out if MMRecordTracing is defined as 0, in which case no events are 
+ ever recorded.
+ */
++ (void)setTracingEnabled:(BOOL)tracingEnabled;
+
+/**
+ Indicates whether trace events are being recorded.
+ */
++ (BOOL)isTracingEnabled;
+
+/**
+ Writes the trace events in the ring buffer to a file, oldest first, as tab separated lines.  The 
+ events are only formatted when they are written.
+ 
+ @param path The path of the file to write.  An existing file is replaced.
+ @param error If the file cannot be written, upon return contains an error describing the problem.
+ @return YES if the file was written, NO otherwise.
+ */
++ (BOOL)writeTraceToFile:(NSString *)path error:(NSError **)error;
+
 ///--------------------------------------------
 /// @name Starting and Stopping Server Requests
 ///--------------------------------------------
 
 /**
- Calls the registered server class's cancel requests method.
+ Calls the registered server class's cancel requests method.  Requests for the domain whose 
+ responses have already been received are cancelled as well.  Their imports stop at the next phase 
+ or chunk boundary and roll back their unsaved changes instead of saving them.  A background import
+ that paused for a higher priority import has already saved the chunks before the pause.  The failure block of a 
+ cancelled request is called with an MMRecordErrorCodeRequestCancelled error.
  
  @param domain The domain value for which requests should be cancelled.
  */
@@ -492,6 +617,8 @@ typedef NS_ENUM(NSInteger, MMRecordLoggingLevel) {
  reference to a boolean for requestNextPage.  This is defaulted to NO.  If the block changes this 
  parameter to YES then a subsequent request will be started to retrieve the next page.  
  The subsequent request will use the original result and failure blocks to handle it's response.
+ If the pagePrefetchCount option is set then the next pages may already have been requested by the 
+ time the block is called.
  @param failureBlock A block object to be executed when the request finishes unsuccessfully.  
  The block contains an error object that describes a request failure or a record parsing failure.
  */
@@ -502,6 +629,119 @@ typedef NS_ENUM(NSInteger, MMRecordLoggingLevel) {
                      resultBlock:(void(^)(NSArray *records, id pageManager, BOOL *requestNextPage))resultBlock   // Default is NO
                     failureBlock:(void(^)(NSError *error))failureBlock;
 
+/**
+ Starts a paged request whose remaining pages are requested concurrently.  This is intended for 
+ offset based APIs where every page can be requested as soon as the total number of results is 
+ known.  Once the first page has arrived its page manager is asked for the URN and data of every 
+ other page, using -URNForPageAtIndex: and -dataForPageAtIndex:, and those pages are requested 
+ with up to maximumConcurrentPageRequests requests in flight at once.  Each page is imported as soon
+ as it arrives.  If the page manager does not support requesting pages by index then each page is 
+ requested as soon as the page before it arrives, which still allows the network and the import to
+ overlap.
+ 
+ @param URN The URN for the first page of the request.
+ @param parameters A dictionary containing request parameters for the first page.
+ @param context The managed object context that will be used for creating the records that are 
+ returned in the response.
+ @param domain The domain that this request should be associated with.  Cancelling requests for 
+ this domain cancels every page of the request.
+ @param pageResultBlock A block object to be executed each time a page has been imported.  It is 
+ called with the records and page manager for that page.  Pages are passed to this block in the 
+ order they finish importing, which may not be page order.
+ @param completionBlock A block object to be executed once every page has been imported.  It is 
+ called with the records from every page, in page order.
+ @param failureBlock A block object to be executed if any page fails.  It is called at most once, 
+ and neither the page result block nor the completion block will be called after it.
+ @warning The request must be for the first page of the results.
+ */
++ (void)startConcurrentPagedRequestWithURN:(NSString *)URN
+                                      data:(NSDictionary *)parameters
+                                   context:(NSManagedObjectContext *)context
+                                    domain:(id)domain
+                           pageResultBlock:(void(^)(NSArray *records, id pageManager))pageResultBlock
+                           completionBlock:(void(^)(NSArray *records))completionBlock
+                              failureBlock:(void(^)(NSError *error))failureBlock;
+
+/**
+ Starts a paged request that can be resumed if it is interrupted.  After each page has been 
+ imported a checkpoint is persisted in the MMRecord cache store.  The checkpoint holds the next 
+ page URN and data, as well as the page manager's checkpointCursor.  If a checkpoint exists for 
+ the given sync identifier when this method is called, the sync resumes from that checkpoint 
+ instead of requesting the given URN, and the cursor is passed to the first page manager's 
+ restoreCheckpointCursor: method.  The checkpoint is deleted once a page is received that has no 
+ next page.  If the result block stops the sync by leaving requestNextPage set to NO before then, 
+ the checkpoint is kept so that the next call resumes where this one left off.
+ 
+ @param syncIdentifier A string that identifies the sync for this record class, such as the name of
+ the timeline being synced.
+ @param URN The URN for the first page of the sync.
+ @param parameters A dictionary containing request parameters for the first page of the sync.
+ @param context The managed object context that will be used for creating the records that are 
+ returned in the response.
+ @param domain The domain that this request should be associated with.
+ @param resultBlock A block object to be executed after each page has been imported.  See 
+ +startPagedRequestWithURN: for more information.
+ @param failureBlock A block object to be executed when the request finishes unsuccessfully.  
+ The checkpoint for the last page that was imported successfully is kept.
+ */
++ (void)startResumableSyncWithIdentifier:(NSString *)syncIdentifier
+                                     URN:(NSString *)URN
+                                    data:(NSDictionary *)parameters
+                                 context:(NSManagedObjectContext *)context
+                                  domain:(id)domain
+                             resultBlock:(void(^)(NSArray *records, id pageManager, BOOL *requestNextPage))resultBlock
+                            failureBlock:(void(^)(NSError *error))failureBlock;
+
+/**
+ Deletes the checkpoint for a resumable sync, so that the next call to 
+ +startResumableSyncWithIdentifier: starts over from its first page.
+ 
+ @param syncIdentifier The identifier of the sync.
+ */
++ (void)resetResumableSyncWithIdentifier:(NSString *)syncIdentifier;
+
+/**
+ Starts a delta sync for a paged resource whose pages are returned newest first, such as a timeline.
+ The high water mark of the newest record from the last successful delta sync for this URN is passed
+ to the page manager class's +requestData:forRecordsNewerThanHighWaterMark: method so that only newer
+ records are requested.  Older pages are then requested one after another to fill the gap since the
+ last sync, stopping at the first page that contains no records that were not already in the store,
+ or when there are no more pages.  Only then is the high water mark of the first page stored.
+ 
+ While a delta sync is paging through the gap, the new high water mark is stored as pending and the 
+ previous one is kept.  If the sync fails partway through, the next delta sync requests records 
+ newer than the previous high water mark again, and pages until there are no more pages rather than
+ stopping at records that the failed sync already imported, so that the whole gap is filled.
+ 
+ @param URN The URN for the resource being synced.  High water marks are stored per URN.
+ @param parameters A dictionary containing request parameters for the newest page of the resource.
+ @param context The managed object context that will be used for creating the records that are 
+ returned in the response.
+ @param domain The domain that this request should be associated with.
+ @param pageResultBlock A block object to be executed after each page has been imported.  It is 
+ called with the records and page manager for that page.
+ @param completionBlock A block object to be executed once the gap since the last delta sync has 
+ been filled.
+ @param failureBlock A block object to be executed when the request finishes unsuccessfully.
+ @warning The page manager class must implement -highWaterMark and 
+ +requestData:forRecordsNewerThanHighWaterMark: for only new records to be requested.
+ */
++ (void)startDeltaSyncWithURN:(NSString *)URN
+                         data:(NSDictionary *)parameters
+                      context:(NSManagedObjectContext *)context
+                       domain:(id)domain
+              pageResultBlock:(void(^)(NSArray *records, id pageManager))pageResultBlock
+              completionBlock:(void(^)(void))completionBlock
+                 failureBlock:(void(^)(NSError *error))failureBlock;
+
+/**
+ Deletes the stored high water mark for a delta sync, so that the next call to 
+ +startDeltaSyncWithURN: requests the resource from its newest page without a high water mark.
+ 
+ @param URN The URN for the resource being synced.
+ */
++ (void)resetDeltaSyncWithURN:(NSString *)URN;
+
 @end
 
 
@@ -554,6 +794,46 @@ typedef NS_ENUM(NSInteger, MMRecordLoggingLevel) {
 @end
 
 
+/**
+ This category adds support for stale-while-revalidate requests.  It is meant for screens that 
+ should display whatever records were cached for a request right away, and then converge on the 
+ latest data from the server without the caller needing to start a second request.
+ */
+
+@interface MMRecord (MMRecordCacheRevalidation)
+
+/**
+ Starts a request which returns cached results immediately, if there are any, and then revalidates 
+ them with the server.  This method behaves as though the revalidatesCachedResults option were set 
+ to YES for this request.  Record level caching must be enabled for the record class, or through 
+ the request options, for cached results to be returned.
+ 
+ @param URN The base URN for the request endpoint.
+ @param parameters A dictionary containing request parameters.
+ @param context The managed object context that will be used for creating the records that are 
+ returned in the response.
+ @param domain The domain that this request should be associated with.
+ @param customResponseBlock This block allows the user raw access to the parsed response from the 
+ request.  For cached results this block is called with the cached response object, which may only 
+ contain the metadata for the request if keyPathForMetaData is being used.
+ @param resultBlock A block object to be executed when records are available.  It is called once 
+ with the cached records, if there are any, and again with the refreshed records once the response 
+ has been parsed.  The second call only occurs if the refreshed records differ from the cached 
+ records.  The responseSource parameter tells you which of the two calls you are receiving.
+ @param failureBlock A block object to be executed when the request finishes unsuccessfully.  
+ The block contains an error object that describes a request failure or a record parsing failure.
+ */
++ (void)startRevalidatingRequestWithURN:(NSString *)URN
+                                   data:(NSDictionary *)parameters
+                                context:(NSManagedObjectContext *)context
+                                 domain:(id)domain
+                    customResponseBlock:(id (^)(id JSON))customResponseBlock
+                            resultBlock:(void(^)(NSArray *records, id customResponseObject, MMRecordResponseSource responseSource))resultBlock
+                           failureBlock:(void(^)(NSError *error))failureBlock;
+
+@end
+
+
 /**
  This class represents various user settable options that MMRecord will use when starting requests.
  */
@@ -613,6 +893,56 @@ typedef NS_ENUM(NSInteger, MMRecordLoggingLevel) {
  */
 @property (nonatomic, copy) NSString *keyPathForMetaData;
 
+/**
+ This option enables a stale-while-revalidate mode for the record level cache.  If cached results 
+ exist for a request they will be passed to the result block immediately, and the request will 
+ still be sent to the server.  Once the response has been parsed the result block will be called 
+ again with the refreshed records, but only if they differ from the cached records.  This option 
+ has no effect unless isRecordLevelCachingEnabled is also YES.
+ 
+ @discussion Default value is NO.
+ @warning The result block may be called twice for a single request when this option is enabled.
+ */
+@property (nonatomic, assign) BOOL revalidatesCachedResults;
+
+/**
+ This option enables response fingerprinting for the record level cache.  A fingerprint of the 
+ parsed response, or of the sub-tree at keyPathForResponseObject if one is specified, is stored with
+ the cached records.  If a later response has the same fingerprint and all of the cached records 
+ still exist, the import is skipped and the cached records are returned instead.  This is useful 
+ for endpoints that are polled frequently and usually return the same payload, but which do not 
+ support the ETag or Last-Modified headers.  This option has no effect unless 
+ isRecordLevelCachingEnabled is also YES.
+ 
+ @discussion Default value is NO.
+ @warning Records that were modified locally since the last import will not be overwritten with the 
+ server's values when the fingerprint matches.
+ */
+@property (nonatomic, assign) BOOL fingerprintsResponses;
+
+/**
+ This option enables coalescing of identical in flight requests.  If a request is started while an 
+ identical request for the same record class and persistent store coordinator is still in flight, 
+ the new request will not be sent to the server.  Instead it will be completed with the results of
+ the request that is already in flight, on its own callback queue and with its own custom response 
+ block.  Requests are identical if the URN and parameters produce the same request URL, which means
+ that the registered server class must implement +requestWithURN:data:.
+ 
+ @discussion Default value is NO.
+ @warning Both requests must enable this option for them to be coalesced.
+ */
+@property (nonatomic, assign) BOOL coalescesInFlightRequests;
+
+/**
+ This option specifies the priority of the request.  Requests with a higher priority are sent and 
+ imported ahead of requests with a lower priority that are still waiting.  Use the background 
+ priority for large prefetches that the user is not waiting on, so that they do not hold up the 
+ requests for the screen the user is looking at.
+ 
+ @discussion Default value is MMRecordRequestPriorityDefault.
+ */
+@property (nonatomic, assign) MMRecordRequestPriority requestPriority;
+
 /**
  This option allows you to specify a page manager that will be used for the next request if it is
  paginated. This gives you the flexibility to use a different page manager class than is specified
@@ -623,6 +953,86 @@ typedef NS_ENUM(NSInteger, MMRecordLoggingLevel) {
  */
 @property (nonatomic, strong) Class pageManagerClass;
 
+/**
+ This option specifies how many pages of a paged request may be requested ahead of the page that is
+ being imported.  When it is greater than zero the page manager for each page is created as soon as
+ its response arrives, and the request for the next page is started right away rather than after 
+ the page has been imported and delivered.  Pages are still imported and passed to the result block
+ in order, and a page is only imported once the result block for the page before it has set 
+ requestNextPage to YES.  If it does not, any pages that were prefetched are discarded.  This allows
+ a long sequence of pages to be synced in roughly the time taken by the slower of the network and 
+ the import, rather than the sum of both.
+ 
+ @discussion Default value is 0, which disables prefetching.
+ @warning The page manager must be able to compute nextPageURN and nextPageData from the response 
+ object alone.  Every page of a prefetching request uses the options that were set for the first.
+ */
+@property (nonatomic, assign) NSUInteger pagePrefetchCount;
+
+/**
+ This option specifies how many page requests may be in flight at once for a concurrent paged 
+ request.  See +startConcurrentPagedRequestWithURN: for more information.
+ 
+ @discussion Default value is 4.
+ */
+@property (nonatomic, assign) NSUInteger maximumConcurrentPageRequests;
+
+/**
+ This option indicates that the response is a full refresh of the records in the request's scope.  
+ When the response is imported, every stored record of the request's entity, or its sub entities, 
+ whose primary key was not in the response and which matches the orphanDeletionScopePredicate is 
+ deleted.  The deletions are made in the same background context as the import and saved along 
+ with it, so the main context sees the new records and the deletions at the same time.
+ 
+ @discussion Default value is whatever is returned by +deletesOrphanedRecords on the MMRecord 
+ subclass.
+ @warning Without a scope predicate every record of the entity that is not in the response is 
+ deleted.  This option is ignored by paged requests, including concurrent, resumable and delta sync
+ requests, since each page is only a part of the records in scope.
+ */
+@property (nonatomic, assign) BOOL deletesOrphanedRecords;
+
+/**
+ This option specifies a predicate that limits orphan deletion to the records that the request is 
+ responsible for, such as the posts for one user.  It has no effect unless deletesOrphanedRecords 
+ is also YES.
+ 
+ @discussion Default value is nil.
+ */
+@property (nonatomic, strong) NSPredicate *orphanDeletionScopePredicate;
+
+/**
+ This option indicates that the values in a response which are not mapped by the record's 
+ representation should not be decoded.  MMRecord builds a schema from the key paths that the 
+ representations of the entity, its sub entities and the destinations of its relationships map, 
+ including alternate names, and passes it to the server.  Decoders that support a schema skip over 
+ every other value in the records without creating objects for them, which reduces the allocations 
+ and peak memory needed for responses with many unmapped fields.  Values outside of the 
+ keyPathForResponseObject are always decoded, so page managers and custom response blocks can still
+ read them.  Servers for APIs that support sparse fieldsets also use the schema to ask for 
+ only the mapped fields.  See +fieldsetParameterName on MMServer.
+ 
+ @discussion Default value is whatever is returned by +decodesOnlyMappedKeyPaths on the MMRecord 
+ subclass.
+ @warning Only the mapped values, and the key paths returned by +additionalKeyPathsForResponseSchema,
+ are available to a marshaler, to +shouldUseSubEntityRecordClassToRepresentData:, and to a custom 
+ response block that reads the records.  Entities whose representation reads unmapped values, such 
+ as MMRecordDynamicRepresentation, are always decoded in full.
+ */
+@property (nonatomic, assign) BOOL decodesOnlyMappedKeyPaths;
+
+/**
+ This option limits how deeply nested relationships in a response are imported.  The records in a 
+ response are imported breadth first, one level of nested relationships at a time, so reply threads,
+ org charts and comment trees of any depth are imported without deep recursion.  Records nested more 
+ than this many levels below the records in the response are imported, but their own relationships 
+ are not, and a warning is logged.
+ 
+ @discussion Default value is whatever is returned by +maximumRelationshipDepth on the MMRecord 
+ subclass, which is 512 unless the subclass overrides it.
+ */
+@property (nonatomic, assign) NSUInteger maximumRelationshipDepth;
+
 @end
 
 
@@ -28,6 +28,9 @@
 #import "MMRecordResponse.h"
 #import "MMServer.h"
 
+#import <mach/mach_time.h>
+#import <stdatomic.h>
+
 /*
  * Does ARC support support GCD objects?
  * It does if the minimum deployment target is iOS 6+ or Mac OS X 8+
@@ -66,9 +69,88 @@ static MMRecordLoggingLevel _mmrecord_logging_level = 0;
 static NSMutableDictionary* MM_registeredServerClasses;
 static MMRecordOptions* MM_recordOptions;
 static MMRecordErrorHandler* MM_errorHandler;
+static NSMutableDictionary* MM_inFlightRequestStates;
+static NSMutableArray* MM_pendingImportTasks;
+static NSMutableDictionary* MM_responseSchemas;
+
+static const NSUInteger MM_backgroundImportChunkSize = 500;
+
+static NSString * const MMRecordCheckpointURNKey = @"URN";
+static NSString * const MMRecordCheckpointDataKey = @"data";
+static NSString * const MMRecordCheckpointCursorKey = @"cursor";
+static NSString * const MMRecordCheckpointHighWaterMarkKey = @"highWaterMark";
+static NSString * const MMRecordCheckpointPendingHighWaterMarkKey = @"pendingHighWaterMark";
 
 NSString * const MMRecordEntityPrimaryAttributeKey = @"MMRecordEntityPrimaryAttributeKey";
 NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternateNameKey";
+NSString * const MMRecordRelationshipReplacesExistingRecordsKey = @"MMRecordRelationshipReplacesExistingRecordsKey";
+NSString * const MMRecordRelationshipLinksWithoutFaultingKey = @"MMRecordRelationshipLinksWithoutFaultingKey";
+NSString * const MMRecordEntityPrefetchesRelationshipsKey = @"MMRecordEntityPrefetchesRelationshipsKey";
+NSString * const MMRecordContextRecordsLinkedWithoutFaultingKey = @"MMRecordContextRecordsLinkedWithoutFaultingKey";
+
+// The number of events kept by the trace ring buffer, and the longest entity name recorded for each.
+#define MM_traceCapacity 4096
+#define MM_traceEntityNameLength 48
+
+// An event in the trace ring buffer.  The sequence is the index of the event plus one once the event
+// has been completely written, and zero while it is being written, so that a reader can tell when it
+// has copied a slot that was being overwritten.
+typedef struct {
+    _Atomic(uint64_t) sequence;
+    uint64_t timestamp;
+    uint64_t count;
+    uint32_t requestIdentifier;
+    MMRecordTraceEventKind kind;
+    MMRecordTracePhase phase;
+    char entityName[MM_traceEntityNameLength];
+} MMRecordTraceSlot;
+
+static _Atomic(uint32_t) MM_lastTraceRequestIdentifier;
+
+#if MMRecordTracing
+
+static MMRecordTraceSlot MM_traceBuffer[MM_traceCapacity];
+static _Atomic(uint64_t) MM_traceHead;
+static atomic_bool MM_tracingEnabled;
+
+// Each writer claims the next slot with a single atomic increment, so recording an event never takes
+// a lock.  When the buffer is full the oldest events are overwritten.
+void MMRecordTraceEvent(MMRecordTraceEventKind kind,
+                        MMRecordTracePhase phase,
+                        uint32_t requestIdentifier,
+                        NSString *entityName,
+                        uint64_t count) {
+    if (atomic_load_explicit(&MM_tracingEnabled, memory_order_relaxed) == false) {
+        return;
+    }
+    
+    uint64_t index = atomic_fetch_add_explicit(&MM_traceHead, 1, memory_order_relaxed);
+    MMRecordTraceSlot *slot = &MM_traceBuffer[index % MM_traceCapacity];
+    
+    atomic_store_explicit(&slot->sequence, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    
+    slot->timestamp = mach_absolute_time();
+    slot->count = count;
+    slot->requestIdentifier = requestIdentifier;
+    slot->kind = kind;
+    slot->phase = phase;
+    
+    CFIndex length = 0;
+    
+    if (entityName != nil) {
+        CFStringRef string = (__bridge CFStringRef)entityName;
+        
+        CFStringGetBytes(string, CFRangeMake(0, CFStringGetLength(string)), kCFStringEncodingUTF8, '?', false,
+                         (UInt8 *)slot->entityName, MM_traceEntityNameLength - 1, &length);
+    }
+    
+    slot->entityName[length] = '\0';
+    
+    atomic_store_explicit(&slot->sequence, index + 1, memory_order_release);
+}
+
+#endif
 
 // This class is used for error handling with MMRecord.  You can specify error levels and this class
 // will be used to decide which errors are logged and which errors cause a fatal error that will
@@ -80,6 +162,10 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
     BOOL                receivedFatalError_;
 }
 
+// The trace identifier of the request whose errors are being handled, which is recorded with each
+// error trace event.
+@property (nonatomic) uint32_t traceIdentifier;
+
 - (BOOL)receivedFatalError;
 - (NSError *)fatalError;
 
@@ -88,9 +174,18 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
 
 @end
 
+// This class represents an import that is waiting to be run on the parsing queue.
+@interface MMRecordImportTask : NSObject
+
+@property (nonatomic) MMRecordRequestPriority priority;
+@property (nonatomic, copy) dispatch_block_t block;
+
+@end
+
 @interface MMRecordRequestState : NSObject
 
 @property (nonatomic, strong) MMRecordOptions *options;
+@property (nonatomic) uint32_t traceIdentifier;
 
 @property (nonatomic, getter = isBatched) BOOL batched;
 @property (nonatomic) dispatch_queue_t parsingQueue;
@@ -109,11 +204,27 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
 
 @property (nonatomic, copy) NSString *cacheKey;
 @property (nonatomic, copy) NSString *keyPathForMetaData;
-
-@property (nonatomic, strong) id domain;
+@property (nonatomic, copy) NSDictionary *validators;
+@property (nonatomic, strong) MMServerResponseSchema *responseSchema;
+
+@property (nonatomic) MMRecordResponseSource responseSource;
+@property (nonatomic, copy) NSArray *cachedObjectIDs;
+@property (nonatomic) BOOL recordsChanged;
+@property (nonatomic) BOOL savedChangedValues;
+@property (nonatomic) BOOL contextHadChanges;
+@property (nonatomic) NSUInteger insertedRecordCount;
+@property (nonatomic, strong) NSMutableSet *responsePrimaryKeyValues;
+
+@property (nonatomic, copy) NSString *coalescingKey;
+@property (nonatomic, strong) NSMutableArray *coalescedStates;
+@property (nonatomic, strong) NSError *error;
+@property (atomic, getter = isCancelled) BOOL cancelled;
+
+@property (nonatomic, weak) id domain;
 @property (nonatomic, copy) id (^customResponseBlock)(id JSON);
 @property (nonatomic, copy) void (^resultBlock)(NSArray *records, id customResponseObject);
 @property (nonatomic, copy) void (^failureBlock)(NSError* error);
+@property (nonatomic, copy) void (^revalidationResultBlock)(NSArray *records, id customResponseObject, MMRecordResponseSource responseSource);
 
 + (MMRecordRequestState *)requestStateForURN:(NSString*)URN
                                         data:(NSDictionary*)data
@@ -123,6 +234,104 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
                                  resultBlock:(void(^)(NSArray *records, id customResponseObject))resultBlock
                                 failureBlock:(void(^)(NSError* error))failureBlock;
 
+- (void)cancel;
+
+@end
+
+// This class represents one page of a pipelined paged request.  The page manager is created as soon
+// as the response arrives so that the request for the following page can be started before this
+// page has been imported.
+@interface MMRecordPipelinedPage : NSObject
+
+@property (nonatomic, copy) NSString *URN;
+@property (nonatomic, copy) NSDictionary *data;
+@property (nonatomic, strong) id responseObject;
+@property (nonatomic, strong) NSError *error;
+@property (nonatomic, strong) MMServerPageManager *pageManager;
+@property (nonatomic, copy) NSArray *records;
+@property (nonatomic, getter = isReceived) BOOL received;
+@property (nonatomic, getter = isDelivered) BOOL delivered;
+
+@end
+
+// This class runs a paged request that prefetches the pages after the one being imported.  Pages
+// are imported and delivered strictly in order, and a page is only imported once the result block
+// for the page before it has set requestNextPage.  Page requests are registered with the pipeline as
+// their domain, so the requests for prefetched pages that are no longer wanted are cancelled when the
+// pipeline finishes.
+@interface MMRecordPagePipeline : NSObject
+
+@property (nonatomic, strong) Class recordClass;
+@property (nonatomic, strong) MMRecordOptions *options;
+@property (nonatomic, strong) NSManagedObjectContext *context;
+@property (nonatomic, weak) id domain;
+@property (nonatomic) NSUInteger prefetchCount;
+@property (nonatomic, getter = isBatched) BOOL batched;
+@property (nonatomic) dispatch_group_t dispatchGroup;
+
+@property (nonatomic, copy) void (^pageManagerBlock)(MMServerPageManager *pageManager);
+@property (nonatomic, copy) void (^resultBlock)(NSArray *records, id pageManager, BOOL *requestNextPage);
+@property (nonatomic, copy) void (^failureBlock)(NSError *error);
+
+@property (nonatomic, strong) NSMutableArray *pages;
+@property (nonatomic) NSUInteger nextImportIndex;
+@property (nonatomic, strong) MMRecordRequestState *importingState;
+@property (nonatomic, getter = isImporting) BOOL importing;
+@property (nonatomic, getter = isFinished) BOOL finished;
+@property (nonatomic, getter = isCompleted) BOOL completed;
+
++ (MMRecordPagePipeline *)pipelineForRecordClass:(Class)recordClass
+                                         options:(MMRecordOptions *)options
+                                         context:(NSManagedObjectContext *)context
+                                          domain:(id)domain
+                                pageManagerBlock:(void (^)(MMServerPageManager *pageManager))pageManagerBlock
+                                     resultBlock:(void (^)(NSArray *records, id pageManager, BOOL *requestNextPage))resultBlock
+                                    failureBlock:(void (^)(NSError *error))failureBlock;
+
+- (void)startWithURN:(NSString *)URN data:(NSDictionary *)data;
+- (void)cancel;
+
+@end
+
+// This class runs a paged request whose remaining pages are requested concurrently once the first
+// page has said how many pages there are.  Pages are imported and passed to the page result block as
+// they arrive, and the completion block is called with the records from every page in page order.
+// If the page manager cannot address pages by index then each page is requested as soon as the page
+// before it has arrived.  Page requests are registered with the fan-out as their domain, so any that
+// are still in flight are cancelled when it finishes.
+@interface MMRecordPageFanOut : NSObject
+
+@property (nonatomic, strong) Class recordClass;
+@property (nonatomic, strong) MMRecordOptions *options;
+@property (nonatomic, strong) NSManagedObjectContext *context;
+@property (nonatomic, weak) id domain;
+@property (nonatomic) NSUInteger maximumConcurrentRequests;
+@property (nonatomic, getter = isBatched) BOOL batched;
+@property (nonatomic) dispatch_group_t dispatchGroup;
+
+@property (nonatomic, copy) void (^pageResultBlock)(NSArray *records, id pageManager);
+@property (nonatomic, copy) void (^completionBlock)(NSArray *records);
+@property (nonatomic, copy) void (^failureBlock)(NSError *error);
+
+@property (nonatomic, strong) NSMutableArray *pages;
+@property (nonatomic, strong) NSMutableSet *importingStates;
+@property (nonatomic) NSUInteger nextRequestIndex;
+@property (nonatomic) NSUInteger runningRequestCount;
+@property (nonatomic) BOOL addressesPagesByIndex;
+@property (nonatomic, getter = isFinished) BOOL finished;
+@property (nonatomic, getter = isCompleted) BOOL completed;
+
++ (MMRecordPageFanOut *)fanOutForRecordClass:(Class)recordClass
+                                     options:(MMRecordOptions *)options
+                                     context:(NSManagedObjectContext *)context
+                                      domain:(id)domain
+                             pageResultBlock:(void (^)(NSArray *records, id pageManager))pageResultBlock
+                             completionBlock:(void (^)(NSArray *records))completionBlock
+                                failureBlock:(void (^)(NSError *error))failureBlock;
+
+- (void)startWithURN:(NSString *)URN data:(NSDictionary *)data;
+- (void)cancel;
+
 @end
 
 
@@ -133,6 +342,7 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
 
 - (void)MMRecord_startObservingWithContext:(NSManagedObjectContext*)context;
 - (void)MMRecord_stopObservingWithContext:(NSManagedObjectContext*)context;
+- (void)MMRecord_refreshRecordsWithObjectIDs:(NSArray *)objectIDs;
 - (NSEntityDescription*)MMRecord_entityForClass:(Class)managedObjectClass;
 
 @end
@@ -146,6 +356,12 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
 
 @end
 
+@interface MMRecordOptions ()
+
+- (MMRecordOptions *)copiedOptions;
+
+@end
+
 // This extension to `MMRecord` provides convenience methods for obtaining and restoring options.
 @interface MMRecord (MMRecordOptionsInternal)
 
@@ -176,6 +392,10 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
     return [MMRecordRepresentation class];
 }
 
++ (NSArray *)additionalKeyPathsForResponseSchema {
+    return nil;
+}
+
 + (NSDateFormatter *)dateFormatter {
     return nil;
 }
@@ -192,6 +412,18 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
     return NO;
 }
 
++ (BOOL)deletesOrphanedRecords {
+    return NO;
+}
+
++ (BOOL)decodesOnlyMappedKeyPaths {
+    return NO;
+}
+
++ (NSUInteger)maximumRelationshipDepth {
+    return 512;
+}
+
 
 #pragma mark - Request Options Configuration Methods
 
@@ -212,6 +444,16 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
     options.automaticallyPersistsRecords = YES;
     options.callbackQueue = dispatch_get_main_queue();
     options.isRecordLevelCachingEnabled = NO;
+    options.revalidatesCachedResults = NO;
+    options.fingerprintsResponses = NO;
+    options.coalescesInFlightRequests = NO;
+    options.requestPriority = MMRecordRequestPriorityDefault;
+    options.pagePrefetchCount = 0;
+    options.maximumConcurrentPageRequests = 4;
+    options.deletesOrphanedRecords = [self deletesOrphanedRecords];
+    options.orphanDeletionScopePredicate = nil;
+    options.decodesOnlyMappedKeyPaths = [self decodesOnlyMappedKeyPaths];
+    options.maximumRelationshipDepth = [self maximumRelationshipDepth];
     options.keyPathForResponseObject = [self keyPathForResponseObject];
     options.keyPathForMetaData = [self keyPathForMetaData];
     options.pageManagerClass = [[self server] pageManagerClass];
@@ -312,9 +554,39 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
 #pragma mark - Request Cancellation
 
 + (void)cancelRequestsWithDomain:(id)domain {
+    // Request states are registered with the domain so that responses that have already been
+    // received are cancelled too, since the server can only cancel requests that are still in flight.
+    [[self server] cancelRegisteredRequestsForDomain:domain];
     [[self server] cancelRequestsWithDomain:domain];
 }
 
++ (void)registerActiveRequestState:(MMRecordRequestState *)state {
+    [[self server] registerRequest:state forDomain:state.domain];
+}
+
++ (void)unregisterActiveRequestState:(MMRecordRequestState *)state {
+    [[self server] unregisterRequest:state forDomain:state.domain];
+}
+
+// An import is only cancelled if every request waiting on it has been cancelled.
++ (BOOL)isImportCancelledForRequestState:(MMRecordRequestState *)state {
+    if ([state isCancelled] == NO) {
+        return NO;
+    }
+    
+    if (state.coalescingKey != nil) {
+        @synchronized(MM_inFlightRequestStates) {
+            for (MMRecordRequestState *coalescedState in state.coalescedStates) {
+                if ([coalescedState isCancelled] == NO) {
+                    return NO;
+                }
+            }
+        }
+    }
+    
+    return YES;
+}
+
 
 #pragma mark - Logging Level
 
@@ -327,6 +599,74 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
 }
 
 
+#pragma mark - Tracing
+
++ (void)setTracingEnabled:(BOOL)tracingEnabled {
+#if MMRecordTracing
+    atomic_store(&MM_tracingEnabled, tracingEnabled ? true : false);
+#endif
+}
+
++ (BOOL)isTracingEnabled {
+#if MMRecordTracing
+    return atomic_load(&MM_tracingEnabled) ? YES : NO;
+#else
+    return NO;
+#endif
+}
+
++ (BOOL)writeTraceToFile:(NSString *)path error:(NSError **)error {
+    NSMutableString *trace = [NSMutableString stringWithString:@"timestamp_ns\trequest\tevent\tphase\tentity\tcount\n"];
+    
+#if MMRecordTracing
+    static NSString * const eventKindNames[] = { @"begin", @"end", @"mark" };
+    static NSString * const phaseNames[] = { @"request", @"import", @"build", @"obtain", @"populate", @"link", @"error" };
+    
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+    
+    uint64_t head = atomic_load_explicit(&MM_traceHead, memory_order_acquire);
+    uint64_t first = (head > MM_traceCapacity) ? head - MM_traceCapacity : 0;
+    
+    for (uint64_t index = first; index < head; index++) {
+        MMRecordTraceSlot *slot = &MM_traceBuffer[index % MM_traceCapacity];
+        uint64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        
+        if (sequence != index + 1) {
+            continue;
+        }
+        
+        uint64_t timestamp = slot->timestamp;
+        uint64_t count = slot->count;
+        uint32_t requestIdentifier = slot->requestIdentifier;
+        MMRecordTraceEventKind kind = slot->kind;
+        MMRecordTracePhase phase = slot->phase;
+        char entityName[MM_traceEntityNameLength];
+        memcpy(entityName, slot->entityName, MM_traceEntityNameLength);
+        entityName[MM_traceEntityNameLength - 1] = '\0';
+        
+        // Skip the event if it was overwritten while it was being copied.
+        atomic_thread_fence(memory_order_acquire);
+        
+        if (atomic_load_explicit(&slot->sequence, memory_order_relaxed) != sequence ||
+            kind > MMRecordTraceEventKindMark || phase > MMRecordTracePhaseError) {
+            continue;
+        }
+        
+        [trace appendFormat:@"%llu\t%u\t%@\t%@\t%@\t%llu\n",
+         timestamp * timebase.numer / timebase.denom,
+         requestIdentifier,
+         eventKindNames[kind],
+         phaseNames[phase],
+         [NSString stringWithUTF8String:entityName] ?: @"",
+         count];
+    }
+#endif
+    
+    return [trace writeToFile:path atomically:YES encoding:NSUTF8StringEncoding error:error];
+}
+
+
 #pragma mark - Internal Dispatch Methods
 
 + (dispatch_queue_t)parsingQueue {
@@ -339,6 +679,106 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
     return _parsing_queue;
 }
 
+// Imports are run on the serial parsing queue in priority order rather than in the order that their
+// responses arrive.  Each scheduled import adds one block to the parsing queue, which runs whichever
+// pending import has the highest priority at the time, at that import's own QoS class.
++ (void)scheduleImportWithPriority:(MMRecordRequestPriority)priority block:(dispatch_block_t)block {
+    [self scheduleImportWithPriority:priority block:block continuation:NO];
+}
+
+// A continuation is the rest of an import that yielded to higher priority imports, so it is placed
+// ahead of the imports with the same priority that arrived after it had started.
++ (void)scheduleImportWithPriority:(MMRecordRequestPriority)priority
+                             block:(dispatch_block_t)block
+                      continuation:(BOOL)continuation {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        MM_pendingImportTasks = [NSMutableArray array];
+    });
+    
+    MMRecordImportTask *task = [MMRecordImportTask new];
+    task.priority = priority;
+    task.block = block;
+    
+    @synchronized(MM_pendingImportTasks) {
+        NSUInteger index = [MM_pendingImportTasks count];
+        
+        while (index > 0) {
+            MMRecordRequestPriority previousPriority = [[MM_pendingImportTasks objectAtIndex:index - 1] priority];
+            
+            if (previousPriority > priority || (previousPriority == priority && continuation == NO)) {
+                break;
+            }
+            
+            index--;
+        }
+        
+        [MM_pendingImportTasks insertObject:task atIndex:index];
+    }
+    
+    [self dispatchParsingBlockWithPriority:priority];
+}
+
++ (void)dispatchParsingBlockWithPriority:(MMRecordRequestPriority)priority {
+    dispatch_block_t parsingBlock = ^{
+        [self runNextPendingImportWithPriority:priority];
+    };
+    
+    dispatch_async([self parsingQueue], [self parsingBlock:parsingBlock withPriority:priority]);
+}
+
+// A parsing block only runs an import of at least its own priority, and invoking that import's block
+// raises it to the import's QoS class.  A QoS class cannot be lowered that way, so if only lower
+// priority imports are waiting, the block hands over to a new block with their priority instead.
++ (void)runNextPendingImportWithPriority:(MMRecordRequestPriority)priority {
+    MMRecordImportTask *task = nil;
+    
+    @synchronized(MM_pendingImportTasks) {
+        task = [MM_pendingImportTasks count] > 0 ? [MM_pendingImportTasks objectAtIndex:0] : nil;
+        
+        if (task != nil && task.priority >= priority) {
+            [MM_pendingImportTasks removeObjectAtIndex:0];
+        }
+    }
+    
+    if (task == nil) {
+        return;
+    }
+    
+    if (task.priority < priority) {
+        [self dispatchParsingBlockWithPriority:task.priority];
+        return;
+    }
+    
+    [self parsingBlock:task.block withPriority:task.priority]();
+}
+
++ (BOOL)hasPendingImportWithPriorityAbove:(NSInteger)priority {
+    @synchronized(MM_pendingImportTasks) {
+        MMRecordImportTask *nextTask = [MM_pendingImportTasks count] > 0 ? [MM_pendingImportTasks objectAtIndex:0] : nil;
+        
+        return (nextTask != nil && nextTask.priority > priority);
+    }
+}
+
++ (dispatch_block_t)parsingBlock:(dispatch_block_t)block withPriority:(MMRecordRequestPriority)priority {
+#if (TARGET_OS_IPHONE && __IPHONE_OS_VERSION_MAX_ALLOWED >= 80000) || (!TARGET_OS_IPHONE && MAC_OS_X_VERSION_MAX_ALLOWED >= 101000)
+    if (dispatch_block_create_with_qos_class != NULL) {
+        dispatch_qos_class_t qosClass = QOS_CLASS_DEFAULT;
+        
+        if (priority == MMRecordRequestPriorityUserInitiated) {
+            qosClass = QOS_CLASS_USER_INITIATED;
+        } else if (priority == MMRecordRequestPriorityBackground) {
+            qosClass = QOS_CLASS_BACKGROUND;
+        }
+        
+        return dispatch_block_create_with_qos_class(DISPATCH_BLOCK_ENFORCE_QOS_CLASS, qosClass, 0, block);
+    }
+#endif
+    
+    return block;
+}
+
 + (void)setDispatchGroup:(dispatch_group_t)dispatchGroup {
     if (_mmrecord_request_semaphore == nil) {
         _mmrecord_request_semaphore = dispatch_semaphore_create(1);
@@ -407,6 +847,13 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
     } else {
         [backgroundContext setPersistentStoreCoordinator:mainStoreCoordinator];
     }
+    
+    // Background imports save and yield to higher priority imports between chunks, and the records
+    // they still hold may have been saved by those imports in the meantime.  The values in the store
+    // are the fresher ones, so they win.
+    if (options.requestPriority == MMRecordRequestPriorityBackground) {
+        [backgroundContext setMergePolicy:NSMergeByPropertyStoreTrumpMergePolicy];
+    }
 }
 
 + (void)configureState:(MMRecordRequestState *)state forCurrentRequestWithOptions:(MMRecordOptions *)options {
@@ -415,9 +862,10 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
     state.coordinator = state.context.persistentStoreCoordinator;
     state.dispatchGroup = [self dispatchGroup];
     state.parsingQueue = [self parsingQueue];
+    state.responseSchema = [self responseSchemaWithOptions:options context:state.context];
     
     if (options.isRecordLevelCachingEnabled) {
-        state.cacheKey = [self keyForURN:state.URN data:state.data];
+        state.cacheKey = [self keyForURN:state.URN data:state.data responseSchema:state.responseSchema];
         state.keyPathForMetaData = [self keyPathForMetaData];
     }
 }
@@ -502,23 +950,38 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
 
 #pragma mark - Performing Requests
 
+// A request that needs options of its own sets them on its state before it is preflighted.
 + (void)preflightRequestWithRequestState:(MMRecordRequestState *)state {
-    MMRecordOptions *options = [self currentOptions];
+    MMRecordOptions *options = (state.options != nil) ? state.options : [self currentOptions];
     
     [self configureState:state forCurrentRequestWithOptions:options];
     [self resetErrorHandler];
+    [[self currentErrorHandler] setTraceIdentifier:state.traceIdentifier];
     [self validateSetUpForStartRequest];
     
     BOOL cached = [self shortCircuitRequestByReturningCachedResultsForState:state options:options];
     
-    if (cached == NO) {
+    if (cached == NO || options.revalidatesCachedResults) {
         [self performRequestWithRequestState:state];
+    } else {
+        [self restoreDefaultOptions];
     }
 }
 
 // You should really do your preflight check before calling this method.
 + (void)performRequestWithRequestState:(MMRecordRequestState *)state {
-    MMRecordOptions *options = [self currentOptions];
+    MMRecordOptions *options = state.options;
+    
+    [self registerActiveRequestState:state];
+    
+    if (options.coalescesInFlightRequests) {
+        state.coalescingKey = [self coalescingKeyForRequestState:state options:options];
+        
+        if ([self attachRequestStateToInFlightRequest:state]) {
+            [self restoreDefaultOptions];
+            return;
+        }
+    }
     
 #if NEEDS_DISPATCH_RETAIN_RELEASE
     dispatch_retain(state.dispatchGroup);
@@ -528,117 +991,560 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
         dispatch_group_enter(state.dispatchGroup);
     }
     
-    [[self server]
-     startRequestWithURN:state.URN
-     data:state.data
-     paged:NO
-     domain:state.domain
-     batched:state.isBatched
-     dispatchGroup:state.dispatchGroup
-     responseBlock:^(id responseObject) {
-         dispatch_queue_t parsingQueue = state.parsingQueue;
-         dispatch_group_async(state.dispatchGroup, parsingQueue, ^{
-             [self completeRequestForResponse:responseObject
-                                        state:state
-                                      options:options];
-             
-             if ([state isBatched]) {
-                 dispatch_group_leave(state.dispatchGroup);
-             }
-             
-#if NEEDS_DISPATCH_RETAIN_RELEASE
-             dispatch_release(state.dispatchGroup);
-#endif
-         });
-     } failureBlock:^(NSError *error) {
-         if (state.failureBlock != nil) {
-             state.failureBlock(error);
-         }
-         
-         if ([state isBatched]) {
-             dispatch_group_leave(state.dispatchGroup);
-         }
-         
+    MMRTrace(MMRecordTraceEventKindBegin, MMRecordTracePhaseRequest, state.traceIdentifier, NSStringFromClass(self), 0);
+    
+    void (^finishBlock)(void) = ^{
+        MMRTrace(MMRecordTraceEventKindEnd, MMRecordTracePhaseRequest, state.traceIdentifier, NSStringFromClass(self), [state.records count]);
+        
+        if (state.coalescingKey != nil) {
+            [self completeCoalescedRequestStatesForRequestState:state];
+        }
+        
+        [self unregisterActiveRequestState:state];
+        
+        if ([state isBatched]) {
+            dispatch_group_leave(state.dispatchGroup);
+        }
+        
 #if NEEDS_DISPATCH_RETAIN_RELEASE
-         dispatch_release(state.dispatchGroup);
+        dispatch_release(state.dispatchGroup);
 #endif
-     }];
+    };
+    
+    void (^responseBlock)(id responseObject) = ^(id responseObject) {
+        [self scheduleImportWithPriority:options.requestPriority block:^{
+            [self completeRequestForResponse:responseObject
+                                       state:state
+                                     options:options
+                             completionBlock:finishBlock];
+        }];
+    };
+    
+    void (^failureBlock)(NSError *error) = ^(NSError *error) {
+        MMRTrace(MMRecordTraceEventKindMark, MMRecordTracePhaseError, state.traceIdentifier, NSStringFromClass(self), (uint64_t)[error code]);
+        
+        state.error = error;
+        
+        if (state.failureBlock != nil) {
+            state.failureBlock(error);
+        }
+        
+        finishBlock();
+    };
+    
+    if (state.cacheKey != nil) {
+        [[self server]
+         startConditionalRequestWithURN:state.URN
+         data:state.data
+         domain:state.domain
+         batched:state.isBatched
+         dispatchGroup:state.dispatchGroup
+         priority:options.requestPriority
+         responseSchema:state.responseSchema
+         validators:[MMRecordCache validatorsForKey:state.cacheKey]
+         responseBlock:^(id responseObject, NSDictionary *validators) {
+             state.validators = validators;
+             responseBlock(responseObject);
+         } notModifiedBlock:^{
+             [self scheduleImportWithPriority:options.requestPriority block:^{
+                 if ([self completeRequestWithCachedRecordsForResponse:nil state:state options:options]) {
+                     finishBlock();
+                 } else {
+                     // The cached records or the cached response body are gone, so the full response
+                     // is needed after all.  Without validators the server cannot answer not modified.
+                     [[self server]
+                      startConditionalRequestWithURN:state.URN
+                      data:state.data
+                      domain:state.domain
+                      batched:state.isBatched
+                      dispatchGroup:state.dispatchGroup
+                      priority:options.requestPriority
+                      responseSchema:state.responseSchema
+                      validators:nil
+                      responseBlock:^(id responseObject, NSDictionary *validators) {
+                          state.validators = validators;
+                          responseBlock(responseObject);
+                      } notModifiedBlock:nil
+                      failureBlock:failureBlock];
+                 }
+             }];
+         } failureBlock:failureBlock];
+    } else {
+        [[self server]
+         startRequestWithURN:state.URN
+         data:state.data
+         paged:NO
+         domain:state.domain
+         batched:state.isBatched
+         dispatchGroup:state.dispatchGroup
+         priority:options.requestPriority
+         responseSchema:state.responseSchema
+         responseBlock:responseBlock
+         failureBlock:failureBlock];
+    }
     
     [self restoreDefaultOptions];
 }
 
 
-#pragma mark - Finalizing Requests
+#pragma mark - Response Schemas
 
-+ (void)completeRequestForResponse:(id)responseObject
-                             state:(MMRecordRequestState *)state
-                           options:(MMRecordOptions *)options {
-    state.backgroundContext = [[NSManagedObjectContext alloc] init];
-    state.responseObject = responseObject;
++ (MMServerResponseSchema *)responseSchemaWithOptions:(MMRecordOptions *)options
+                                              context:(NSManagedObjectContext *)context {
+    if (options.decodesOnlyMappedKeyPaths == NO) {
+        return nil;
+    }
     
-    [self configureBackgroundContext:state.backgroundContext
-                         withOptions:options
-                         mainContext:state.context
-                mainStoreCoordinator:state.coordinator];
+    NSEntityDescription *entity = [context MMRecord_entityForClass:self];
     
-    state.records = [self recordsFromResponseObject:responseObject
-                                            options:options
-                                              state:state
-                                            context:state.backgroundContext];
+    if (entity == nil) {
+        return nil;
+    }
     
-    [self performCachingForRecords:state.records
-                fromResponseObject:state.responseObject
-                      requestState:state
-                       withOptions:options];
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        MM_responseSchemas = [NSMutableDictionary dictionary];
+    });
     
-    state.objectIDs = [self objectIDsForRecords:state.records
-                                  onMainContext:state.context
-                          fromBackgroundContext:state.backgroundContext];
+    NSString *schemaKey = [NSString stringWithFormat:@"%@|%@|%@",
+                           [entity name],
+                           options.keyPathForResponseObject,
+                           options.keyPathForMetaData];
     
-    if ([[self currentErrorHandler] receivedFatalError] == NO) {
-        [self passRequestWithRequestState:state options:options];
-    } else {
-        [self failRequestWithRequestState:state options:options];
+    @synchronized(MM_responseSchemas) {
+        id schema = [MM_responseSchemas objectForKey:schemaKey];
+        
+        if (schema == nil) {
+            MMServerResponseSchema *recordSchema = [self responseSchemaForEntity:entity
+                                                                 visitedEntities:[NSMutableSet set]
+                                                                    builtSchemas:[NSMutableDictionary dictionary]];
+            
+            if (recordSchema != nil && options.keyPathForResponseObject != nil) {
+                schema = [MMServerResponseSchema new];
+                [schema setIncludesUnlistedKeys:YES];
+                [schema addKeyPath:options.keyPathForResponseObject schema:recordSchema];
+                
+                if (options.keyPathForMetaData != nil) {
+                    [schema addKeyPath:options.keyPathForMetaData schema:nil];
+                }
+            } else {
+                schema = recordSchema;
+            }
+            
+            [MM_responseSchemas setObject:(schema ?: [NSNull null]) forKey:schemaKey];
+        }
+        
+        return (schema == [NSNull null]) ? nil : schema;
     }
 }
 
-+ (void)passRequestWithRequestState:(MMRecordRequestState *)state
-                            options:(MMRecordOptions *)options {
-    [self invokeResultBlockWithRequestState:state options:options];
-}
-
-+ (void)failRequestWithRequestState:(MMRecordRequestState *)state
-                            options:(MMRecordOptions *)options {
-    if ([state isBatched]) {
-        dispatch_group_enter(state.dispatchGroup);
+// Builds the schema for the key paths mapped by an entity and its sub entities, along with the key
+// paths their record classes ask for.  Relationships back to an entity that is still being built are
+// decoded in full, which keeps the schema finite for cyclic models.  A nil schema means that the
+// records should be decoded in full, which is also the case when a representation reads unmapped
+// values.
++ (MMServerResponseSchema *)responseSchemaForEntity:(NSEntityDescription *)entity
+                                    visitedEntities:(NSMutableSet *)visitedEntities
+                                       builtSchemas:(NSMutableDictionary *)builtSchemas {
+    NSString *entityName = [entity name];
+    id builtSchema = [builtSchemas objectForKey:entityName];
+    
+    if (builtSchema != nil) {
+        return (builtSchema == [NSNull null]) ? nil : builtSchema;
     }
     
-    dispatch_group_async(state.dispatchGroup, options.callbackQueue, ^{
-        state.failureBlock([[self currentErrorHandler] fatalError]);
-        
-        if ([state isBatched]) {
-            dispatch_group_leave(state.dispatchGroup);
-        }
-    });
-}
-
-+ (void)invokeResultBlockWithRequestState:(MMRecordRequestState *)state
-                                  options:(MMRecordOptions *)options {
-    if ([state isBatched]) {
-        dispatch_group_enter(state.dispatchGroup);
+    if ([visitedEntities containsObject:entityName]) {
+        return nil;
     }
     
-    dispatch_group_async(state.dispatchGroup, options.callbackQueue, ^{
-        id customResponseObject = (state.customResponseBlock) ? state.customResponseBlock(state.responseObject) : nil;
+    if ([NSClassFromString([entity managedObjectClassName]) isSubclassOfClass:[MMRecord class]] == NO) {
+        return nil;
+    }
+    
+    [visitedEntities addObject:entityName];
+    
+    MMServerResponseSchema *schema = [MMServerResponseSchema new];
+    
+    NSMutableArray *entities = [NSMutableArray arrayWithObject:entity];
+    
+    for (NSUInteger i = 0; i < [entities count]; i++) {
+        NSEntityDescription *representedEntity = [entities objectAtIndex:i];
+        Class recordClass = NSClassFromString([representedEntity managedObjectClassName]);
         
-        NSArray *mainContextRecords = [self mainContextRecordsFromObjectIDs:state.objectIDs mainContext:state.context];
+        [entities addObjectsFromArray:[representedEntity subentities]];
         
-        if (state.resultBlock != nil) {
-            state.resultBlock(mainContextRecords,customResponseObject);
+        if ([recordClass isSubclassOfClass:[MMRecord class]] == NO) {
+            continue;
         }
         
-        if ([state isBatched]) {
-            dispatch_group_leave(state.dispatchGroup);
+        MMRecordRepresentation *representation = [[[recordClass representationClass] alloc] initWithEntity:representedEntity];
+        
+        if ([representation readsUnmappedKeyPaths]) {
+            schema = nil;
+            break;
+        }
+        
+        for (NSString *keyPath in [recordClass additionalKeyPathsForResponseSchema]) {
+            [schema addKeyPath:keyPath schema:nil];
+        }
+        
+        for (NSAttributeDescription *attributeDescription in [representation attributeDescriptions]) {
+            for (NSString *keyPath in [representation keyPathsForMappingAttributeDescription:attributeDescription]) {
+                [schema addKeyPath:keyPath schema:nil];
+            }
+        }
+        
+        for (NSRelationshipDescription *relationshipDescription in [representation relationshipDescriptions]) {
+            MMServerResponseSchema *destinationSchema = [self responseSchemaForEntity:[relationshipDescription destinationEntity]
+                                                                      visitedEntities:visitedEntities
+                                                                         builtSchemas:builtSchemas];
+            
+            for (NSString *keyPath in [representation keyPathsForMappingRelationshipDescription:relationshipDescription]) {
+                [schema addKeyPath:keyPath schema:destinationSchema];
+            }
+        }
+    }
+    
+    [visitedEntities removeObject:entityName];
+    [builtSchemas setObject:(schema ?: [NSNull null]) forKey:entityName];
+    
+    return schema;
+}
+
+
+#pragma mark - Coalescing Requests
+
++ (NSString *)coalescingKeyForRequestState:(MMRecordRequestState *)state
+                                   options:(MMRecordOptions *)options {
+    NSString *requestKey = state.cacheKey;
+    
+    if (requestKey == nil) {
+        requestKey = [self keyForURN:state.URN data:state.data responseSchema:state.responseSchema];
+    }
+    
+    // Records imported into a child context are only visible to that context's parent.
+    void *contextScope = (options.automaticallyPersistsRecords) ? NULL : (__bridge void *)state.context;
+    
+    // Responses decoded with a schema are missing values that other requests may need.
+    return [NSString stringWithFormat:@"%@|%@|%d|%p|%p|%@",
+            NSStringFromClass(self),
+            options.keyPathForResponseObject,
+            options.decodesOnlyMappedKeyPaths,
+            state.coordinator,
+            contextScope,
+            requestKey];
+}
+
+// Returns YES if an identical request is already in flight, in which case the given state will be
+// completed with that request's results.  Otherwise the state becomes the in flight request.
++ (BOOL)attachRequestStateToInFlightRequest:(MMRecordRequestState *)state {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        MM_inFlightRequestStates = [NSMutableDictionary dictionary];
+    });
+    
+    @synchronized(MM_inFlightRequestStates) {
+        MMRecordRequestState *inFlightState = [MM_inFlightRequestStates objectForKey:state.coalescingKey];
+        
+        if (inFlightState == nil) {
+            state.coalescedStates = [NSMutableArray array];
+            [MM_inFlightRequestStates setObject:state forKey:state.coalescingKey];
+            return NO;
+        }
+        
+        if ([state isBatched]) {
+#if NEEDS_DISPATCH_RETAIN_RELEASE
+            dispatch_retain(state.dispatchGroup);
+#endif
+            dispatch_group_enter(state.dispatchGroup);
+        }
+        
+        [inFlightState.coalescedStates addObject:state];
+        
+        return YES;
+    }
+}
+
++ (void)completeCoalescedRequestStatesForRequestState:(MMRecordRequestState *)state {
+    NSArray *coalescedStates = nil;
+    
+    @synchronized(MM_inFlightRequestStates) {
+        coalescedStates = [state.coalescedStates copy];
+        [MM_inFlightRequestStates removeObjectForKey:state.coalescingKey];
+    }
+    
+    for (MMRecordRequestState *coalescedState in coalescedStates) {
+        MMRecordOptions *options = coalescedState.options;
+        
+        if (state.error != nil) {
+            NSError *error = state.error;
+            
+            dispatch_group_async(coalescedState.dispatchGroup, options.callbackQueue, ^{
+                if (coalescedState.failureBlock != nil) {
+                    coalescedState.failureBlock(error);
+                }
+            });
+        } else {
+            coalescedState.responseObject = state.responseObject;
+            coalescedState.objectIDs = state.objectIDs;
+            coalescedState.responseSource = MMRecordResponseSourceNetwork;
+            coalescedState.recordsChanged = (state.contextHadChanges ||
+                                             [state.objectIDs isEqualToArray:coalescedState.cachedObjectIDs] == NO);
+            
+            [self passRequestWithRequestState:coalescedState options:options];
+        }
+        
+        [self unregisterActiveRequestState:coalescedState];
+        
+        if ([coalescedState isBatched]) {
+            dispatch_group_leave(coalescedState.dispatchGroup);
+            
+#if NEEDS_DISPATCH_RETAIN_RELEASE
+            dispatch_release(coalescedState.dispatchGroup);
+#endif
+        }
+    }
+}
+
+
+#pragma mark - Finalizing Requests
+
+// Imports the response and delivers the results.  A chunked background import may finish in a later
+// import task than the one it started in, so the completion block is called once the request has
+// been passed, failed or cancelled.
++ (void)completeRequestForResponse:(id)responseObject
+                             state:(MMRecordRequestState *)state
+                           options:(MMRecordOptions *)options
+                   completionBlock:(dispatch_block_t)completionBlock {
+    // The error handler is shared by every import, so it is pointed at this request's traces.
+    [[self currentErrorHandler] setTraceIdentifier:state.traceIdentifier];
+    
+    if ([self isImportCancelledForRequestState:state]) {
+        [self cancelImportWithRequestState:state options:options];
+        
+        if (completionBlock != nil) {
+            completionBlock();
+        }
+        
+        return;
+    }
+    
+    if (options.fingerprintsResponses && state.cacheKey != nil) {
+        if ([self fingerprintResponse:responseObject state:state options:options]) {
+            if (completionBlock != nil) {
+                completionBlock();
+            }
+            
+            return;
+        }
+    }
+    
+    state.backgroundContext = [[NSManagedObjectContext alloc] init];
+    state.responseObject = responseObject;
+    
+    [self configureBackgroundContext:state.backgroundContext
+                         withOptions:options
+                         mainContext:state.context
+                mainStoreCoordinator:state.coordinator];
+    
+    state.responseSource = MMRecordResponseSourceNetwork;
+    state.savedChangedValues = NO;
+    state.insertedRecordCount = 0;
+    state.responsePrimaryKeyValues = [NSMutableSet set];
+    
+    [self importRecordsFromResponseObject:responseObject
+                                  options:options
+                                    state:state
+                                  context:state.backgroundContext
+                          completionBlock:^(NSArray *records) {
+                              state.records = records;
+                              
+                              [self finishImportWithRequestState:state options:options];
+                              
+                              if (completionBlock != nil) {
+                                  completionBlock();
+                              }
+                          }];
+}
+
++ (void)finishImportWithRequestState:(MMRecordRequestState *)state
+                             options:(MMRecordOptions *)options {
+    if ([state isCancelled] && (state.records == nil || [self isImportCancelledForRequestState:state])) {
+        [state.backgroundContext rollback];
+        [self cancelImportWithRequestState:state options:options];
+        return;
+    }
+    
+    if (options.deletesOrphanedRecords && state.records != nil && [[self currentErrorHandler] receivedFatalError] == NO) {
+        [self deleteOrphanedRecordsWithRequestState:state options:options];
+    }
+    
+    [self performCachingForRecords:state.records
+                fromResponseObject:state.responseObject
+                      requestState:state
+                       withOptions:options];
+    
+    BOOL contextHasChanges = YES;
+    
+    // A chunked import that yielded has already saved the chunks before it, so their changes are
+    // remembered on the state.  Requests coalesced with this one may have cached records of their
+    // own, so the changes are checked for them too.
+    if (state.cachedObjectIDs != nil || state.coalescingKey != nil) {
+        contextHasChanges = (state.savedChangedValues || [self contextContainsChangedValues:state.backgroundContext]);
+    }
+    
+    state.contextHadChanges = contextHasChanges;
+    
+    state.objectIDs = [self objectIDsForRecords:state.records
+                                  onMainContext:state.context
+                          fromBackgroundContext:state.backgroundContext];
+    
+    state.recordsChanged = contextHasChanges || ([state.objectIDs isEqualToArray:state.cachedObjectIDs] == NO);
+    
+    if ([[self currentErrorHandler] receivedFatalError] == NO) {
+        [self passRequestWithRequestState:state options:options];
+    } else {
+        [self failRequestWithRequestState:state options:options];
+    }
+}
+
+// Completes a request whose response is known to match the cached records.  If the response object
+// is nil, the cached response object is used instead.  Returns NO if the cached records could not be
+// obtained, or if a custom response block needs a response object that the cache no longer has, in
+// which case nothing has been delivered.
++ (BOOL)completeRequestWithCachedRecordsForResponse:(id)responseObject
+                                              state:(MMRecordRequestState *)state
+                                            options:(MMRecordOptions *)options {
+    NSManagedObjectContext *backgroundContext = [[NSManagedObjectContext alloc] init];
+    
+    [self configureBackgroundContext:backgroundContext
+                         withOptions:options
+                         mainContext:state.context
+                mainStoreCoordinator:state.coordinator];
+    
+    NSURLRequest *request = [self cachingRequestWithURN:state.URN data:state.data responseSchema:state.responseSchema];
+    
+    __block BOOL revalidated = NO;
+    
+    [MMRecordCache
+     getRevalidatedResultsForRequest:request
+     cacheKey:state.cacheKey
+     metaKeyPath:state.keyPathForMetaData
+     context:backgroundContext
+     cacheResultBlock:^(NSArray *cachedResults, id cachedResponseObject) {
+         // NSURLCache may have evicted the body that the custom response object is decoded from.
+         BOOL missingResponseObject = (responseObject == nil && cachedResponseObject == nil && state.customResponseBlock != nil);
+         
+         if (cachedResults != nil && missingResponseObject == NO) {
+             NSMutableArray *objectIDs = [NSMutableArray array];
+             
+             for (NSManagedObject *record in cachedResults) {
+                 [objectIDs addObject:record.objectID];
+             }
+             
+             state.backgroundContext = backgroundContext;
+             state.responseObject = (responseObject != nil) ? responseObject : cachedResponseObject;
+             state.records = cachedResults;
+             state.objectIDs = objectIDs;
+             state.responseSource = MMRecordResponseSourceNetwork;
+             state.recordsChanged = ([objectIDs isEqualToArray:state.cachedObjectIDs] == NO);
+             
+             revalidated = YES;
+         }
+     }];
+    
+    if (revalidated) {
+        [self passRequestWithRequestState:state options:options];
+    }
+    
+    return revalidated;
+}
+
++ (void)passRequestWithRequestState:(MMRecordRequestState *)state
+                            options:(MMRecordOptions *)options {
+    // The import may have continued for the sake of other requests that were coalesced with this one.
+    if ([state isCancelled]) {
+        [self failRequestWithRequestState:state options:options error:[self cancellationError]];
+        return;
+    }
+    
+    // A revalidated response that matches the cached results has nothing new to deliver.
+    if (state.responseSource == MMRecordResponseSourceNetwork &&
+        state.cachedObjectIDs != nil &&
+        state.recordsChanged == NO) {
+        return;
+    }
+    
+    [self invokeResultBlockWithRequestState:state options:options];
+}
+
++ (void)cancelImportWithRequestState:(MMRecordRequestState *)state
+                              options:(MMRecordOptions *)options {
+    NSError *error = [self cancellationError];
+    state.error = error;
+    
+    [self failRequestWithRequestState:state options:options error:error];
+}
+
++ (NSError *)cancellationError {
+    return [NSError errorWithMMRecordCode:MMRecordErrorCodeRequestCancelled
+                              description:@"The request was cancelled before its response was imported."];
+}
+
++ (void)failRequestWithRequestState:(MMRecordRequestState *)state
+                            options:(MMRecordOptions *)options {
+    NSError *error = [[self currentErrorHandler] fatalError];
+    state.error = error;
+    
+    [self failRequestWithRequestState:state options:options error:error];
+}
+
++ (void)failRequestWithRequestState:(MMRecordRequestState *)state
+                            options:(MMRecordOptions *)options
+                              error:(NSError *)error {
+    if ([state isBatched]) {
+        dispatch_group_enter(state.dispatchGroup);
+    }
+    
+    dispatch_group_async(state.dispatchGroup, options.callbackQueue, ^{
+        state.failureBlock(error);
+        
+        if ([state isBatched]) {
+            dispatch_group_leave(state.dispatchGroup);
+        }
+    });
+}
+
++ (void)invokeResultBlockWithRequestState:(MMRecordRequestState *)state
+                                  options:(MMRecordOptions *)options {
+    if ([state isBatched]) {
+        dispatch_group_enter(state.dispatchGroup);
+    }
+    
+    // A revalidating request may be delivered twice, so the values for this delivery are captured
+    // before the state is updated by the next one.
+    id responseObject = state.responseObject;
+    NSArray *objectIDs = state.objectIDs;
+    MMRecordResponseSource responseSource = state.responseSource;
+    NSUInteger insertedRecordCount = (responseSource == MMRecordResponseSourceNetwork) ? state.insertedRecordCount : 0;
+    
+    dispatch_group_async(state.dispatchGroup, options.callbackQueue, ^{
+        id customResponseObject = (state.customResponseBlock) ? state.customResponseBlock(responseObject) : nil;
+        
+        if ([customResponseObject isKindOfClass:[MMServerPageManager class]]) {
+            [customResponseObject setInsertedRecordCount:insertedRecordCount];
+        }
+        
+        NSArray *mainContextRecords = [self mainContextRecordsFromObjectIDs:objectIDs mainContext:state.context];
+        
+        if (state.revalidationResultBlock != nil) {
+            state.revalidationResultBlock(mainContextRecords, customResponseObject, responseSource);
+        } else if (state.resultBlock != nil) {
+            state.resultBlock(mainContextRecords,customResponseObject);
+        }
+        
+        if ([state isBatched]) {
+            dispatch_group_leave(state.dispatchGroup);
         }
     });
 }
@@ -649,11 +1555,13 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
 + (BOOL)shortCircuitRequestByReturningCachedResultsForState:(MMRecordRequestState *)state
                                                     options:(MMRecordOptions *)options {
     if (options.isRecordLevelCachingEnabled) {
-        BOOL cached = [MMRecordCache hasResultsForKey:state.cacheKey];
+        __block BOOL cached = NO;
         
-        if (cached) {
-            NSURLRequest *request = [self cachingRequestWithURN:state.URN data:state.data];
+        if ([MMRecordCache hasResultsForKey:state.cacheKey]) {
+            NSURLRequest *request = [self cachingRequestWithURN:state.URN data:state.data responseSchema:state.responseSchema];
             
+            // The cache result block is called synchronously, and only if the cached response is
+            // still valid according to NSURLCache.
             [MMRecordCache
              getCachedResultsForRequest:request
              cacheKey:state.cacheKey
@@ -671,8 +1579,12 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
                      }
                      
                      state.objectIDs = objectIDs;
+                     state.cachedObjectIDs = objectIDs;
+                     state.responseSource = MMRecordResponseSourceCache;
                      
                      [self passRequestWithRequestState:state options:options];
+                     
+                     cached = YES;
                  }
              }];
         }
@@ -696,17 +1608,83 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
         
         [MMRecordCache cacheRecords:records
                        withMetadata:metadata
+                         validators:state.validators
                              forKey:state.cacheKey
                         fromContext:state.context];
     }
 }
 
-+ (NSURLRequest *)cachingRequestWithURN:(NSString *)URN data:(NSDictionary *)data {
-    return [[self server] requestWithURN:URN data:data];
+// Adds the fingerprint of the response to the validators that will be cached for it, and returns YES
+// if the request was completed with the cached records because the fingerprint has not changed.
++ (BOOL)fingerprintResponse:(id)responseObject
+                      state:(MMRecordRequestState *)state
+                    options:(MMRecordOptions *)options {
+    id fingerprintObject = responseObject;
+    
+    if ([responseObject isKindOfClass:[NSDictionary class]] && options.keyPathForResponseObject != nil) {
+        fingerprintObject = [responseObject valueForKeyPath:options.keyPathForResponseObject];
+    }
+    
+    NSString *fingerprint = [MMRecordCache fingerprintForResponseObject:fingerprintObject];
+    NSDictionary *cachedValidators = [MMRecordCache validatorsForKey:state.cacheKey];
+    
+    NSMutableDictionary *validators = [NSMutableDictionary dictionaryWithDictionary:state.validators];
+    [validators setObject:fingerprint forKey:MMRecordCacheFingerprintKey];
+    state.validators = validators;
+    
+    if ([fingerprint isEqualToString:[cachedValidators objectForKey:MMRecordCacheFingerprintKey]] == NO) {
+        return NO;
+    }
+    
+    if ([self completeRequestWithCachedRecordsForResponse:responseObject state:state options:options] == NO) {
+        return NO;
+    }
+    
+    // The server may have issued new HTTP validators for the same payload.
+    if ([validators isEqualToDictionary:cachedValidators] == NO) {
+        [self performCachingForRecords:state.records
+                    fromResponseObject:responseObject
+                          requestState:state
+                           withOptions:options];
+    }
+    
+    return YES;
 }
 
-+ (NSString *)keyForURN:(NSString *)URN data:(NSDictionary *)data {
-    NSURLRequest *request = [self cachingRequestWithURN:URN data:data];
++ (BOOL)contextContainsChangedValues:(NSManagedObjectContext *)context {
+    if ([[context insertedObjects] count] > 0 || [[context deletedObjects] count] > 0) {
+        return YES;
+    }
+    
+    // Re-populating a record marks it as updated even when every value is set to what it was before.
+    for (NSManagedObject *object in [context updatedObjects]) {
+        NSDictionary *changedValues = [object changedValues];
+        NSDictionary *committedValues = [object committedValuesForKeys:[changedValues allKeys]];
+        
+        for (NSString *key in changedValues) {
+            id changedValue = [changedValues objectForKey:key];
+            id committedValue = [committedValues objectForKey:key];
+            
+            if (changedValue != committedValue && [changedValue isEqual:committedValue] == NO) {
+                return YES;
+            }
+        }
+    }
+    
+    return NO;
+}
+
+// Requests that ask for a sparse fieldset have a different URL, and so a different cached response.
++ (NSURLRequest *)cachingRequestWithURN:(NSString *)URN
+                                   data:(NSDictionary *)data
+                         responseSchema:(MMServerResponseSchema *)responseSchema {
+    return [[self server] requestWithURN:URN data:data responseSchema:responseSchema];
+}
+
++ (NSString *)keyForURN:(NSString *)URN
+                   data:(NSDictionary *)data
+         responseSchema:(MMServerResponseSchema *)responseSchema {
+    NSURLRequest *request = [self cachingRequestWithURN:URN data:data responseSchema:responseSchema];
     
     return request.URL.absoluteString;
 }
@@ -728,14 +1706,43 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
 
 #pragma mark - Parsing Helper Methods
 
-+ (NSArray*)recordsFromResponseObject:(id)responseObject
-                              options:(MMRecordOptions *)options
-                                state:(MMRecordRequestState *)state
-                              context:(NSManagedObjectContext *)context {
+// Records whose to-many relationship was linked without faulting it in are not part of the save 
+// notification, so the main context refreshes them after merging it if it has already loaded them.
++ (void)saveBackgroundContext:(NSManagedObjectContext *)backgroundContext
+                  mainContext:(NSManagedObjectContext *)mainContext {
+    [mainContext MMRecord_startObservingWithContext:backgroundContext];
+    
+    NSError *coreDataError = nil;
+    if ([backgroundContext save:&coreDataError] == NO) {
+        [[self currentErrorHandler] handleFatalErrorCode:MMRecordErrorCodeCoreDataFetchError
+                                             description:@"Unable to save background context. Import operation unsuccessful."];
+    }
+    
+    [mainContext MMRecord_stopObservingWithContext:backgroundContext];
+    
+    NSSet *linkedRecords = [[backgroundContext userInfo] objectForKey:MMRecordContextRecordsLinkedWithoutFaultingKey];
+    
+    if (linkedRecords != nil) {
+        [[backgroundContext userInfo] removeObjectForKey:MMRecordContextRecordsLinkedWithoutFaultingKey];
+        
+        if (coreDataError == nil && mainContext != backgroundContext) {
+            [mainContext performSelectorOnMainThread:@selector(MMRecord_refreshRecordsWithObjectIDs:)
+                                          withObject:[[linkedRecords allObjects] valueForKey:@"objectID"]
+                                       waitUntilDone:YES];
+        }
+    }
+}
+
++ (void)importRecordsFromResponseObject:(id)responseObject
+                                options:(MMRecordOptions *)options
+                                  state:(MMRecordRequestState *)state
+                                context:(NSManagedObjectContext *)context
+                        completionBlock:(void (^)(NSArray *records))completionBlock {
     if (responseObject == nil) {
         [[self currentErrorHandler] handleFatalErrorCode:MMRecordErrorCodeInvalidResponseFormat
                                              description:@"The response object should not be nil"];
-        return nil;
+        completionBlock(nil);
+        return;
     }
     
     NSString *keyPathForResponseObject = options.keyPathForResponseObject;
@@ -748,15 +1755,185 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
         MMRecordErrorHandler *errorHandler = [self currentErrorHandler];
         [errorHandler handleFatalErrorCode:MMRecordErrorCodeInvalidEntityDescription
                                description:@"Initial Entity is not a subclass of MMRecord"];
-        return nil;
+        completionBlock(nil);
+        return;
+    }
+    
+    MMRTrace(MMRecordTraceEventKindBegin, MMRecordTracePhaseImport, state.traceIdentifier, initialEntity.name, [recordResponseArray count]);
+    
+    if (options.requestPriority == MMRecordRequestPriorityBackground &&
+        [recordResponseArray count] > MM_backgroundImportChunkSize) {
+        [self importRecordsFromResponseObjectArray:recordResponseArray
+                                          location:0
+                                           records:[NSMutableArray arrayWithCapacity:[recordResponseArray count]]
+                                     initialEntity:initialEntity
+                                             state:state
+                                           context:context
+                                   completionBlock:^(NSArray *records) {
+                                       MMRTrace(MMRecordTraceEventKindEnd, MMRecordTracePhaseImport, state.traceIdentifier, initialEntity.name, [records count]);
+                                       
+                                       completionBlock(records);
+                                   }];
+        return;
     }
+    
     MMRecordResponse *response = [MMRecordResponse responseFromResponseObjectArray:recordResponseArray
                                                                      initialEntity:initialEntity
                                                                            context:context];
+    response.maximumRelationshipDepth = options.maximumRelationshipDepth;
+    response.traceIdentifier = state.traceIdentifier;
     
-    NSArray *records = [response records];
+    NSArray *records = [response recordsWithCancellationBlock:^BOOL{
+        return [self isImportCancelledForRequestState:state];
+    }];
     
-    return records;
+    MMRTrace(MMRecordTraceEventKindEnd, MMRecordTracePhaseImport, state.traceIdentifier, initialEntity.name, [records count]);
+    
+    state.insertedRecordCount += [self insertedRecordCountForRecords:records];
+    
+    if (options.deletesOrphanedRecords) {
+        [state.responsePrimaryKeyValues addObjectsFromArray:[response primaryKeyValuesForEntity:initialEntity]];
+    }
+    
+    completionBlock(records);
+}
+
+// Imports the response in chunks, starting at the given location.  If a higher priority import is
+// waiting between two chunks, the chunks imported so far are saved and the rest of the response is
+// scheduled as a new import task so that the waiting import runs first.  Saving first lets the
+// waiting import find the records those chunks created instead of inserting duplicates of them.  A
+// cancelled import only rolls back the chunks it has not yet saved.
++ (void)importRecordsFromResponseObjectArray:(NSArray *)recordResponseArray
+                                    location:(NSUInteger)location
+                                     records:(NSMutableArray *)records
+                               initialEntity:(NSEntityDescription *)initialEntity
+                                       state:(MMRecordRequestState *)state
+                                     context:(NSManagedObjectContext *)context
+                             completionBlock:(void (^)(NSArray *records))completionBlock {
+    NSUInteger count = [recordResponseArray count];
+    NSUInteger firstLocation = location;
+    
+    BOOL (^cancellationBlock)(void) = ^BOOL{
+        return [self isImportCancelledForRequestState:state];
+    };
+    
+    for (; location < count; location += MM_backgroundImportChunkSize) {
+        if (cancellationBlock()) {
+            completionBlock(nil);
+            return;
+        }
+        
+        // Each task imports at least one chunk before it yields again.
+        if (location > firstLocation && [self hasPendingImportWithPriorityAbove:MMRecordRequestPriorityBackground]) {
+            NSUInteger nextLocation = location;
+            
+            if ((state.cachedObjectIDs != nil || state.coalescingKey != nil) && state.savedChangedValues == NO) {
+                state.savedChangedValues = [self contextContainsChangedValues:context];
+            }
+            
+            [self saveBackgroundContext:context mainContext:state.context];
+            
+            // The error handler is reset before the rest of the import runs, so a failed save ends
+            // the import here.
+            if ([[self currentErrorHandler] receivedFatalError]) {
+                completionBlock(records);
+                return;
+            }
+            
+            [self scheduleImportWithPriority:MMRecordRequestPriorityBackground block:^{
+                // The imports that ran in the meantime reset the shared error handler.  Importing a
+                // chunk raises no errors and the save above succeeded, so the rest of this import can
+                // start with a clean one.
+                [self resetErrorHandler];
+                [[self currentErrorHandler] setTraceIdentifier:state.traceIdentifier];
+                [self importRecordsFromResponseObjectArray:recordResponseArray
+                                                  location:nextLocation
+                                                   records:records
+                                             initialEntity:initialEntity
+                                                     state:state
+                                                   context:context
+                                           completionBlock:completionBlock];
+            } continuation:YES];
+            
+            return;
+        }
+        
+        NSRange range = NSMakeRange(location, MIN(MM_backgroundImportChunkSize, count - location));
+        
+        MMRecordResponse *response = [MMRecordResponse responseFromResponseObjectArray:[recordResponseArray subarrayWithRange:range]
+                                                                         initialEntity:initialEntity
+                                                                               context:context];
+        response.maximumRelationshipDepth = state.options.maximumRelationshipDepth;
+        response.traceIdentifier = state.traceIdentifier;
+        
+        NSArray *chunkRecords = [response recordsWithCancellationBlock:cancellationBlock];
+        
+        if (chunkRecords == nil) {
+            completionBlock(nil);
+            return;
+        }
+        
+        state.insertedRecordCount += [self insertedRecordCountForRecords:chunkRecords];
+        
+        if (state.options.deletesOrphanedRecords) {
+            [state.responsePrimaryKeyValues addObjectsFromArray:[response primaryKeyValuesForEntity:initialEntity]];
+        }
+        
+        [records addObjectsFromArray:chunkRecords];
+    }
+    
+    completionBlock(records);
+}
+
+// Deletes the stored records in the request's scope whose primary keys were not in the response.  The
+// primary keys gathered while importing the response are excluded in a single fetch, and the
+// deletions are saved along with the rest of the import.
++ (void)deleteOrphanedRecordsWithRequestState:(MMRecordRequestState *)state
+                                      options:(MMRecordOptions *)options {
+    NSManagedObjectContext *context = state.backgroundContext;
+    NSEntityDescription *entity = [context MMRecord_entityForClass:self];
+    NSString *primaryAttributeKey = [[entity userInfo] valueForKey:MMRecordEntityPrimaryAttributeKey];
+    
+    if (primaryAttributeKey == nil) {
+        [[self currentErrorHandler] handleErrorCode:MMRecordErrorCodeInvalidEntityDescription
+                                        description:@"Orphaned records can only be deleted for entities with a primary attribute key."];
+        return;
+    }
+    
+    NSPredicate *predicate = [NSPredicate predicateWithFormat:@"NOT (%K IN %@)", primaryAttributeKey, state.responsePrimaryKeyValues];
+    
+    if (options.orphanDeletionScopePredicate != nil) {
+        predicate = [NSCompoundPredicate andPredicateWithSubpredicates:@[options.orphanDeletionScopePredicate, predicate]];
+    }
+    
+    NSFetchRequest *fetchRequest = [[NSFetchRequest alloc] initWithEntityName:[entity name]];
+    fetchRequest.predicate = predicate;
+    fetchRequest.includesPropertyValues = NO;
+    
+    NSError *error = nil;
+    NSArray *orphanedRecords = [context executeFetchRequest:fetchRequest error:&error];
+    
+    if (orphanedRecords == nil) {
+        [[self currentErrorHandler] handleErrorCode:MMRecordErrorCodeCoreDataFetchError
+                                        description:[NSString stringWithFormat:@"Unable to fetch orphaned records. %@", error]];
+        return;
+    }
+    
+    for (NSManagedObject *orphanedRecord in orphanedRecords) {
+        [context deleteObject:orphanedRecord];
+    }
+}
+
++ (NSUInteger)insertedRecordCountForRecords:(NSArray *)records {
+    NSUInteger insertedRecordCount = 0;
+    
+    for (NSManagedObject *record in records) {
+        if ([record isInserted]) {
+            insertedRecordCount++;
+        }
+    }
+    
+    return insertedRecordCount;
 }
 
 + (NSArray *)parsingArrayFromResponseObject:(id)responseObject
@@ -789,15 +1966,7 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
 + (NSArray *)objectIDsForRecords:(NSArray *)records
                    onMainContext:(NSManagedObjectContext *)mainContext
            fromBackgroundContext:(NSManagedObjectContext *)backgroundContext {
-    [mainContext MMRecord_startObservingWithContext:backgroundContext];
-    
-    NSError *coreDataError = nil;
-    if ([backgroundContext save:&coreDataError] == NO) {
-        [[self currentErrorHandler] handleFatalErrorCode:MMRecordErrorCodeCoreDataFetchError
-                                             description:@"Unable to save background context. Import operation unsuccessful."];
-    }
-    
-    [mainContext MMRecord_stopObservingWithContext:backgroundContext];
+    [self saveBackgroundContext:backgroundContext mainContext:mainContext];
     
     NSMutableArray *objectIDs = [NSMutableArray array];
     
@@ -852,10 +2021,58 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
                           domain:(id)domain
                      resultBlock:(void (^)(NSArray *records, id pageManager, BOOL *requestNextPage))resultBlock
                     failureBlock:(void (^)(NSError *error))failureBlock {
-    MMRecordOptions *options = [self currentOptions];
+    [self startPagedRequestWithURN:URN
+                              data:data
+                           context:context
+                            domain:domain
+                  pageManagerBlock:nil
+                       resultBlock:resultBlock
+                      failureBlock:failureBlock];
+}
+
+// The page manager block is called with each page manager before its next page is requested, which
+// for a pipelined request is before the page is passed to the result block.
++ (void)startPagedRequestWithURN:(NSString *)URN
+                            data:(NSDictionary *)data
+                         context:(NSManagedObjectContext *)context
+                          domain:(id)domain
+                pageManagerBlock:(void (^)(MMServerPageManager *pageManager))pageManagerBlock
+                     resultBlock:(void (^)(NSArray *records, id pageManager, BOOL *requestNextPage))resultBlock
+                    failureBlock:(void (^)(NSError *error))failureBlock {
+    MMRecordOptions *options = [self pagedRequestOptions];
+    
+    if (options.pagePrefetchCount > 0) {
+        MMRecordPagePipeline *pipeline = [MMRecordPagePipeline pipelineForRecordClass:self
+                                                                              options:options
+                                                                              context:context
+                                                                               domain:domain
+                                                                     pageManagerBlock:pageManagerBlock
+                                                                          resultBlock:resultBlock
+                                                                         failureBlock:failureBlock];
+        [self resetErrorHandler];
+        [self validateSetUpForStartRequest];
+        [pipeline startWithURN:URN data:data];
+        [self restoreDefaultOptions];
+        return;
+    }
     
-    [self
-     startRequestWithURN:URN
+    // Each page request is started with the result block it is given, so wrapping the result block
+    // passes the page manager block on to every page.
+    void (^pagedResultBlock)(NSArray *records, id pageManager, BOOL *requestNextPage) = resultBlock;
+    
+    if (pageManagerBlock != nil) {
+        pagedResultBlock = ^(NSArray *records, id pageManager, BOOL *requestNextPage) {
+            pageManagerBlock(pageManager);
+            
+            if (resultBlock != nil) {
+                resultBlock(records, pageManager, requestNextPage);
+            }
+        };
+    }
+    
+    MMRecordRequestState *state =
+    [MMRecordRequestState
+     requestStateForURN:URN
      data:data
      context:context
      domain:domain
@@ -868,22 +2085,207 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
          return pageManager;
      }
      resultBlock:^(NSArray *records, MMServerPageManager *pageManager) {
-         if(resultBlock){
+         if(pagedResultBlock){
              BOOL requestNextPage = NO;
              
-             if (resultBlock != nil) {
-                 resultBlock(records,pageManager,&requestNextPage);
+             if (pagedResultBlock != nil) {
+                 pagedResultBlock(records,pageManager,&requestNextPage);
              }
              
              if (requestNextPage) {
                  [pageManager startNextPageRequestWithContext:context
                                                        domain:domain
-                                                  resultBlock:resultBlock
+                                                  resultBlock:pagedResultBlock
                                                  failureBlock:failureBlock];
              }
          }
      }
      failureBlock:failureBlock];
+    
+    state.options = options;
+    
+    [self preflightRequestWithRequestState:state];
+}
+
+// Each page of a paged request is only a part of the records in scope, so a page never deletes the
+// records that are not in it.  The options set by the caller are left as they are.
++ (MMRecordOptions *)pagedRequestOptions {
+    MMRecordOptions *options = [self currentOptions];
+    
+    if (options.deletesOrphanedRecords) {
+        options = [options copiedOptions];
+        options.deletesOrphanedRecords = NO;
+    }
+    
+    return options;
+}
+
++ (void)startConcurrentPagedRequestWithURN:(NSString *)URN
+                                      data:(NSDictionary *)data
+                                   context:(NSManagedObjectContext *)context
+                                    domain:(id)domain
+                           pageResultBlock:(void (^)(NSArray *records, id pageManager))pageResultBlock
+                           completionBlock:(void (^)(NSArray *records))completionBlock
+                              failureBlock:(void (^)(NSError *error))failureBlock {
+    MMRecordOptions *options = [self pagedRequestOptions];
+    
+    MMRecordPageFanOut *fanOut = [MMRecordPageFanOut fanOutForRecordClass:self
+                                                                  options:options
+                                                                  context:context
+                                                                   domain:domain
+                                                          pageResultBlock:pageResultBlock
+                                                          completionBlock:completionBlock
+                                                             failureBlock:failureBlock];
+    [self resetErrorHandler];
+    [self validateSetUpForStartRequest];
+    [fanOut startWithURN:URN data:data];
+    [self restoreDefaultOptions];
+}
+
++ (void)startResumableSyncWithIdentifier:(NSString *)syncIdentifier
+                                     URN:(NSString *)URN
+                                    data:(NSDictionary *)data
+                                 context:(NSManagedObjectContext *)context
+                                  domain:(id)domain
+                             resultBlock:(void (^)(NSArray *records, id pageManager, BOOL *requestNextPage))resultBlock
+                            failureBlock:(void (^)(NSError *error))failureBlock {
+    NSString *checkpointKey = [self checkpointKeyForSyncIdentifier:syncIdentifier];
+    NSDictionary *checkpoint = [MMRecordCache checkpointForKey:checkpointKey];
+    
+    NSString *pageURN = URN;
+    NSDictionary *pageData = data;
+    __block NSDictionary *cursor = nil;
+    
+    if (checkpoint != nil) {
+        pageURN = [checkpoint objectForKey:MMRecordCheckpointURNKey];
+        pageData = [checkpoint objectForKey:MMRecordCheckpointDataKey];
+        cursor = [checkpoint objectForKey:MMRecordCheckpointCursorKey];
+    }
+    
+    // The same page manager block is used for every page of the sync, so the cursor is carried from
+    // each page manager to the next one.  It is restored before the next page is requested, because a
+    // pipelined request asks for the next page before the page is passed to the result block.
+    [self
+     startPagedRequestWithURN:pageURN
+     data:pageData
+     context:context
+     domain:domain
+     pageManagerBlock:^(MMServerPageManager *pageManager) {
+         if (cursor != nil) {
+             [pageManager restoreCheckpointCursor:cursor];
+         }
+         
+         cursor = [pageManager checkpointCursor];
+     }
+     resultBlock:^(NSArray *records, MMServerPageManager *pageManager, BOOL *requestNextPage) {
+         if ([pageManager canRequestNextPage]) {
+             NSMutableDictionary *nextCheckpoint = [NSMutableDictionary dictionary];
+             [nextCheckpoint setValue:[pageManager nextPageURN] forKey:MMRecordCheckpointURNKey];
+             [nextCheckpoint setValue:[pageManager nextPageData] forKey:MMRecordCheckpointDataKey];
+             [nextCheckpoint setValue:[pageManager checkpointCursor] forKey:MMRecordCheckpointCursorKey];
+             
+             [MMRecordCache saveCheckpoint:nextCheckpoint forKey:checkpointKey];
+         } else {
+             [MMRecordCache deleteCheckpointForKey:checkpointKey];
+         }
+         
+         if (resultBlock != nil) {
+             resultBlock(records, pageManager, requestNextPage);
+         }
+     }
+     failureBlock:failureBlock];
+}
+
++ (void)resetResumableSyncWithIdentifier:(NSString *)syncIdentifier {
+    [MMRecordCache deleteCheckpointForKey:[self checkpointKeyForSyncIdentifier:syncIdentifier]];
+}
+
++ (void)startDeltaSyncWithURN:(NSString *)URN
+                         data:(NSDictionary *)data
+                      context:(NSManagedObjectContext *)context
+                       domain:(id)domain
+              pageResultBlock:(void (^)(NSArray *records, id pageManager))pageResultBlock
+              completionBlock:(void (^)(void))completionBlock
+                 failureBlock:(void (^)(NSError *error))failureBlock {
+    MMRecordOptions *options = [self currentOptions];
+    
+    NSString *highWaterMarkKey = [self highWaterMarkKeyForURN:URN];
+    NSDictionary *checkpoint = [MMRecordCache checkpointForKey:highWaterMarkKey];
+    id highWaterMark = [checkpoint objectForKey:MMRecordCheckpointHighWaterMarkKey];
+    
+    // A pending high water mark is stored while a sync pages back through the gap, so its presence
+    // means that the last sync did not finish.  The pages it did import are already in the store, so
+    // a page without new records does not mean that the gap has been filled.
+    BOOL resumesInterruptedSync = ([checkpoint objectForKey:MMRecordCheckpointPendingHighWaterMarkKey] != nil);
+    
+    NSDictionary *pageData = data;
+    
+    if (highWaterMark != nil) {
+        pageData = [[options pageManagerClass] requestData:data forRecordsNewerThanHighWaterMark:highWaterMark];
+    }
+    
+    // Pages arrive newest first, so the first page holds the new high water mark.  It is kept as the
+    // pending high water mark until the sync has paged back through the whole gap, and the previous
+    // high water mark is kept as the lower bound for the next sync until then.
+    __block id newHighWaterMark = nil;
+    __block BOOL receivedFirstPage = NO;
+    
+    [self
+     startPagedRequestWithURN:URN
+     data:pageData
+     context:context
+     domain:domain
+     resultBlock:^(NSArray *records, MMServerPageManager *pageManager, BOOL *requestNextPage) {
+         if (receivedFirstPage == NO) {
+             receivedFirstPage = YES;
+             newHighWaterMark = [pageManager highWaterMark];
+             
+             if (newHighWaterMark != nil) {
+                 NSMutableDictionary *pendingCheckpoint = [NSMutableDictionary dictionary];
+                 [pendingCheckpoint setValue:highWaterMark forKey:MMRecordCheckpointHighWaterMarkKey];
+                 [pendingCheckpoint setValue:newHighWaterMark forKey:MMRecordCheckpointPendingHighWaterMarkKey];
+                 
+                 [MMRecordCache saveCheckpoint:pendingCheckpoint forKey:highWaterMarkKey];
+             }
+         }
+         
+         if (pageResultBlock != nil) {
+             pageResultBlock(records, pageManager);
+         }
+         
+         BOOL reachedKnownRecords = (resumesInterruptedSync == NO && [pageManager insertedRecordCount] == 0);
+         
+         if ([pageManager canRequestNextPage] && reachedKnownRecords == NO) {
+             *requestNextPage = YES;
+             return;
+         }
+         
+         id completedHighWaterMark = (newHighWaterMark != nil) ? newHighWaterMark : highWaterMark;
+         
+         if (completedHighWaterMark != nil) {
+             [MMRecordCache saveCheckpoint:@{MMRecordCheckpointHighWaterMarkKey : completedHighWaterMark}
+                                    forKey:highWaterMarkKey];
+         } else {
+             [MMRecordCache deleteCheckpointForKey:highWaterMarkKey];
+         }
+         
+         if (completionBlock != nil) {
+             completionBlock();
+         }
+     }
+     failureBlock:failureBlock];
+}
+
++ (void)resetDeltaSyncWithURN:(NSString *)URN {
+    [MMRecordCache deleteCheckpointForKey:[self highWaterMarkKeyForURN:URN]];
+}
+
++ (NSString *)highWaterMarkKeyForURN:(NSString *)URN {
+    return [NSString stringWithFormat:@"%@.highWaterMark.%@", NSStringFromClass(self), URN];
+}
+
++ (NSString *)checkpointKeyForSyncIdentifier:(NSString *)syncIdentifier {
+    return [NSString stringWithFormat:@"%@.%@", NSStringFromClass(self), syncIdentifier];
 }
 
 @end
@@ -932,6 +2334,38 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
 @end
 
 
+#pragma mark - MMRecordCacheRevalidation Addition
+
+@implementation MMRecord (MMRecordCacheRevalidation)
+
++ (void)startRevalidatingRequestWithURN:(NSString *)URN
+                                   data:(NSDictionary *)data
+                                context:(NSManagedObjectContext *)context
+                                 domain:(id)domain
+                    customResponseBlock:(id (^)(id JSON))customResponseBlock
+                            resultBlock:(void(^)(NSArray *records, id customResponseObject, MMRecordResponseSource responseSource))resultBlock
+                           failureBlock:(void(^)(NSError *error))failureBlock {
+    // The flag is set on a copy that only this request uses, so it does not change the options set by
+    // the caller or reach the requests that follow it in a batch.
+    MMRecordOptions *options = [[self currentOptions] copiedOptions];
+    options.revalidatesCachedResults = YES;
+    
+    MMRecordRequestState *state = [MMRecordRequestState requestStateForURN:URN
+                                                                      data:data
+                                                                   context:context
+                                                                    domain:domain
+                                                       customResponseBlock:customResponseBlock
+                                                               resultBlock:nil
+                                                              failureBlock:failureBlock];
+    state.revalidationResultBlock = resultBlock;
+    state.options = options;
+    
+    [self preflightRequestWithRequestState:state];
+}
+
+@end
+
+
 #pragma mark - Managed Object Context Additions
 
 @implementation NSManagedObjectContext (MMRecord)
@@ -959,6 +2393,18 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
 	[self mergeChangesFromContextDidSaveNotification:note];
 }
 
+// Records that are not registered with this context, or are still faults, load the relationship 
+// from the store when they are next used and do not need to be refreshed.
+- (void)MMRecord_refreshRecordsWithObjectIDs:(NSArray *)objectIDs {
+    for (NSManagedObjectID *objectID in objectIDs) {
+        NSManagedObject *record = [self objectRegisteredForID:objectID];
+        
+        if (record != nil && [record isFault] == NO) {
+            [self refreshObject:record mergeChanges:YES];
+        }
+    }
+}
+
 
 #pragma mark - Entity Class
 
@@ -1001,6 +2447,10 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
             result = NSLocalizedString(@"Missing Page Manager. A page manager class must be defined on your MMServer subclass in order to use paging.",
                                        @"A page manager class must be defined on your MMServer subclass in order to use paging.");
             break;
+        case MMRecordErrorCodeRequestCancelled:
+            result = NSLocalizedString(@"Request Cancelled. The request was cancelled by its domain.",
+                                       @"The request was cancelled by its domain.");
+            break;
         case MMRecordErrorCodeInvalidEntityDescription:
             result = NSLocalizedString(@"Invalid Entity Description. This could be because this record class is not used in your managed object model, or because your persistent store coordinator or managed object model are not defined properly. An entity description is required for creating records.",
                                        @"This could be because this record class is not used in your managed object model, or because your persistent store coordinator or managed object model are not defined properly. An entity description is required for creating records.");
@@ -1065,6 +2515,8 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
 }
 
 - (void)logMessageForCode:(MMRecordErrorCode)errorCode description:(NSString *)description isFatal:(BOOL)isFatal {
+    MMRTrace(MMRecordTraceEventKindMark, MMRecordTracePhaseError, self.traceIdentifier, nil, (uint64_t)errorCode);
+    
 #if MMRecordLumberjack
     NSString *errorCodeDescription = [NSError descriptionForMCErrorCode:errorCode];
     
@@ -1075,9 +2527,16 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
         MMRLogWarn(@"%@. %@", errorCodeDescription, description);
     }
 #else
+    MMRecordLoggingLevel loggingLevel = [MMRecord loggingLevel];
+    
+    // The error has been traced, so there is no need to format a message that will not be logged.
+    if (loggingLevel == MMRecordLoggingLevelNone) {
+        return;
+    }
+    
     BOOL shouldLogMessage = NO;
     
-    switch ([MMRecord loggingLevel]) {
+    switch (loggingLevel) {
         case MMRecordLoggingLevelAll:
         case MMRecordLoggingLevelDebug:
         case MMRecordLoggingLevelInfo:
@@ -1119,6 +2578,7 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
                                  resultBlock:(void(^)(NSArray *records, id customResponseObject))resultBlock
                                 failureBlock:(void(^)(NSError *error))failureBlock {
     MMRecordRequestState *state = [MMRecordRequestState new];
+    state.traceIdentifier = atomic_fetch_add(&MM_lastTraceRequestIdentifier, 1) + 1;
     state.URN = URN;
     state.data = data;
     state.context = context;
@@ -1130,12 +2590,614 @@ NSString * const MMRecordAttributeAlternateNameKey = @"MMRecordAttributeAlternat
     return state;
 }
 
+- (void)cancel {
+    self.cancelled = YES;
+}
+
 @end
 
 
 #pragma mark - Options
 
 @implementation MMRecordOptions
+
+// Returns a copy that a single request can change without changing the options set by the caller.
+- (MMRecordOptions *)copiedOptions {
+    MMRecordOptions *options = [[MMRecordOptions alloc] init];
+    options.automaticallyPersistsRecords = self.automaticallyPersistsRecords;
+    options.callbackQueue = self.callbackQueue;
+    options.keyPathForResponseObject = self.keyPathForResponseObject;
+    options.isRecordLevelCachingEnabled = self.isRecordLevelCachingEnabled;
+    options.keyPathForMetaData = self.keyPathForMetaData;
+    options.revalidatesCachedResults = self.revalidatesCachedResults;
+    options.fingerprintsResponses = self.fingerprintsResponses;
+    options.coalescesInFlightRequests = self.coalescesInFlightRequests;
+    options.requestPriority = self.requestPriority;
+    options.pageManagerClass = self.pageManagerClass;
+    options.pagePrefetchCount = self.pagePrefetchCount;
+    options.maximumConcurrentPageRequests = self.maximumConcurrentPageRequests;
+    options.deletesOrphanedRecords = self.deletesOrphanedRecords;
+    options.orphanDeletionScopePredicate = self.orphanDeletionScopePredicate;
+    options.decodesOnlyMappedKeyPaths = self.decodesOnlyMappedKeyPaths;
+    options.maximumRelationshipDepth = self.maximumRelationshipDepth;
+    return options;
+}
+
+@end
+
+
+#pragma mark - Import Tasks
+
+@implementation MMRecordImportTask
+@end
+
+
+#pragma mark - Paged Request Pipelining
+
+@implementation MMRecordPipelinedPage
+@end
+
+@implementation MMRecordPagePipeline
+
++ (MMRecordPagePipeline *)pipelineForRecordClass:(Class)recordClass
+                                         options:(MMRecordOptions *)options
+                                         context:(NSManagedObjectContext *)context
+                                          domain:(id)domain
+                                pageManagerBlock:(void (^)(MMServerPageManager *pageManager))pageManagerBlock
+                                     resultBlock:(void (^)(NSArray *records, id pageManager, BOOL *requestNextPage))resultBlock
+                                    failureBlock:(void (^)(NSError *error))failureBlock {
+    MMRecordPagePipeline *pipeline = [MMRecordPagePipeline new];
+    pipeline.recordClass = recordClass;
+    pipeline.options = options;
+    pipeline.context = context;
+    pipeline.domain = domain;
+    pipeline.prefetchCount = options.pagePrefetchCount;
+    pipeline.batched = [recordClass batchRequests];
+    pipeline.dispatchGroup = [recordClass dispatchGroup];
+    pipeline.pageManagerBlock = pageManagerBlock;
+    pipeline.resultBlock = resultBlock;
+    pipeline.failureBlock = failureBlock;
+    pipeline.pages = [NSMutableArray array];
+    
+    return pipeline;
+}
+
+- (void)startWithURN:(NSString *)URN data:(NSDictionary *)data {
+#if NEEDS_DISPATCH_RETAIN_RELEASE
+    dispatch_retain(self.dispatchGroup);
+#endif
+    
+    if ([self isBatched]) {
+        dispatch_group_enter(self.dispatchGroup);
+    }
+    
+    [[self.recordClass server] registerRequest:self forDomain:self.domain];
+    
+    MMRecordPipelinedPage *page = nil;
+    
+    @synchronized(self) {
+        page = [self addPageWithURN:URN data:data];
+    }
+    
+    [self requestPage:page];
+}
+
+- (MMRecordPipelinedPage *)addPageWithURN:(NSString *)URN data:(NSDictionary *)data {
+    MMRecordPipelinedPage *page = [MMRecordPipelinedPage new];
+    page.URN = URN;
+    page.data = data;
+    
+    [self.pages addObject:page];
+    
+    return page;
+}
+
+- (void)requestPage:(MMRecordPipelinedPage *)page {
+    [[self.recordClass server]
+     startRequestWithURN:page.URN
+     data:page.data
+     paged:YES
+     domain:self
+     batched:[self isBatched]
+     dispatchGroup:self.dispatchGroup
+     priority:self.options.requestPriority
+     responseSchema:[self.recordClass responseSchemaWithOptions:self.options context:self.context]
+     responseBlock:^(id responseObject) {
+         MMServerPageManager *pageManager = [[[self.options pageManagerClass] alloc] initWithResponseObject:responseObject
+                                                                                                 requestURN:page.URN
+                                                                                                requestData:page.data
+                                                                                                recordClass:self.recordClass];
+         
+         // Pages are requested one after another, so page managers are passed to this block in order.
+         if (self.pageManagerBlock != nil) {
+             self.pageManagerBlock(pageManager);
+         }
+         
+         @synchronized(self) {
+             page.responseObject = responseObject;
+             page.pageManager = pageManager;
+             page.received = YES;
+         }
+         
+         [self advance];
+     }
+     failureBlock:^(NSError *error) {
+         @synchronized(self) {
+             page.error = error;
+             page.received = YES;
+         }
+         
+         [self advance];
+     }];
+}
+
+// Requests the page after the last one received while the prefetch window allows it, and imports
+// the next page in order once its response has arrived.
+- (void)advance {
+    MMRecordPipelinedPage *pageToRequest = nil;
+    MMRecordPipelinedPage *pageToImport = nil;
+    
+    @synchronized(self) {
+        if ([self isFinished]) {
+            return;
+        }
+        
+        MMRecordPipelinedPage *lastPage = [self.pages lastObject];
+        
+        if ([lastPage isReceived] &&
+            lastPage.error == nil &&
+            [lastPage.pageManager canRequestNextPage] &&
+            [self.pages count] <= self.nextImportIndex + self.prefetchCount) {
+            pageToRequest = [self addPageWithURN:[lastPage.pageManager nextPageURN]
+                                            data:[lastPage.pageManager nextPageData]];
+        }
+        
+        if ([self isImporting] == NO && self.nextImportIndex < [self.pages count]) {
+            MMRecordPipelinedPage *nextPage = [self.pages objectAtIndex:self.nextImportIndex];
+            
+            if ([nextPage isReceived]) {
+                pageToImport = nextPage;
+                self.importing = YES;
+            }
+        }
+    }
+    
+    if (pageToRequest != nil) {
+        [self requestPage:pageToRequest];
+    }
+    
+    if (pageToImport != nil) {
+        [self importPage:pageToImport];
+    }
+}
+
+- (void)importPage:(MMRecordPipelinedPage *)page {
+    if (page.error != nil) {
+        [self failWithError:page.error];
+        return;
+    }
+    
+    Class recordClass = self.recordClass;
+    MMRecordOptions *options = self.options;
+    MMServerPageManager *pageManager = page.pageManager;
+    id responseObject = page.responseObject;
+    
+    MMRecordRequestState *state =
+    [MMRecordRequestState
+     requestStateForURN:page.URN
+     data:page.data
+     context:self.context
+     domain:self.domain
+     customResponseBlock:^id(id JSON) {
+         return pageManager;
+     }
+     resultBlock:^(NSArray *records, id customResponseObject) {
+         BOOL requestNextPage = NO;
+         
+         if (self.resultBlock != nil) {
+             self.resultBlock(records, pageManager, &requestNextPage);
+         }
+         
+         [self didDeliverPageWithPageManager:pageManager requestNextPage:requestNextPage];
+     }
+     failureBlock:^(NSError *error) {
+         if (self.failureBlock != nil) {
+             self.failureBlock(error);
+         }
+         
+         [self finish];
+     }];
+    
+    [recordClass configureState:state forCurrentRequestWithOptions:options];
+    
+    @synchronized(self) {
+        self.importingState = state;
+    }
+    
+    [recordClass scheduleImportWithPriority:options.requestPriority block:^{
+        [recordClass resetErrorHandler];
+        [recordClass completeRequestForResponse:responseObject state:state options:options completionBlock:nil];
+    }];
+}
+
+- (void)didDeliverPageWithPageManager:(MMServerPageManager *)pageManager requestNextPage:(BOOL)requestNextPage {
+    BOOL finished = NO;
+    
+    @synchronized(self) {
+        self.importing = NO;
+        self.importingState = nil;
+        
+        if (requestNextPage && [pageManager canRequestNextPage] && [self isFinished] == NO) {
+            self.nextImportIndex++;
+        } else {
+            self.finished = YES;
+        }
+        
+        finished = [self isFinished];
+    }
+    
+    if (finished) {
+        [self finish];
+    } else {
+        [self advance];
+    }
+}
+
+- (void)failWithError:(NSError *)error {
+    @synchronized(self) {
+        self.finished = YES;
+    }
+    
+    dispatch_async(self.options.callbackQueue, ^{
+        if (self.failureBlock != nil) {
+            self.failureBlock(error);
+        }
+        
+        [self finish];
+    });
+}
+
+// Cancelling the page that is being imported fails it with a cancellation error.  Otherwise the
+// cancellation error is delivered here, and responses for any pages still in flight are dropped.
+- (void)cancel {
+    MMRecordRequestState *importingState = nil;
+    
+    @synchronized(self) {
+        if ([self isFinished]) {
+            return;
+        }
+        
+        self.finished = YES;
+        importingState = self.importingState;
+    }
+    
+    if (importingState != nil) {
+        [importingState cancel];
+    } else {
+        [self failWithError:[self.recordClass cancellationError]];
+    }
+}
+
+- (void)finish {
+    @synchronized(self) {
+        if ([self isCompleted]) {
+            return;
+        }
+        
+        self.finished = YES;
+        self.completed = YES;
+    }
+    
+    [[self.recordClass server] unregisterRequest:self forDomain:self.domain];
+    [[self.recordClass server] cancelRegisteredRequestsForDomain:self];
+    
+    if ([self isBatched]) {
+        dispatch_group_leave(self.dispatchGroup);
+    }
+    
+#if NEEDS_DISPATCH_RETAIN_RELEASE
+    dispatch_release(self.dispatchGroup);
+#endif
+}
+
+@end
+
+@implementation MMRecordPageFanOut
+
++ (MMRecordPageFanOut *)fanOutForRecordClass:(Class)recordClass
+                                     options:(MMRecordOptions *)options
+                                     context:(NSManagedObjectContext *)context
+                                      domain:(id)domain
+                             pageResultBlock:(void (^)(NSArray *records, id pageManager))pageResultBlock
+                             completionBlock:(void (^)(NSArray *records))completionBlock
+                                failureBlock:(void (^)(NSError *error))failureBlock {
+    MMRecordPageFanOut *fanOut = [MMRecordPageFanOut new];
+    fanOut.recordClass = recordClass;
+    fanOut.options = options;
+    fanOut.context = context;
+    fanOut.domain = domain;
+    fanOut.maximumConcurrentRequests = MAX(options.maximumConcurrentPageRequests, 1);
+    fanOut.batched = [recordClass batchRequests];
+    fanOut.dispatchGroup = [recordClass dispatchGroup];
+    fanOut.pageResultBlock = pageResultBlock;
+    fanOut.completionBlock = completionBlock;
+    fanOut.failureBlock = failureBlock;
+    fanOut.pages = [NSMutableArray array];
+    fanOut.importingStates = [NSMutableSet set];
+    
+    return fanOut;
+}
+
+- (void)startWithURN:(NSString *)URN data:(NSDictionary *)data {
+#if NEEDS_DISPATCH_RETAIN_RELEASE
+    dispatch_retain(self.dispatchGroup);
+#endif
+    
+    if ([self isBatched]) {
+        dispatch_group_enter(self.dispatchGroup);
+    }
+    
+    [[self.recordClass server] registerRequest:self forDomain:self.domain];
+    
+    @synchronized(self) {
+        [self addPageWithURN:URN data:data];
+    }
+    
+    [self startPendingRequests];
+}
+
+- (void)addPageWithURN:(NSString *)URN data:(NSDictionary *)data {
+    MMRecordPipelinedPage *page = [MMRecordPipelinedPage new];
+    page.URN = URN;
+    page.data = data;
+    
+    [self.pages addObject:page];
+}
+
+// Adds the pages that can be requested now that the given page has arrived.  The first page adds
+// every other page if the page manager can address them by index.  This must be called with the
+// lock held.
+- (void)addPagesFollowingPage:(MMRecordPipelinedPage *)page {
+    MMServerPageManager *pageManager = page.pageManager;
+    
+    if (page == [self.pages objectAtIndex:0]) {
+        NSString *secondPageURN = [pageManager URNForPageAtIndex:1];
+        
+        if (secondPageURN != nil) {
+            self.addressesPagesByIndex = YES;
+            
+            NSInteger pageCount = [pageManager pageCount];
+            
+            for (NSInteger pageIndex = 1; pageIndex < pageCount; pageIndex++) {
+                [self addPageWithURN:[pageManager URNForPageAtIndex:pageIndex]
+                                data:[pageManager dataForPageAtIndex:pageIndex]];
+            }
+            
+            return;
+        }
+    }
+    
+    if (self.addressesPagesByIndex == NO &&
+        page == [self.pages lastObject] &&
+        [pageManager canRequestNextPage]) {
+        [self addPageWithURN:[pageManager nextPageURN] data:[pageManager nextPageData]];
+    }
+}
+
+- (void)startPendingRequests {
+    NSMutableArray *pagesToRequest = [NSMutableArray array];
+    
+    @synchronized(self) {
+        if ([self isFinished]) {
+            return;
+        }
+        
+        while (self.nextRequestIndex < [self.pages count] &&
+               self.runningRequestCount < self.maximumConcurrentRequests) {
+            [pagesToRequest addObject:[self.pages objectAtIndex:self.nextRequestIndex]];
+            self.nextRequestIndex++;
+            self.runningRequestCount++;
+        }
+    }
+    
+    for (MMRecordPipelinedPage *page in pagesToRequest) {
+        [self requestPage:page];
+    }
+}
+
+- (void)requestPage:(MMRecordPipelinedPage *)page {
+    [[self.recordClass server]
+     startRequestWithURN:page.URN
+     data:page.data
+     paged:YES
+     domain:self
+     batched:[self isBatched]
+     dispatchGroup:self.dispatchGroup
+     priority:self.options.requestPriority
+     responseSchema:[self.recordClass responseSchemaWithOptions:self.options context:self.context]
+     responseBlock:^(id responseObject) {
+         MMServerPageManager *pageManager = [[[self.options pageManagerClass] alloc] initWithResponseObject:responseObject
+                                                                                                 requestURN:page.URN
+                                                                                                requestData:page.data
+                                                                                                recordClass:self.recordClass];
+         
+         @synchronized(self) {
+             if ([self isFinished]) {
+                 return;
+             }
+             
+             page.responseObject = responseObject;
+             page.pageManager = pageManager;
+             page.received = YES;
+             self.runningRequestCount--;
+             
+             [self addPagesFollowingPage:page];
+         }
+         
+         [self startPendingRequests];
+         [self importPage:page];
+     }
+     failureBlock:^(NSError *error) {
+         @synchronized(self) {
+             if ([self isFinished]) {
+                 return;
+             }
+             
+             page.error = error;
+             page.received = YES;
+             self.runningRequestCount--;
+         }
+         
+         [self failWithError:error];
+         [self startPendingRequests];
+     }];
+}
+
+- (void)importPage:(MMRecordPipelinedPage *)page {
+    Class recordClass = self.recordClass;
+    MMRecordOptions *options = self.options;
+    MMServerPageManager *pageManager = page.pageManager;
+    id responseObject = page.responseObject;
+    
+    MMRecordRequestState *state =
+    [MMRecordRequestState
+     requestStateForURN:page.URN
+     data:page.data
+     context:self.context
+     domain:self.domain
+     customResponseBlock:^id(id JSON) {
+         return pageManager;
+     }
+     resultBlock:nil
+     failureBlock:^(NSError *error) {
+         [self deliverError:error];
+     }];
+    
+    __weak MMRecordRequestState *weakState = state;
+    
+    state.resultBlock = ^(NSArray *records, id customResponseObject) {
+        [self didDeliverPage:page records:records state:weakState];
+    };
+    
+    [recordClass configureState:state forCurrentRequestWithOptions:options];
+    
+    @synchronized(self) {
+        [self.importingStates addObject:state];
+    }
+    
+    [recordClass scheduleImportWithPriority:options.requestPriority block:^{
+        [recordClass resetErrorHandler];
+        [recordClass completeRequestForResponse:responseObject state:state options:options completionBlock:nil];
+    }];
+}
+
+// Called on the callback queue.  Pages are reported in the order they were imported, and the
+// completion block is called once every page has been delivered.
+- (void)didDeliverPage:(MMRecordPipelinedPage *)page records:(NSArray *)records state:(MMRecordRequestState *)state {
+    NSMutableArray *allRecords = nil;
+    
+    @synchronized(self) {
+        if (state != nil) {
+            [self.importingStates removeObject:state];
+        }
+        
+        if ([self isFinished]) {
+            return;
+        }
+        
+        page.records = records;
+        page.delivered = YES;
+        
+        BOOL allPagesDelivered = YES;
+        
+        for (MMRecordPipelinedPage *otherPage in self.pages) {
+            if ([otherPage isDelivered] == NO) {
+                allPagesDelivered = NO;
+                break;
+            }
+        }
+        
+        if (allPagesDelivered) {
+            self.finished = YES;
+            allRecords = [NSMutableArray array];
+            
+            for (MMRecordPipelinedPage *deliveredPage in self.pages) {
+                [allRecords addObjectsFromArray:deliveredPage.records];
+            }
+        }
+    }
+    
+    if (self.pageResultBlock != nil) {
+        self.pageResultBlock(records, page.pageManager);
+    }
+    
+    if (allRecords != nil) {
+        if (self.completionBlock != nil) {
+            self.completionBlock(allRecords);
+        }
+        
+        [self finish];
+    }
+}
+
+- (void)failWithError:(NSError *)error {
+    dispatch_async(self.options.callbackQueue, ^{
+        [self deliverError:error];
+    });
+}
+
+// Called on the callback queue.  Only the first error is delivered, and the imports of any other
+// pages are cancelled.
+- (void)deliverError:(NSError *)error {
+    NSArray *importingStates = nil;
+    
+    @synchronized(self) {
+        if ([self isFinished]) {
+            return;
+        }
+        
+        self.finished = YES;
+        importingStates = [self.importingStates allObjects];
+        [self.importingStates removeAllObjects];
+    }
+    
+    for (MMRecordRequestState *state in importingStates) {
+        [state cancel];
+    }
+    
+    if (self.failureBlock != nil) {
+        self.failureBlock(error);
+    }
+    
+    [self finish];
+}
+
+- (void)cancel {
+    [self failWithError:[self.recordClass cancellationError]];
+}
+
+- (void)finish {
+    @synchronized(self) {
+        if ([self isCompleted]) {
+            return;
+        }
+        
+        self.finished = YES;
+        self.completed = YES;
+    }
+    
+    [[self.recordClass server] unregisterRequest:self forDomain:self.domain];
+    [[self.recordClass server] cancelRegisteredRequestsForDomain:self];
+    
+    if ([self isBatched]) {
+        dispatch_group_leave(self.dispatchGroup);
+    }
+    
+#if NEEDS_DISPATCH_RETAIN_RELEASE
+    dispatch_release(self.dispatchGroup);
+#endif
+}
+
 @end
 
 #undef MMRLogInfo
@@ -22,6 +22,11 @@
 
 #import <CoreData/CoreData.h>
 
+/*
+ The key used to store a response fingerprint in the validators dictionary of a cache entry.
+ */
+extern NSString * const MMRecordCacheFingerprintKey;
+
 /*
  This class encapsulates the functionality for caching managed objects in correspondence to a 
  particular NSURLRequest's NSCachedURLResponse. It is meant to be a private class used by MMRecord 
@@ -65,6 +70,33 @@
                        metaKeyPath:(NSString *)metaKeyPath
                            context:(NSManagedObjectContext *)context
                   cacheResultBlock:(void(^)(NSArray *cachedResults, id responseObject))cacheResultBlock;
+
+/*
+ This method retrieves cached results that the server has revalidated, such as for a request that
+ returned 304 Not Modified. Unlike the method above it does not consult the NSURLCache's caching 
+ policy, since the server has just confirmed that the response is current. The cache result block 
+ is always called. The cached results passed to it will be nil if any of the cached records no 
+ longer exist in the provided context, in which case the request should be made again in full.
+ */
++ (void)getRevalidatedResultsForRequest:(NSURLRequest *)request
+                               cacheKey:(NSString *)cacheKey
+                            metaKeyPath:(NSString *)metaKeyPath
+                                context:(NSManagedObjectContext *)context
+                       cacheResultBlock:(void(^)(NSArray *cachedResults, id responseObject))cacheResultBlock;
+
+/*
+ This method returns the cache validators, such as the ETag and Last-Modified values, that were 
+ stored with the cached records for a given key. Returns nil if there is no entry for that key.
+ */
++ (NSDictionary *)validatorsForKey:(NSString *)cacheKey;
+
+/*
+ This method returns a SHA-256 fingerprint of a parsed response object. Dictionaries are hashed in 
+ sorted key order so that two responses with the same contents have the same fingerprint, regardless
+ of the order in which the server serialized them.
+ */
++ (NSString *)fingerprintForResponseObject:(id)responseObject;
+
 /*
  This method caches the objectIDs of the given records. Those records should be subclasses of 
  NSManagedObjectContext. The key provided will be used to locate those records later if a subsequent
@@ -75,4 +107,32 @@
               forKey:(NSString *)key
          fromContext:(NSManagedObjectContext *)context;
 
+/*
+ This method caches the objectIDs of the given records along with the cache validators from the 
+ response they were parsed from. The validators will be returned by validatorsForKey: so that they
+ can be sent with the next conditional request for that key.
+ */
++ (void)cacheRecords:(NSArray *)records
+        withMetadata:(NSDictionary *)metadata
+          validators:(NSDictionary *)validators
+              forKey:(NSString *)key
+         fromContext:(NSManagedObjectContext *)context;
+
+/*
+ This method stores a checkpoint for a given key, replacing any checkpoint that was stored for that 
+ key before. Checkpoints are used to resume a paged sync that was interrupted, and are saved to the 
+ cache persistent store before this method returns.
+ */
++ (void)saveCheckpoint:(NSDictionary *)checkpoint forKey:(NSString *)key;
+
+/*
+ This method returns the checkpoint stored for a given key, or nil if there is none.
+ */
++ (NSDictionary *)checkpointForKey:(NSString *)key;
+
+/*
+ This method deletes the checkpoint stored for a given key, if there is one.
+ */
++ (void)deleteCheckpointForKey:(NSString *)key;
+
 @end
@@ -23,6 +23,11 @@
 
 #import "MMRecordCache.h"
 #import "MMRecordLoggers.h"
+#import "MMServer.h"
+
+#import <CommonCrypto/CommonDigest.h>
+
+NSString * const MMRecordCacheFingerprintKey = @"MMRecordCacheFingerprint";
 
 // This class contains a managed object context intended for use with caching records for a given request/response.
 @interface MMRecordCacheDataManager : NSObject
@@ -44,6 +49,7 @@
 
 @property (nonatomic, copy) NSString *key;
 @property (nonatomic, strong) id metadata;
+@property (nonatomic, strong) NSDictionary *validators;
 @property (nonatomic, strong) NSOrderedSet *cacheObjects;
 
 @end
@@ -58,6 +64,15 @@
 @end
 
 
+// This class represents a checkpoint for a paged sync.
+@interface MMRecordCacheCheckpoint : NSManagedObject
+
+@property (nonatomic, copy) NSString *key;
+@property (nonatomic, strong) NSDictionary *checkpoint;
+
+@end
+
+
 @implementation MMRecordCache
 
 + (BOOL)hasResultsForKey:(NSString *)cacheKey {
@@ -89,12 +104,125 @@
                                                    metaKeyPath:metaKeyPath
                                                        context:context
                                               cacheResultBlock:cacheResultBlock];
-        } else {
+        } else if (cacheEntry.validators == nil) {
+            // Entries with validators are kept so that they can still be revalidated by the server.
             [self deleteCacheEntryForKey:cacheKey];
         }
     }
 }
 
++ (void)getRevalidatedResultsForRequest:(NSURLRequest *)request
+                               cacheKey:(NSString *)cacheKey
+                            metaKeyPath:(NSString *)metaKeyPath
+                                context:(NSManagedObjectContext *)context
+                       cacheResultBlock:(void(^)(NSArray *cachedResults, id responseObject))cacheResultBlock {
+    MMRecordCacheEntry *cacheEntry = [self fetchCacheEntryForKey:cacheKey];
+    
+    NSArray *cachedResults = nil;
+    id customResponseObject = nil;
+    
+    if (cacheEntry != nil) {
+        cachedResults = [self fetchRecordsWithCacheEntry:cacheEntry
+                                                sortedBy:nil
+                                               ascending:NO
+                                               inContext:context];
+        
+        // A partial result set would silently drop records from the response, so treat it as a miss.
+        if ([cachedResults count] != [cacheEntry.cacheObjects count]) {
+            cachedResults = nil;
+        }
+        
+        NSCachedURLResponse *cachedResponse = [[NSURLCache sharedURLCache] cachedResponseForRequest:request];
+        
+        customResponseObject = [self customResponseObjectForCacheEntry:cacheEntry
+                                                        cachedResponse:cachedResponse
+                                                           metaKeyPath:metaKeyPath];
+    }
+    
+    if (cacheResultBlock != nil) {
+        cacheResultBlock(cachedResults, customResponseObject);
+    }
+}
+
++ (NSDictionary *)validatorsForKey:(NSString *)cacheKey {
+    MMRecordCacheEntry *cacheEntry = [self fetchCacheEntryForKey:cacheKey];
+    
+    if (cacheEntry == nil) {
+        return nil;
+    }
+    
+    NSManagedObjectContext *mmContext = [[MMRecordCacheDataManager sharedInstance] managedObjectContext];
+    
+    __block NSDictionary *validators = nil;
+    [mmContext performBlockAndWait:^{
+        validators = cacheEntry.validators;
+    }];
+    
+    return validators;
+}
+
++ (NSString *)fingerprintForResponseObject:(id)responseObject {
+    CC_SHA256_CTX context;
+    CC_SHA256_Init(&context);
+    
+    [self updateFingerprintContext:&context withObject:responseObject];
+    
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256_Final(digest, &context);
+    
+    NSMutableString *fingerprint = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH * 2];
+    
+    for (NSInteger i = 0; i < CC_SHA256_DIGEST_LENGTH; i++) {
+        [fingerprint appendFormat:@"%02x", digest[i]];
+    }
+    
+    return fingerprint;
+}
+
+// Every value is prefixed with a type tag and containers with their count, so that different
+// structures can never produce the same stream of bytes.
++ (void)updateFingerprintContext:(CC_SHA256_CTX *)context withObject:(id)object {
+    if ([object isKindOfClass:[NSDictionary class]]) {
+        NSArray *keys = [[object allKeys] sortedArrayUsingSelector:@selector(compare:)];
+        
+        [self updateFingerprintContext:context withTag:'d' count:[keys count]];
+        
+        for (id key in keys) {
+            [self updateFingerprintContext:context withObject:key];
+            [self updateFingerprintContext:context withObject:[object objectForKey:key]];
+        }
+    } else if ([object isKindOfClass:[NSArray class]]) {
+        [self updateFingerprintContext:context withTag:'a' count:[object count]];
+        
+        for (id element in object) {
+            [self updateFingerprintContext:context withObject:element];
+        }
+    } else if ([object isKindOfClass:[NSString class]]) {
+        NSData *data = [object dataUsingEncoding:NSUTF8StringEncoding];
+        
+        [self updateFingerprintContext:context withTag:'s' count:[data length]];
+        CC_SHA256_Update(context, [data bytes], (CC_LONG)[data length]);
+    } else if ([object isKindOfClass:[NSNumber class]]) {
+        const char *type = [object objCType];
+        NSData *data = [[object stringValue] dataUsingEncoding:NSUTF8StringEncoding];
+        
+        [self updateFingerprintContext:context withTag:'n' count:[data length]];
+        CC_SHA256_Update(context, type, (CC_LONG)strlen(type));
+        CC_SHA256_Update(context, [data bytes], (CC_LONG)[data length]);
+    } else if (object == nil || object == [NSNull null]) {
+        [self updateFingerprintContext:context withTag:'0' count:0];
+    } else {
+        [self updateFingerprintContext:context withObject:[object description]];
+    }
+}
+
++ (void)updateFingerprintContext:(CC_SHA256_CTX *)context withTag:(char)tag count:(NSUInteger)count {
+    uint64_t length = count;
+    
+    CC_SHA256_Update(context, &tag, 1);
+    CC_SHA256_Update(context, &length, sizeof(length));
+}
+
 + (void)completeRequestForCachedResultsForCacheEntry:(MMRecordCacheEntry *)cacheEntry
                                       cachedResponse:(NSCachedURLResponse *)cachedResponse
                                          metaKeyPath:(NSString *)metaKeyPath
@@ -124,9 +252,10 @@
     } else if (cachedResponse.data != nil) {    // If the cached url response has a response body.
         NSError *error = nil;
         
-        customResponseObject = [NSJSONSerialization JSONObjectWithData:cachedResponse.data
-                                                               options:NSJSONReadingMutableContainers
-                                                                 error:&error];
+        // The body is decoded the same way it was when the response was first received.
+        customResponseObject = [MMServer responseObjectWithData:cachedResponse.data
+                                                    contentType:[cachedResponse.response MIMEType]
+                                                          error:&error];
     }
     
     return customResponseObject;
@@ -136,6 +265,18 @@
         withMetadata:(NSDictionary *)metadata
               forKey:(NSString *)key
          fromContext:(NSManagedObjectContext *)context {
+    [self cacheRecords:records
+          withMetadata:metadata
+            validators:nil
+                forKey:key
+           fromContext:context];
+}
+
++ (void)cacheRecords:(NSArray *)records
+        withMetadata:(NSDictionary *)metadata
+          validators:(NSDictionary *)validators
+              forKey:(NSString *)key
+         fromContext:(NSManagedObjectContext *)context {
     NSManagedObject *anyRecord = records.lastObject;
     
     if (anyRecord.objectID.isTemporaryID) {
@@ -154,6 +295,7 @@
                                                                        inManagedObjectContext:cacheContext];
         cacheEntry.key = key;
         cacheEntry.metadata = metadata;
+        cacheEntry.validators = validators;
 
         for (NSManagedObject *record in records) {
             [self insertCacheObjectWithRecord:record intoContext:cacheContext cacheEntry:cacheEntry];
@@ -165,6 +307,64 @@
     });
 }
 
++ (void)saveCheckpoint:(NSDictionary *)checkpoint forKey:(NSString *)key {
+    NSManagedObjectContext *cacheContext = [[MMRecordCacheDataManager sharedInstance] managedObjectContext];
+    
+    [cacheContext performBlockAndWait:^{
+        MMRecordCacheCheckpoint *cacheCheckpoint = [self fetchCheckpointForKey:key inContext:cacheContext];
+        
+        if (cacheCheckpoint == nil) {
+            cacheCheckpoint = [NSEntityDescription insertNewObjectForEntityForName:NSStringFromClass([MMRecordCacheCheckpoint class])
+                                                            inManagedObjectContext:cacheContext];
+            cacheCheckpoint.key = key;
+        }
+        
+        cacheCheckpoint.checkpoint = checkpoint;
+        
+        NSError *error = nil;
+        
+        if ([cacheContext save:&error] == NO) {
+            MMRLogError(@"Failed to save checkpoint for key %@: %@", key, error);
+        }
+    }];
+}
+
++ (NSDictionary *)checkpointForKey:(NSString *)key {
+    NSManagedObjectContext *cacheContext = [[MMRecordCacheDataManager sharedInstance] managedObjectContext];
+    
+    __block NSDictionary *checkpoint = nil;
+    [cacheContext performBlockAndWait:^{
+        checkpoint = [[self fetchCheckpointForKey:key inContext:cacheContext] checkpoint];
+    }];
+    
+    return checkpoint;
+}
+
++ (void)deleteCheckpointForKey:(NSString *)key {
+    NSManagedObjectContext *cacheContext = [[MMRecordCacheDataManager sharedInstance] managedObjectContext];
+    
+    [cacheContext performBlockAndWait:^{
+        MMRecordCacheCheckpoint *cacheCheckpoint = [self fetchCheckpointForKey:key inContext:cacheContext];
+        
+        if (cacheCheckpoint != nil) {
+            [cacheContext deleteObject:cacheCheckpoint];
+            [cacheContext save:NULL];
+        }
+    }];
+}
+
+// This must be called on the cache context's queue.
++ (MMRecordCacheCheckpoint *)fetchCheckpointForKey:(NSString *)key inContext:(NSManagedObjectContext *)context {
+    NSFetchRequest *request = [[NSFetchRequest alloc] initWithEntityName:NSStringFromClass([MMRecordCacheCheckpoint class])];
+    request.predicate = [NSPredicate predicateWithFormat:@"self.key = %@", key];
+    request.fetchLimit = 1;
+    
+    NSError *error = nil;
+    NSArray *results = [context executeFetchRequest:request error:&error];
+    
+    return [results lastObject];
+}
+
 + (void)insertCacheObjectWithRecord:(NSManagedObject *)record
                         intoContext:(NSManagedObjectContext *)context
                          cacheEntry:(MMRecordCacheEntry *)cacheEntry {
@@ -186,9 +386,9 @@
     }
 }
 
-+ (NSPredicate *)buildRecordPredicateWithCacheObjects:(NSArray *)cacheObjects
-                                            inContext:(NSManagedObjectContext *)context {
-    NSMutableArray *objectIDs = [NSMutableArray array];
++ (NSDictionary *)objectIDsByEntityNameWithCacheObjects:(NSArray *)cacheObjects
+                                              inContext:(NSManagedObjectContext *)context {
+    NSMutableDictionary *objectIDsByEntityName = [NSMutableDictionary dictionary];
     
     for (MMRecordCacheObject *cacheObject in cacheObjects) {
         NSURL *url = [NSURL URLWithString:cacheObject.objectURL];
@@ -196,11 +396,19 @@
         NSManagedObjectID *objectID = [context.persistentStoreCoordinator managedObjectIDForURIRepresentation:url];
         
         if (objectID != nil) {
+            NSString *entityName = [[objectID entity] name];
+            NSMutableArray *objectIDs = [objectIDsByEntityName objectForKey:entityName];
+            
+            if (objectIDs == nil) {
+                objectIDs = [NSMutableArray array];
+                [objectIDsByEntityName setObject:objectIDs forKey:entityName];
+            }
+            
             [objectIDs addObject:objectID];
         }
     }
     
-    return [NSPredicate predicateWithFormat:@"self IN %@", objectIDs];
+    return objectIDsByEntityName;
 }
 
 + (MMRecordCacheEntry *)fetchCacheEntryForKey:(NSString *)key {
@@ -256,7 +464,12 @@
                                     inContext:context];
     }
     
-    if (results != nil) {
+    // Without a sort term the records are returned in the order they were cached.  Otherwise the
+    // records of each entity were fetched sorted, and are sorted again as a whole.
+    if (results != nil && sortTerm.length > 0) {
+        NSSortDescriptor *sortBy = [[NSSortDescriptor alloc] initWithKey:sortTerm ascending:ascending];
+        results = [results sortedArrayUsingDescriptors:@[sortBy]];
+    } else if (results != nil) {
         results = [self resultsSortedInOriginalCachedOrderFromResults:results
                                                            cacheEntry:cacheEntry];
     }
@@ -268,26 +481,30 @@
                           sortedBy:(NSString *)sortTerm
                          ascending:(BOOL)ascending
                          inContext:(NSManagedObjectContext *)context {
-    NSArray *results = nil;
-    
-    NSEntityDescription *entity = [NSEntityDescription entityForName:NSStringFromClass([self class])
-                                              inManagedObjectContext:context];
-    
-    NSFetchRequest *request = [[NSFetchRequest alloc] init];
-    [request setEntity:entity];
+    NSMutableArray *results = [NSMutableArray array];
     
-    request.predicate = [self buildRecordPredicateWithCacheObjects:[cacheEntry.cacheObjects array]
-                                                         inContext:context];
+    // A cache entry may contain records of several entities, such as sub entities of the requested
+    // record class, so they are fetched one entity at a time.
+    NSDictionary *objectIDsByEntityName = [self objectIDsByEntityNameWithCacheObjects:[cacheEntry.cacheObjects array]
+                                                                            inContext:context];
     
-    if (sortTerm.length > 0) {
-        NSSortDescriptor *sortBy = [[NSSortDescriptor alloc] initWithKey:sortTerm ascending:ascending];
-        request.sortDescriptors = @[sortBy];
+    for (NSString *entityName in objectIDsByEntityName) {
+        NSFetchRequest *request = [[NSFetchRequest alloc] initWithEntityName:entityName];
+        request.predicate = [NSPredicate predicateWithFormat:@"self IN %@", [objectIDsByEntityName objectForKey:entityName]];
+        
+        if (sortTerm.length > 0) {
+            NSSortDescriptor *sortBy = [[NSSortDescriptor alloc] initWithKey:sortTerm ascending:ascending];
+            request.sortDescriptors = @[sortBy];
+        }
+        
+        NSError *error = nil;
+        NSArray *entityResults = [context executeFetchRequest:request error:&error];
+        
+        if (entityResults != nil) {
+            [results addObjectsFromArray:entityResults];
+        }
     }
     
-    NSError *error = nil;
-    
-    results = [context executeFetchRequest:request error:&error];
-    
     return results;
 }
 
@@ -342,6 +559,12 @@
     metadataAttribute.attributeType = NSTransformableAttributeType;
     [metadataAttribute setIndexed:NO];
     
+    NSAttributeDescription *validatorsAttribute = [[NSAttributeDescription alloc] init];
+    validatorsAttribute.name = @"validators";
+    validatorsAttribute.attributeType = NSTransformableAttributeType;
+    [validatorsAttribute setOptional:YES];
+    [validatorsAttribute setIndexed:NO];
+    
     // MMRecordCacheObject
     NSEntityDescription *cacheObjectEntity = [[NSEntityDescription alloc] init];
     cacheObjectEntity.name = @"MMRecordCacheObject";
@@ -372,10 +595,28 @@
     cacheEntryRelationship.inverseRelationship = cacheObjectsRelationship;
     cacheObjectsRelationship.inverseRelationship = cacheEntryRelationship;
     
-    [cacheEntryEntity setProperties:[NSArray arrayWithObjects:keyAttribute, metadataAttribute, cacheObjectsRelationship, nil]];
+    // MMRecordCacheCheckpoint
+    NSEntityDescription *checkpointEntity = [[NSEntityDescription alloc] init];
+    checkpointEntity.name = @"MMRecordCacheCheckpoint";
+    checkpointEntity.managedObjectClassName = @"MMRecordCacheCheckpoint";
+    
+    NSAttributeDescription *checkpointKeyAttribute = [[NSAttributeDescription alloc] init];
+    checkpointKeyAttribute.name = @"key";
+    checkpointKeyAttribute.attributeType = NSStringAttributeType;
+    [checkpointKeyAttribute setOptional:NO];
+    [checkpointKeyAttribute setIndexed:YES];
+    
+    NSAttributeDescription *checkpointAttribute = [[NSAttributeDescription alloc] init];
+    checkpointAttribute.name = @"checkpoint";
+    checkpointAttribute.attributeType = NSTransformableAttributeType;
+    [checkpointAttribute setOptional:YES];
+    [checkpointAttribute setIndexed:NO];
+    
+    [cacheEntryEntity setProperties:[NSArray arrayWithObjects:keyAttribute, metadataAttribute, validatorsAttribute, cacheObjectsRelationship, nil]];
     [cacheObjectEntity setProperties:[NSArray arrayWithObjects:objectURLEntity, cacheEntryRelationship, nil]];
+    [checkpointEntity setProperties:[NSArray arrayWithObjects:checkpointKeyAttribute, checkpointAttribute, nil]];
     
-    [_managedObjectModel setEntities:[NSArray arrayWithObjects:cacheEntryEntity, cacheObjectEntity, nil]];
+    [_managedObjectModel setEntities:[NSArray arrayWithObjects:cacheEntryEntity, cacheObjectEntity, checkpointEntity, nil]];
     
     return _managedObjectModel;
 }
@@ -433,11 +674,32 @@
     NSURL *url = [self persistenceStoreURL];
     NSError *error = nil;
     
+    // Checkpoints cannot be rebuilt from the network, so stores created with an older version of the
+    // cache model are migrated rather than replaced whenever possible.
+    NSDictionary *options = @{NSMigratePersistentStoresAutomaticallyOption : @YES,
+                              NSInferMappingModelAutomaticallyOption : @YES};
+    
     NSPersistentStore *store = [_persistentStoreCoordinator addPersistentStoreWithType:NSSQLiteStoreType
                                                                          configuration:nil
                                                                                    URL:url
-                                                                               options:nil
+                                                                               options:options
                                                                                  error:&error];
+    
+    // A store that cannot be opened or migrated is simply replaced.  At worst a sync that was 
+    // interrupted will start over from its first page.
+    if (store == nil && url != nil) {
+        MMRLogWarn(@"Recreating MMRecord internal persistence store: %@", error);
+        
+        [self removePersistentStoreFilesAtURL:url];
+        
+        error = nil;
+        store = [_persistentStoreCoordinator addPersistentStoreWithType:NSSQLiteStoreType
+                                                          configuration:nil
+                                                                    URL:url
+                                                                options:options
+                                                                  error:&error];
+    }
+    
     if (store == nil) {
         MMRLogError(@"Failed to create MMRecord internal persistence store: %@", error);
     }
@@ -445,6 +707,19 @@
     return _persistentStoreCoordinator;
 }
 
+- (void)removePersistentStoreFilesAtURL:(NSURL *)url {
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSString *path = [url path];
+    
+    for (NSString *suffix in @[@"", @"-wal", @"-shm"]) {
+        NSString *filePath = [path stringByAppendingString:suffix];
+        
+        if ([fileManager fileExistsAtPath:filePath]) {
+            [fileManager removeItemAtPath:filePath error:NULL];
+        }
+    }
+}
+
 // Returns the managed object context for the application (which is already bound to the persistent store coordinator for the application.)
 - (NSManagedObjectContext *)managedObjectContext {
     if (_managedObjectContext) {
@@ -493,6 +768,7 @@ static MMRecordCacheDataManager *sharedInstance_ = nil;
 
 @dynamic key;
 @dynamic metadata;
+@dynamic validators;
 @dynamic cacheObjects;
 
 @end
@@ -506,6 +782,15 @@ static MMRecordCacheDataManager *sharedInstance_ = nil;
 
 @end
 
+
+// This class represents a checkpoint for a paged sync.
+@implementation MMRecordCacheCheckpoint
+
+@dynamic key;
+@dynamic checkpoint;
+
+@end
+
 #undef MMRLogInfo
 #undef MMRLogWarn
 #undef MMRLogError
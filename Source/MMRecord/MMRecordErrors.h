@@ -34,5 +34,6 @@ typedef NS_ENUM(NSInteger, MMRecordErrorCode) {
     MMRecordErrorCodeInvalidEntityDescription = 4,
     MMRecordErrorCodeCoreDataFetchError       = 5,
     MMRecordErrorCodeInvalidResponseFormat    = 6,
+    MMRecordErrorCodeRequestCancelled         = 7,
     MMRecordErrorCodeUnknown                  = 999
 };
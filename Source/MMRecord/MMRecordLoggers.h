@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#import <Foundation/Foundation.h>
+
 #ifdef LOG_VERBOSE
 #define MMRLogInfo(fmt, ...) DDLogInfo((@"--[MMRecord INFO]-- %s [Line %d] " fmt), __PRETTY_FUNCTION__, __LINE__, ##__VA_ARGS__);
 #define MMRLogWarn(fmt, ...) DDLogWarn((@"--[MMRecord WARNING]-- %s [Line %d] " fmt), __PRETTY_FUNCTION__, __LINE__, ##__VA_ARGS__);
@@ -36,4 +38,41 @@
 #define MMRecordLumberjack 1
 #else
 #define MMRecordLumberjack 0
-#endif
\ No newline at end of file
+#endif
+
+/*
+ Tracing records binary events for the phases of each request and import into a fixed size ring 
+ buffer, which can be written to a file on demand with +[MMRecord writeTraceToFile:error:].  Recording
+ an event takes no locks and does no string formatting, so tracing can be left on in production.  
+ Define MMRecordTracing as 0 to compile tracing out entirely.
+ */
+#ifndef MMRecordTracing
+#define MMRecordTracing 1
+#endif
+
+typedef NS_ENUM(uint8_t, MMRecordTraceEventKind) {
+    MMRecordTraceEventKindBegin = 0,
+    MMRecordTraceEventKindEnd = 1,
+    MMRecordTraceEventKindMark = 2
+};
+
+typedef NS_ENUM(uint8_t, MMRecordTracePhase) {
+    MMRecordTracePhaseRequest = 0,
+    MMRecordTracePhaseImport = 1,
+    MMRecordTracePhaseBuildProtoRecords = 2,
+    MMRecordTracePhaseObtainRecords = 3,
+    MMRecordTracePhasePopulateRecords = 4,
+    MMRecordTracePhaseEstablishRelationships = 5,
+    MMRecordTracePhaseError = 6
+};
+
+#if MMRecordTracing
+extern void MMRecordTraceEvent(MMRecordTraceEventKind kind,
+                               MMRecordTracePhase phase,
+                               uint32_t requestIdentifier,
+                               NSString *entityName,
+                               uint64_t count);
+#define MMRTrace(kind, phase, requestIdentifier, entityName, count) MMRecordTraceEvent((kind), (phase), (requestIdentifier), (entityName), (count))
+#else
+#define MMRTrace(kind, phase, requestIdentifier, entityName, count)
+#endif
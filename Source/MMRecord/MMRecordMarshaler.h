@@ -145,6 +145,9 @@
  @discussion The base implementation of this method supports all types of attributes, including date 
  and transformable. Populating a transformable attribute will invoke a NSValueTransformer subclass 
  as defined in the Core Data model.
+ @discussion Values decoded from binary response formats are supported as well.  NSDate values are 
+ set on date attributes as they are, and NSData values are set on binary data attributes as they are
+ and decoded as UTF-8 for string attributes.
  */
 + (void)setValue:(id)rawValue
         onRecord:(MMRecord *)record
@@ -170,4 +173,48 @@
                    fromRecord:(MMRecord *)fromRecord
                      toRecord:(MMRecord *)toRecord;
 
+/**
+ This method is designed to be subclassed. It is called by +establishRelationshipsOnProtoRecord: to
+ establish a given relationship from one record to all of the records it is related to in the 
+ response. The default implementation applies all of the records to a to-many relationship in a 
+ single mutation. The records are either added to the relationship's existing records or replace 
+ them, as determined by +shouldReplaceExistingRecordsForRelationship:.
+ 
+ @param relationship The relationship to be established.
+ @param fromRecord The record to establish the relationship from.
+ @param toRecords The records to establish the relationship to, in the order they appear in the 
+ response.  This is empty if the response contains an empty array for the relationship, which 
+ empties a relationship whose existing records are replaced and leaves any other relationship alone.
+ @discussion If a subclass overrides +establishRelationship:fromRecord:toRecord:, that method is
+ called for each of the records instead so that the subclass's behavior is preserved.
+ */
++ (void)establishRelationship:(NSRelationshipDescription *)relationship
+                   fromRecord:(MMRecord *)fromRecord
+                    toRecords:(NSArray *)toRecords;
+
+/**
+ This method is designed to be subclassed. It determines whether the records in a response replace
+ the existing contents of a to-many relationship, or are added to them. The default implementation
+ returns the value of MMRecordRelationshipReplacesExistingRecordsKey in the relationship's user info
+ dictionary, and NO if it is not set.
+ 
+ @param relationship The to-many relationship being established.
+ @return YES to replace the relationship's existing records, NO to add to them.
+ */
++ (BOOL)shouldReplaceExistingRecordsForRelationship:(NSRelationshipDescription *)relationship;
+
+/**
+ This method is designed to be subclassed. It determines whether records from a response may be 
+ linked to a to-many relationship without faulting it in. The to-many relationship must have a 
+ to-one inverse, which is set on each record instead. The default implementation returns the value 
+ of MMRecordRelationshipLinksWithoutFaultingKey in the relationship's user info dictionary, and NO 
+ if it is not set.
+ 
+ @param relationship The to-many relationship that records are being linked to.
+ @return YES to leave the relationship as a fault while linking records to it, NO otherwise.
+ @discussion A relationship that is already loaded, that is ordered, or whose record belongs to a 
+ child context is always linked through the to-many relationship itself.
+ */
++ (BOOL)shouldLinkWithoutFaultingRelationship:(NSRelationshipDescription *)relationship;
+
 @end
@@ -26,6 +26,10 @@
 #import "MMRecordProtoRecord.h"
 #import "MMRecordRepresentation.h"
 
+// The key in a context's user info dictionary for the records whose to-many relationship was linked
+// without faulting it in.  MMRecord refreshes them in the main context once the context is saved.
+extern NSString * const MMRecordContextRecordsLinkedWithoutFaultingKey;
+
 @implementation MMRecordMarshaler
 
 + (void)populateProtoRecord:(MMRecordProtoRecord *)protoRecord {
@@ -92,11 +96,16 @@
 + (NSDate *)dateValueForAttribute:(NSAttributeDescription *)attribute
                             value:(id)value
                     dateFormatter:(NSDateFormatter *)dateFormatter {
+    // Binary response formats such as MessagePack and CBOR can carry dates natively.
+    if ([value isKindOfClass:[NSDate class]]) {
+        return value;
+    }
+    
     if ([value isKindOfClass:[NSNumber class]]) {
         return [NSDate dateWithTimeIntervalSince1970:[value integerValue]];
     }
     
-    if (dateFormatter != nil) {
+    if (dateFormatter != nil && [value isKindOfClass:[NSString class]]) {
         return [dateFormatter dateFromString:value];
     }
     
@@ -118,6 +127,14 @@
         return @([value intValue]);
     }
     
+    if ([value isKindOfClass:[NSDate class]]) {
+        return @((long long)[value timeIntervalSince1970]);
+    }
+    
+    if ([value isKindOfClass:[NSNumber class]] == NO) {
+        return nil;
+    }
+    
     return value;
 }
 
@@ -130,56 +147,248 @@
 }
 
 + (NSString *)stringValueForAttribute:(NSAttributeDescription *)attribute value:(id)value {
-    if (value != nil && ![value isKindOfClass:[NSString class]]) {
+    if (value == nil || [value isKindOfClass:[NSString class]]) {
+        return value;
+    }
+    
+    // Binary response formats may send text as a binary value.
+    if ([value isKindOfClass:[NSData class]]) {
+        return [[NSString alloc] initWithData:value encoding:NSUTF8StringEncoding];
+    }
+    
+    if ([value respondsToSelector:@selector(stringValue)]) {
         return [value stringValue];
     }
     
-    return value;
+    return nil;
 }
 
 + (void)establishRelationshipsOnProtoRecord:(MMRecordProtoRecord *)protoRecord {
+    MMRecord *fromRecord = protoRecord.record;
+    
     for (NSRelationshipDescription *relationshipDescription in protoRecord.relationshipDescriptions) {
         NSArray *relationshipProtoRecords = [protoRecord relationshipProtoRecordsForRelationshipDescription:relationshipDescription];
+        NSMutableArray *toRecords = [NSMutableArray arrayWithCapacity:[relationshipProtoRecords count]];
         
         for (MMRecordProtoRecord *relationshipProtoRecord in relationshipProtoRecords) {
-            MMRecord *fromRecord = protoRecord.record;
             MMRecord *toRecord = relationshipProtoRecord.record;
             
-            [self establishRelationship:relationshipDescription fromRecord:fromRecord toRecord:toRecord];
+            if (toRecord != nil) {
+                [toRecords addObject:toRecord];
+            }
         }
+        
+        [self establishRelationship:relationshipDescription fromRecord:fromRecord toRecords:toRecords];
     }
 }
 
++ (void)establishRelationship:(NSRelationshipDescription *)relationship
+                   fromRecord:(MMRecord *)fromRecord
+                    toRecords:(NSArray *)toRecords {
+    if (fromRecord == nil) {
+        return;
+    }
+    
+    // An empty array replaces the existing records with none, but is not added to a relationship.
+    if ([toRecords count] == 0) {
+        if ([relationship isToMany] && [self shouldReplaceExistingRecordsForRelationship:relationship]) {
+            [self establishToManyRelationship:relationship
+                                   fromRecord:fromRecord
+                                    toRecords:toRecords
+                      replacesExistingRecords:YES];
+        }
+        
+        return;
+    }
+    
+    // Subclasses that customize how a single relationship is established keep being called for
+    // each record.
+    if ([relationship isToMany] == NO || [self overridesEstablishRelationship]) {
+        for (MMRecord *toRecord in toRecords) {
+            [self establishRelationship:relationship fromRecord:fromRecord toRecord:toRecord];
+        }
+        
+        return;
+    }
+    
+    [self establishToManyRelationship:relationship
+                           fromRecord:fromRecord
+                            toRecords:toRecords
+              replacesExistingRecords:[self shouldReplaceExistingRecordsForRelationship:relationship]];
+}
+
++ (BOOL)overridesEstablishRelationship {
+    SEL selector = @selector(establishRelationship:fromRecord:toRecord:);
+    
+    return [self methodForSelector:selector] != [MMRecordMarshaler methodForSelector:selector];
+}
+
++ (BOOL)shouldReplaceExistingRecordsForRelationship:(NSRelationshipDescription *)relationship {
+    return [[[relationship userInfo] valueForKey:MMRecordRelationshipReplacesExistingRecordsKey] boolValue];
+}
+
 + (void)establishRelationship:(NSRelationshipDescription *)relationship
                    fromRecord:(MMRecord *)fromRecord
                      toRecord:(MMRecord *)toRecord {
     if (fromRecord != nil && toRecord != nil) {
         if ([relationship isToMany]) {
-            [self establishToManyRelationship:relationship fromRecord:fromRecord toRecord:toRecord];
-        } else {
+            [self establishToManyRelationship:relationship
+                                   fromRecord:fromRecord
+                                    toRecords:@[toRecord]
+                      replacesExistingRecords:NO];
+        } else if ([self establishToOneRelationshipWithoutFaultingInverse:relationship
+                                                               fromRecord:fromRecord
+                                                                 toRecord:toRecord] == NO) {
             [fromRecord setValue:toRecord forKey:[relationship name]];
         }
     }
 }
 
+// The records are applied to the relationship in a single mutation, so KVO notifications and inverse
+// relationship maintenance happen once for the whole relationship rather than once per record.
 + (void)establishToManyRelationship:(NSRelationshipDescription *)relationship
                          fromRecord:(MMRecord *)fromRecord
-                           toRecord:(MMRecord *)toRecord {
-    id relationshipSet;
+                          toRecords:(NSArray *)toRecords
+            replacesExistingRecords:(BOOL)replacesExistingRecords {
+    NSString *key = [relationship name];
     
     BOOL useOrderedSet = NO;
     
     if ([relationship respondsToSelector:@selector(isOrdered)]) {
         useOrderedSet = relationship.isOrdered ? YES : NO;
     }
-    if (useOrderedSet) {
-        relationshipSet = [fromRecord mutableOrderedSetValueForKey:[relationship name]];
+    
+    if (replacesExistingRecords) {
+        id records = nil;
+        
+        if (useOrderedSet) {
+            records = [NSOrderedSet orderedSetWithArray:toRecords];
+        } else {
+            records = [NSSet setWithArray:toRecords];
+        }
+        
+        if ([records isEqual:[fromRecord valueForKey:key]] == NO) {
+            [fromRecord setValue:records forKey:key];
+        }
+    } else if (useOrderedSet) {
+        NSOrderedSet *existingRecords = [fromRecord valueForKey:key];
+        NSMutableOrderedSet *addedRecords = [NSMutableOrderedSet orderedSetWithArray:toRecords];
+        
+        if (existingRecords != nil) {
+            [addedRecords minusOrderedSet:existingRecords];
+        }
+        
+        if ([addedRecords count] > 0) {
+            NSMutableOrderedSet *relationshipSet = [fromRecord mutableOrderedSetValueForKey:key];
+            NSIndexSet *indexes = [NSIndexSet indexSetWithIndexesInRange:NSMakeRange([relationshipSet count], [addedRecords count])];
+            
+            [relationshipSet insertObjects:[addedRecords array] atIndexes:indexes];
+        }
     } else {
-        relationshipSet = [fromRecord mutableSetValueForKey:[relationship name]];
+        NSArray *linkedRecords = toRecords;
+        
+        // Records whose to-one inverse can be set without faulting in this relationship are linked
+        // that way, and only the rest are added to the relationship itself.
+        if ([self canLinkWithoutFaultingRelationship:relationship ofRecord:fromRecord]) {
+            NSRelationshipDescription *inverseRelationship = [relationship inverseRelationship];
+            NSMutableArray *remainingRecords = [NSMutableArray array];
+            
+            for (MMRecord *toRecord in toRecords) {
+                if ([self establishToOneRelationshipWithoutFaultingInverse:inverseRelationship
+                                                                fromRecord:toRecord
+                                                                  toRecord:fromRecord] == NO) {
+                    [remainingRecords addObject:toRecord];
+                }
+            }
+            
+            linkedRecords = remainingRecords;
+        }
+        
+        if ([linkedRecords count] > 0) {
+            [[fromRecord mutableSetValueForKey:key] unionSet:[NSSet setWithArray:linkedRecords]];
+        }
+    }
+}
+
++ (BOOL)shouldLinkWithoutFaultingRelationship:(NSRelationshipDescription *)relationship {
+    return [[[relationship userInfo] valueForKey:MMRecordRelationshipLinksWithoutFaultingKey] boolValue];
+}
+
+// Sets a to-one relationship without maintaining its inverse to-many relationship, which stays a
+// fault.  Returns NO if the inverse, or the inverse of the record being replaced, is already loaded
+// or is not configured to be linked this way.
++ (BOOL)establishToOneRelationshipWithoutFaultingInverse:(NSRelationshipDescription *)relationship
+                                              fromRecord:(MMRecord *)fromRecord
+                                                toRecord:(MMRecord *)toRecord {
+    NSRelationshipDescription *inverseRelationship = [relationship inverseRelationship];
+    
+    if ([self canLinkWithoutFaultingRelationship:inverseRelationship ofRecord:toRecord] == NO) {
+        return NO;
+    }
+    
+    NSString *key = [relationship name];
+    MMRecord *existingRecord = [fromRecord primitiveValueForKey:key];
+    
+    if (existingRecord == toRecord) {
+        return YES;
+    }
+    
+    if (existingRecord != nil &&
+        [self canLinkWithoutFaultingRelationship:inverseRelationship ofRecord:existingRecord] == NO) {
+        return NO;
+    }
+    
+    [fromRecord willChangeValueForKey:key];
+    [fromRecord setPrimitiveValue:toRecord forKey:key];
+    [fromRecord didChangeValueForKey:key];
+    
+    // Setting the primitive value leaves the owners out of the context's updated objects, so they
+    // are remembered here for the contexts that have already loaded their to-many relationship.
+    NSMutableDictionary *userInfo = [[fromRecord managedObjectContext] userInfo];
+    NSMutableSet *owners = [userInfo objectForKey:MMRecordContextRecordsLinkedWithoutFaultingKey];
+    
+    if (owners == nil) {
+        owners = [NSMutableSet set];
+        [userInfo setObject:owners forKey:MMRecordContextRecordsLinkedWithoutFaultingKey];
+    }
+    
+    [owners addObject:toRecord];
+    
+    if (existingRecord != nil) {
+        [owners addObject:existingRecord];
+    }
+    
+    return YES;
+}
+
+// The store only derives the to-many side from the to-one side when the context saves directly to
+// it, so records in child contexts are always linked through the to-many relationship.
++ (BOOL)canLinkWithoutFaultingRelationship:(NSRelationshipDescription *)relationship ofRecord:(MMRecord *)record {
+    if (relationship == nil || [relationship isToMany] == NO) {
+        return NO;
+    }
+    
+    if ([relationship respondsToSelector:@selector(isOrdered)] && relationship.isOrdered) {
+        return NO;
+    }
+    
+    NSRelationshipDescription *inverseRelationship = [relationship inverseRelationship];
+    
+    if (inverseRelationship == nil || [inverseRelationship isToMany]) {
+        return NO;
+    }
+    
+    if ([self shouldLinkWithoutFaultingRelationship:relationship] == NO) {
+        return NO;
+    }
+    
+    NSManagedObjectContext *context = [record managedObjectContext];
+    
+    if ([context respondsToSelector:@selector(parentContext)] && [context parentContext] != nil) {
+        return NO;
     }
     
-    [relationshipSet addObject:toRecord];
-    [fromRecord setValue:relationshipSet forKey:[relationship name]];
+    return [record hasFaultForRelationshipNamed:[relationship name]];
 }
 
 + (void)establishPrimaryKeyRelationshipFromProtoRecord:(MMRecordProtoRecord *)protoRecord
@@ -47,6 +47,11 @@
 @property (nonatomic, strong, readonly) NSEntityDescription *entity;
 @property (nonatomic, strong, readonly) MMRecordRepresentation *representation;
 
+// Reference proto records stand in for records that the response only refers to by primary key, 
+// such as an array of user IDs.  They have no dictionary, are not populated, and have no relationships
+// of their own.  A record that is created for a reference only has its primary key set.
+@property (nonatomic, readonly, getter=isReference) BOOL reference;
+
 // Relationships
 // Relationship protos and descriptions are returned in no particular order.
 @property (nonatomic, strong, readonly) NSArray *relationshipProtos;
@@ -62,6 +67,19 @@
                                             entity:(NSEntityDescription *)entity
                                     representation:(MMRecordRepresentation *)representation;
 
+// Creates a reference proto record for the given primary key value
++ (MMRecordProtoRecord *)protoRecordWithPrimaryKeyValue:(id)primaryKeyValue
+                                                 entity:(NSEntityDescription *)entity
+                                         representation:(MMRecordRepresentation *)representation;
+
+// Turns a reference proto record into a full proto record when the response also contains the 
+// dictionary for its record
+- (void)resolveReferenceWithDictionary:(NSDictionary *)dictionary;
+
+// Notes that the response contains a value for the relationship, so that it is established even if
+// the value is an empty array
+- (void)addRelationshipDescription:(NSRelationshipDescription *)relationshipDescription;
+
 // Associate another proto as having a relationship to this one
 - (void)addRelationshipProto:(MMRecordProtoRecord *)relationshipProto
   forRelationshipDescription:(NSRelationshipDescription *)relationshipDescription;
@@ -69,4 +87,8 @@
 // Returns the proto records for a given relationship description
 - (NSArray *)relationshipProtoRecordsForRelationshipDescription:(NSRelationshipDescription *)relationshipDescription;
 
+// Describes the graph of the given proto records, one proto per line, indented by relationship depth.
+// Protos that appear more than once are only expanded the first time.
++ (NSString *)descriptionForProtoRecords:(NSArray *)protoRecords;
+
 @end
@@ -33,6 +33,7 @@
 @property (nonatomic, strong, readwrite) NSMutableDictionary *relationshipDescriptionsDictionary;
 @property (nonatomic, strong) MMRecordRepresentation *representation;
 @property (nonatomic, strong) NSEntityDescription *entity;
+@property (nonatomic, readwrite, getter=isReference) BOOL reference;
 @end
 
 @implementation MMRecordProtoRecord
@@ -53,6 +54,26 @@
     return protoRecord;
 }
 
++ (MMRecordProtoRecord *)protoRecordWithPrimaryKeyValue:(id)primaryKeyValue
+                                                 entity:(NSEntityDescription *)entity
+                                         representation:(MMRecordRepresentation *)representation {
+    NSParameterAssert([NSClassFromString([entity managedObjectClassName]) isSubclassOfClass:[MMRecord class]]);
+    MMRecordProtoRecord *protoRecord = [[MMRecordProtoRecord alloc] init];
+    protoRecord.entity = entity;
+    protoRecord.primaryKeyValue = primaryKeyValue;
+    protoRecord.relationshipProtosDictionary = [NSMutableDictionary dictionary];
+    protoRecord.relationshipDescriptionsDictionary = [NSMutableDictionary dictionary];
+    protoRecord.representation = representation;
+    protoRecord.reference = YES;
+    
+    return protoRecord;
+}
+
+- (void)resolveReferenceWithDictionary:(NSDictionary *)dictionary {
+    self.dictionary = dictionary;
+    self.reference = NO;
+}
+
 - (NSArray *)relationshipProtos {
     NSMutableArray *allRelationshipProtos = [NSMutableArray array];
     
@@ -83,13 +104,20 @@
 
 #pragma mark - Relationships
 
-- (void)addRelationshipProto:(MMRecordProtoRecord *)relationshipProto
-  forRelationshipDescription:(NSRelationshipDescription *)relationshipDescription {
+- (void)addRelationshipDescription:(NSRelationshipDescription *)relationshipDescription {
     NSString *relationshipName = [relationshipDescription name];
     
     if (relationshipName != nil) {
         [self.relationshipDescriptionsDictionary setValue:relationshipDescription forKey:relationshipName];
+    }
+}
 
+- (void)addRelationshipProto:(MMRecordProtoRecord *)relationshipProto
+  forRelationshipDescription:(NSRelationshipDescription *)relationshipDescription {
+    NSString *relationshipName = [relationshipDescription name];
+    
+    if (relationshipName != nil) {
+        [self addRelationshipDescription:relationshipDescription];
         
         NSMutableOrderedSet *protoSet = [self.relationshipProtosDictionary objectForKey:relationshipName];
         
@@ -108,51 +136,57 @@
 #pragma mark - Description
 
 - (NSString *)description {
-    NSString *description = [self protoDescriptionWithTabLevel:0];
-    return description;
+    return [[self class] descriptionForProtoRecords:@[self]];
 }
 
-- (NSString *)stringForTabLevel:(NSInteger)tabLevel {
-    NSString *tabs = @"";
++ (NSString *)descriptionForProtoRecords:(NSArray *)protoRecords {
+    NSMutableString *description = [NSMutableString string];
+    NSHashTable *describedProtos = [NSHashTable hashTableWithOptions:NSPointerFunctionsObjectPointerPersonality];
+    NSMutableArray *stack = [NSMutableArray array];
+    NSMutableArray *tabLevels = [NSMutableArray array];
     
-    if (tabLevel > 0) {
-        tabs = @"     ";
-        for (int i = 0; i < tabLevel; i++) {
-            tabs = [tabs stringByAppendingFormat:@"     "];
+    // The graph is walked depth first with an explicit stack so that each line is only appended once,
+    // and protos that have already been described are not expanded again, which also stops cycles.
+    for (MMRecordProtoRecord *protoRecord in [protoRecords reverseObjectEnumerator]) {
+        [stack addObject:protoRecord];
+        [tabLevels addObject:@0];
+    }
+    
+    while ([stack count] > 0) {
+        MMRecordProtoRecord *protoRecord = [stack lastObject];
+        NSInteger tabLevel = [[tabLevels lastObject] integerValue];
+        [stack removeLastObject];
+        [tabLevels removeLastObject];
+        
+        if ([description length] > 0) {
+            [description appendString:(tabLevel > 0) ? @"\r" : @"\n"];
+        }
+        
+        [protoRecord appendLineDescriptionToString:description withTabLevel:tabLevel];
+        
+        if ([describedProtos containsObject:protoRecord]) {
+            continue;
+        }
+        
+        [describedProtos addObject:protoRecord];
+        
+        for (MMRecordProtoRecord *relationshipProto in [protoRecord.relationshipProtos reverseObjectEnumerator]) {
+            [stack addObject:relationshipProto];
+            [tabLevels addObject:@(tabLevel + 1)];
         }
     }
     
-    return tabs;
-}
-
-- (NSString *)protoDescriptionWithTabLevel:(NSInteger)tabLevel {
-    NSString *baseDescription = [self protoLineDescriptionWithTabLevel:tabLevel];
-    NSString *relationshipProtos = [self relationshipProtoDescriptionForRelationshipProtos:self.relationshipProtos withTabLevel:tabLevel+1];
-    NSString *description = [NSString stringWithFormat:@"%@%@", baseDescription, relationshipProtos];
     return description;
 }
 
-- (NSString *)protoLineDescriptionWithTabLevel:(NSInteger)tabLevel {
-    NSString *objectDescription = [super description];
-    NSString *entityName = self.entity.name;
-    NSString *primaryKeyValue = self.primaryKeyValue;
-    NSString *newDescription = [NSString stringWithFormat:@"%@ Entity: %@, Value: %@", objectDescription, entityName, primaryKeyValue];
-    return newDescription;
-}
-
-- (NSString *)relationshipProtoDescriptionForRelationshipProtos:(NSArray *)relationshipProtos withTabLevel:(NSInteger)tabLevel {
-    NSString *relationshipString = @"";
-    
-    for (MMRecordProtoRecord *proto in relationshipProtos) {
-        NSString *protoLine = [proto protoDescriptionWithTabLevel:tabLevel];
-        NSString *tabs = [self stringForTabLevel:tabLevel];
-        
-        relationshipString = [relationshipString stringByAppendingFormat:@"%@%@%@", @"\r", tabs, protoLine];
+- (void)appendLineDescriptionToString:(NSMutableString *)string withTabLevel:(NSInteger)tabLevel {
+    if (tabLevel > 0) {
+        for (NSInteger i = 0; i <= tabLevel; i++) {
+            [string appendString:@"     "];
+        }
     }
     
-    NSString *description = [NSString stringWithFormat:@"%@", relationshipString];
-    
-    return description;
+    [string appendFormat:@"<%@: %p> Entity: %@, Value: %@", NSStringFromClass([self class]), self, self.entity.name, self.primaryKeyValue];
 }
 
 @end
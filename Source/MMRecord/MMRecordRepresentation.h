@@ -171,6 +171,16 @@
  */
 - (NSArray *)additionalKeyPathsForMappingPropertyDescription:(NSPropertyDescription *)propertyDescription;
 
+/**
+ This method indicates whether this representation reads values from a record's dictionary that are
+ not mapped to any of the entity's properties.  When it returns YES, the records of this entity are
+ always decoded in full, even if the decodesOnlyMappedKeyPaths option is enabled.
+ 
+ @return YES if the representation reads unmapped values, NO otherwise.
+ @discussion The default implementation returns NO.
+ */
+- (BOOL)readsUnmappedKeyPaths;
+
 /**
  This method is called to set up the internal mapping system for the given property. This can be a
  convenient method to override if you wish to take additional action when configuring this property.
@@ -95,6 +95,10 @@
     return nil;
 }
 
+- (BOOL)readsUnmappedKeyPaths {
+    return NO;
+}
+
 - (Class)marshalerClass {
     return [MMRecordMarshaler class];
 }
@@ -38,7 +38,24 @@
                                         initialEntity:(NSEntityDescription *)initialEntity
                                               context:(NSManagedObjectContext *)context;
 
+// The number of levels of nested relationships that proto records are built for.  Records nested
+// deeper than this are still imported, but their own relationships are not.  The default is 512.
+@property (nonatomic, assign) NSUInteger maximumRelationshipDepth;
+
+// The request identifier recorded with the trace events for each phase of the import.
+@property (nonatomic, assign) uint32_t traceIdentifier;
+
 // Records from Response Description
 - (NSArray *)records;
 
+// Records from Response Description.  The cancellation block is checked between each phase of the
+// import, and nil is returned as soon as it returns YES.  The context is left with whatever changes
+// were made before the import was cancelled, and should be rolled back by the caller.
+- (NSArray *)recordsWithCancellationBlock:(BOOL (^)(void))cancellationBlock;
+
+// The primary key values of every record in the response whose entity is the given entity or one of
+// its sub entities.  These are gathered while fetching the existing records, so they are only 
+// available once the records have been obtained.
+- (NSArray *)primaryKeyValuesForEntity:(NSEntityDescription *)entity;
+
 @end
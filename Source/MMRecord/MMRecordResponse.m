@@ -27,6 +27,8 @@
 #import "MMRecordRepresentation.h"
 #import "MMRecordProtoRecord.h"
 
+static const NSUInteger MMRecordResponseDefaultMaximumRelationshipDepth = 512;
+
 /* This class contains the proto records from the response which are of a given entity type.  This 
  class is used to contain all of the proto records that represent all the actual records in a response
  for that type.  If a MMRecordResponse only contains records of a given type, it should only create
@@ -39,6 +41,7 @@
 @property (nonatomic, strong) NSEntityDescription *entity;
 @property (nonatomic, strong) NSMutableSet *protoRecords;
 @property (nonatomic, strong) NSMutableDictionary *prototypeDictionary;
+@property (nonatomic, copy) NSArray *primaryKeyValues;
 @property (nonatomic, strong) MMRecordRepresentation *representation;
 @property (nonatomic) BOOL hasRelationshipPrimaryKey;
 
@@ -82,6 +85,7 @@
     response.context = context;
     response.initialEntity = initialEntity;
     response.responseObjectArray = responseObjectArray;
+    response.maximumRelationshipDepth = MMRecordResponseDefaultMaximumRelationshipDepth;
     
     return response;
 }
@@ -90,22 +94,56 @@
 #pragma mark - Record Parsing
 
 - (NSArray *)records {
+    return [self recordsWithCancellationBlock:nil];
+}
+
+- (NSArray *)recordsWithCancellationBlock:(BOOL (^)(void))cancellationBlock {
+    BOOL (^isCancelled)(void) = ^BOOL{
+        return (cancellationBlock != nil && cancellationBlock());
+    };
+    
+    uint32_t traceIdentifier = self.traceIdentifier;
+    
     // Step 0: Build Proto Records and Response Groups
+    MMRTrace(MMRecordTraceEventKindBegin, MMRecordTracePhaseBuildProtoRecords, traceIdentifier, self.initialEntity.name, [self.responseObjectArray count]);
     [self buildProtoRecordsAndResponseGroups];
+    MMRTrace(MMRecordTraceEventKindEnd, MMRecordTracePhaseBuildProtoRecords, traceIdentifier, self.initialEntity.name, [self.responseGroups count]);
     
     // Step 1: Obtain Records (Fetch, Associate, Create)
     for (MMRecordResponseGroup *responseGroup in [self.responseGroups allValues]) {
+        if (isCancelled()) {
+            return nil;
+        }
+        
+        MMRTrace(MMRecordTraceEventKindBegin, MMRecordTracePhaseObtainRecords, traceIdentifier, responseGroup.entity.name, [responseGroup.protoRecords count]);
         [responseGroup obtainRecordsForProtoRecordsInContext:self.context];
+        MMRTrace(MMRecordTraceEventKindEnd, MMRecordTracePhaseObtainRecords, traceIdentifier, responseGroup.entity.name, [responseGroup.protoRecords count]);
     }
     
     // Step 2: Populate Records
     for (MMRecordResponseGroup *responseGroup in [self.responseGroups allValues]) {
+        if (isCancelled()) {
+            return nil;
+        }
+        
+        MMRTrace(MMRecordTraceEventKindBegin, MMRecordTracePhasePopulateRecords, traceIdentifier, responseGroup.entity.name, [responseGroup.protoRecords count]);
         [responseGroup populateAllRecords];
+        MMRTrace(MMRecordTraceEventKindEnd, MMRecordTracePhasePopulateRecords, traceIdentifier, responseGroup.entity.name, [responseGroup.protoRecords count]);
     }
     
     // Step 3: Establish Relationships
     for (MMRecordResponseGroup *responseGroup in [self.responseGroups allValues]) {
+        if (isCancelled()) {
+            return nil;
+        }
+        
+        MMRTrace(MMRecordTraceEventKindBegin, MMRecordTracePhaseEstablishRelationships, traceIdentifier, responseGroup.entity.name, [responseGroup.protoRecords count]);
         [responseGroup establishRelationshipsForAllRecords];
+        MMRTrace(MMRecordTraceEventKindEnd, MMRecordTracePhaseEstablishRelationships, traceIdentifier, responseGroup.entity.name, [responseGroup.protoRecords count]);
+    }
+    
+    if (isCancelled()) {
+        return nil;
     }
     
     // Step 4: Profit!
@@ -113,6 +151,18 @@
     return records;
 }
 
+- (NSArray *)primaryKeyValuesForEntity:(NSEntityDescription *)entity {
+    NSMutableArray *primaryKeyValues = [NSMutableArray array];
+    
+    for (MMRecordResponseGroup *responseGroup in [self.responseGroups allValues]) {
+        if ([responseGroup.entity isKindOfEntity:entity] && responseGroup.primaryKeyValues != nil) {
+            [primaryKeyValues addObjectsFromArray:responseGroup.primaryKeyValues];
+        }
+    }
+    
+    return primaryKeyValues;
+}
+
 - (NSArray *)recordsFromObjectGraph {
     NSMutableArray *records = [NSMutableArray array];
     
@@ -128,7 +178,7 @@
 
 - (void)logObjectGraph {
     if ([MMRecord loggingLevel] != MMRecordLoggingLevelNone) {
-        MMRLogInfo(@"%@", self.objectGraph);
+        MMRLogInfo(@"%@", [MMRecordProtoRecord descriptionForProtoRecords:self.objectGraph]);
     }
 }
 
@@ -163,9 +213,13 @@
 
 #pragma mark - Building Proto Records
 
+// The proto graph is built breadth first from an explicit work list rather than by recursing into
+// each nested relationship, so deeply nested responses do not grow the call stack.  Each level of
+// the graph holds the proto records created at that depth whose relationships are still to be built.
 - (void)buildProtoRecordsAndResponseGroups {
     NSMutableDictionary *responseGroups = [NSMutableDictionary dictionary];
     NSMutableArray *objectGraph = [NSMutableArray array];
+    NSMutableArray *level = [NSMutableArray array];
     
     NSArray *subEntities = self.initialEntity.subentities;
     
@@ -185,9 +239,36 @@
         
         MMRecordProtoRecord *proto = [self protoRecordWithRecordResponseObject:recordResponseObject
                                                                         entity:entity
-                                                        existingResponseGroups:responseGroups];
+                                                        existingResponseGroups:responseGroups
+                                                               newProtoRecords:level];
+        
+        if (proto != nil) {
+            [objectGraph addObject:proto];
+        }
+    }
+    
+    NSUInteger depth = 0;
+    
+    while ([level count] > 0) {
+        if (depth >= self.maximumRelationshipDepth) {
+            if ([MMRecord loggingLevel] != MMRecordLoggingLevelNone) {
+                MMRLogWarn(@"%lu records nested %lu levels deep were imported without their relationships.",
+                           (unsigned long)[level count], (unsigned long)depth);
+            }
+            
+            break;
+        }
+        
+        NSMutableArray *nextLevel = [NSMutableArray array];
+        
+        for (MMRecordProtoRecord *protoRecord in level) {
+            [self completeRelationshipProtoRecordMappingToProtoRecord:protoRecord
+                                               existingResponseGroups:responseGroups
+                                                      newProtoRecords:nextLevel];
+        }
         
-        [objectGraph addObject:proto];
+        level = nextLevel;
+        depth++;
     }
     
     self.objectGraph = objectGraph;
@@ -196,14 +277,26 @@
     [self logObjectGraph];
 }
 
+// Returns the proto record for the response object, reusing the one already built for its primary
+// key if there is one.  Proto records are registered with their response group as soon as they are
+// created, and are added to newProtoRecords so that their relationships are built with the next
+// level of the graph.
 - (MMRecordProtoRecord *)protoRecordWithRecordResponseObject:(id)recordResponseObject
                                                       entity:(NSEntityDescription *)entity
-                                      existingResponseGroups:(NSMutableDictionary *)responseGroups {
+                                      existingResponseGroups:(NSMutableDictionary *)responseGroups
+                                             newProtoRecords:(NSMutableArray *)newProtoRecords {
     MMRecordResponseGroup *recordResponseGroup = [self responseGroupForEntity:entity
                                                    fromExistingResponseGroups:responseGroups];
     MMRecordRepresentation *representation = recordResponseGroup.representation;
     
     if ([recordResponseObject isKindOfClass:[NSDictionary class]] == NO) {
+        if (recordResponseGroup.hasRelationshipPrimaryKey == NO) {
+            return [self referenceProtoRecordWithPrimaryKeyValue:recordResponseObject
+                                                          entity:entity
+                                                   responseGroup:recordResponseGroup
+                                          existingResponseGroups:responseGroups];
+        }
+        
         recordResponseObject = @{representation.primaryKeyPropertyName : recordResponseObject};
     }
     
@@ -214,16 +307,40 @@
         proto = [MMRecordProtoRecord protoRecordWithDictionary:recordResponseObject
                                                         entity:entity
                                                 representation:representation];
+        
+        if (proto) {
+            [self uniquelyAddNewProtoRecord:proto toExistingResponseGroups:responseGroups];
+            [recordResponseGroup addProtoRecordToDictionary:proto];
+            [newProtoRecords addObject:proto];
+        }
+    } else if (proto.isReference) {
+        // The record was referred to by primary key before its dictionary was found.
+        [proto resolveReferenceWithDictionary:recordResponseObject];
+        [newProtoRecords addObject:proto];
+    }
+    
+    return proto;
+}
+
+// Response objects that are a bare primary key value become reference proto records, which are 
+// resolved by the primary key fetch or a placeholder insert without being populated.
+- (MMRecordProtoRecord *)referenceProtoRecordWithPrimaryKeyValue:(id)primaryKeyValue
+                                                          entity:(NSEntityDescription *)entity
+                                                   responseGroup:(MMRecordResponseGroup *)responseGroup
+                                          existingResponseGroups:(NSMutableDictionary *)responseGroups {
+    if (primaryKeyValue == [NSNull null]) {
+        return nil;
     }
     
-    [self uniquelyAddNewProtoRecord:proto toExistingResponseGroups:responseGroups];
+    MMRecordProtoRecord *proto = [responseGroup protoRecordForPrimaryKeyValue:primaryKeyValue];
     
-    if (proto) {
-        [self completeRelationshipProtoRecordMappingToProtoRecord:proto
-                                           existingResponseGroups:responseGroups
-                                                   representation:representation];
+    if (proto == nil) {
+        proto = [MMRecordProtoRecord protoRecordWithPrimaryKeyValue:primaryKeyValue
+                                                             entity:entity
+                                                     representation:responseGroup.representation];
         
-        [recordResponseGroup addProtoRecordToDictionary:proto];
+        [self uniquelyAddNewProtoRecord:proto toExistingResponseGroups:responseGroups];
+        [responseGroup addProtoRecordToDictionary:proto];
     }
     
     return proto;
@@ -231,21 +348,24 @@
 
 - (void)completeRelationshipProtoRecordMappingToProtoRecord:(MMRecordProtoRecord *)protoRecord
                                      existingResponseGroups:(NSMutableDictionary *)responseGroups
-                                             representation:(MMRecordRepresentation *)representation {
+                                            newProtoRecords:(NSMutableArray *)newProtoRecords {
+    MMRecordRepresentation *representation = protoRecord.representation;
     NSArray *relationshipDescriptions = representation.relationshipDescriptions;
     
     for (NSRelationshipDescription *relationshipDescription in relationshipDescriptions) {
         [self addRelationshipProtoRecordsToProtoRecord:protoRecord
                                 existingResponseGroups:responseGroups
                                         representation:representation
-                               relationshipDescription:relationshipDescription];
+                               relationshipDescription:relationshipDescription
+                                       newProtoRecords:newProtoRecords];
     }
 }
 
 - (void)addRelationshipProtoRecordsToProtoRecord:(MMRecordProtoRecord *)protoRecord
                           existingResponseGroups:(NSMutableDictionary *)responseGroups
                                   representation:(MMRecordRepresentation *)representation
-                         relationshipDescription:(NSRelationshipDescription *)relationshipDescription {
+                         relationshipDescription:(NSRelationshipDescription *)relationshipDescription
+                                 newProtoRecords:(NSMutableArray *)newProtoRecords {
     NSDictionary *dictionary = protoRecord.dictionary;
     NSEntityDescription *entity = [relationshipDescription destinationEntity];
     MMRecordResponseGroup *responseGroup = [self responseGroupForEntity:entity
@@ -262,12 +382,17 @@
                 relationshipObject = @[relationshipObject];
             }
             
+            [protoRecord addRelationshipDescription:relationshipDescription];
+            
             for (id object in relationshipObject) {
                 MMRecordProtoRecord *relationshipProto = [self protoRecordWithRecordResponseObject:object
                                                                                             entity:entity
-                                                                            existingResponseGroups:responseGroups];
+                                                                            existingResponseGroups:responseGroups
+                                                                                   newProtoRecords:newProtoRecords];
                 
-                [protoRecord addRelationshipProto:relationshipProto forRelationshipDescription:relationshipDescription];
+                if (relationshipProto != nil) {
+                    [protoRecord addRelationshipProto:relationshipProto forRelationshipDescription:relationshipDescription];
+                }
             }
         }
     }
@@ -282,13 +407,10 @@
         relationshipObject = [dictionary valueForKeyPath:keyPath];
         
         if (relationshipObject) {
+            // Bare primary key values are returned as they are and become reference proto records.
             if (([relationshipObject isKindOfClass:[NSDictionary class]] == NO) &&
                 ([relationshipObject isKindOfClass:[NSArray class]] == NO)) {
-                id primaryKey = [[responseGroup representation] primaryKeyPropertyName];
-                
-                if (primaryKey) {
-                    relationshipObject = @{primaryKey : relationshipObject};
-                } else {
+                if ([[responseGroup representation] primaryKeyPropertyName] == nil) {
                     relationshipObject = nil;
                 }
             }
@@ -358,13 +480,17 @@
 
 - (void)establishRelationshipsForAllRecords {
     for (MMRecordProtoRecord *protoRecord in self.protoRecords) {
-        [self.representation.marshalerClass establishRelationshipsOnProtoRecord:protoRecord];
+        if (protoRecord.isReference == NO) {
+            [self.representation.marshalerClass establishRelationshipsOnProtoRecord:protoRecord];
+        }
     }
 }
 
 - (void)populateAllRecords {
     for (MMRecordProtoRecord *protoRecord in self.protoRecords) {
-        [self.representation.marshalerClass populateProtoRecord:protoRecord];
+        if (protoRecord.isReference == NO) {
+            [self.representation.marshalerClass populateProtoRecord:protoRecord];
+        }
     }
 }
 
@@ -396,6 +522,8 @@
         }
     }
     
+    self.primaryKeyValues = allPrimaryKeys;
+    
     NSArray *existingRecords = [self fetchRecordsWithPrimaryKeys:allPrimaryKeys forEntity:self.entity context:context];
     NSArray *sortedProtoRecords = [self sortedProtoRecordsByPrimaryKeyValueInAscendingOrder:[self.protoRecords allObjects]];
     
@@ -449,8 +577,11 @@
         if (primaryAttributeKey == nil)
             return nil;
         
+        // The fetched records are populated right away, so they are returned as full objects along with
+        // the relationships they are about to be linked through.
         NSFetchRequest *fetchRequest = [[NSFetchRequest alloc] initWithEntityName:[entity name]];
-        [fetchRequest setFetchBatchSize:20];
+        fetchRequest.returnsObjectsAsFaults = NO;
+        fetchRequest.relationshipKeyPathsForPrefetching = [self relationshipKeyPathsForPrefetching];
         fetchRequest.sortDescriptors = [NSArray arrayWithObject:[NSSortDescriptor sortDescriptorWithKey:primaryAttributeKey ascending:YES]];
         fetchRequest.predicate = [NSPredicate predicateWithFormat: @"SELF.%@ IN %@", primaryAttributeKey, primaryKeys];
         
@@ -462,6 +593,35 @@
     return results;
 }
 
+// The relationships that the response links the records in this group through.  A to-many
+// relationship can hold any number of records, so to-many relationships are only included if the
+// entity opts in, and never if they are linked without being faulted in.
+- (NSArray *)relationshipKeyPathsForPrefetching {
+    id prefetchesRelationships = [[self.entity userInfo] valueForKey:MMRecordEntityPrefetchesRelationshipsKey];
+    
+    if (prefetchesRelationships != nil && [prefetchesRelationships boolValue] == NO) {
+        return nil;
+    }
+    
+    BOOL prefetchesToManyRelationships = [prefetchesRelationships boolValue];
+    Class marshalerClass = self.representation.marshalerClass;
+    NSMutableSet *relationshipNames = [NSMutableSet set];
+    
+    for (MMRecordProtoRecord *protoRecord in self.protoRecords) {
+        for (NSRelationshipDescription *relationshipDescription in protoRecord.relationshipDescriptions) {
+            if ([relationshipDescription isToMany] &&
+                (prefetchesToManyRelationships == NO ||
+                 [marshalerClass shouldLinkWithoutFaultingRelationship:relationshipDescription])) {
+                continue;
+            }
+            
+            [relationshipNames addObject:[relationshipDescription name]];
+        }
+    }
+    
+    return [relationshipNames allObjects];
+}
+
 
 #pragma mark - Creation (Last Resort)
 
@@ -472,6 +632,10 @@
             MMRecord *record = [[recordClass alloc] initWithEntity:self.entity insertIntoManagedObjectContext:context];
             protoRecord.record = record;
             
+            if (protoRecord.isReference) {
+                [self populatePrimaryKeyForReferenceProtoRecord:protoRecord];
+            }
+            
             if ([MMRecord loggingLevel] == MMRecordLoggingLevelDebug) {
                 MMRLogVerbose(@"Created proto record \"%@\", value: \"%@\"", protoRecord.entity.name, protoRecord.primaryKeyValue);
             }
@@ -479,6 +643,19 @@
     }
 }
 
+// A record created for a reference proto record is a placeholder that only has its primary key.
+- (void)populatePrimaryKeyForReferenceProtoRecord:(MMRecordProtoRecord *)protoRecord {
+    NSString *primaryKeyPropertyName = [self.representation primaryKeyPropertyName];
+    NSAttributeDescription *primaryKeyAttribute = [[self.entity attributesByName] objectForKey:primaryKeyPropertyName];
+    
+    if (primaryKeyAttribute != nil) {
+        [self.representation.marshalerClass setValue:protoRecord.primaryKeyValue
+                                            onRecord:protoRecord.record
+                                           attribute:primaryKeyAttribute
+                                       dateFormatter:self.representation.dateFormatter];
+    }
+}
+
 
 @end
 
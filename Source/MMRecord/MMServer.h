@@ -37,6 +37,103 @@ typedef void (^MMServerSessionTimeoutRestartLastRequestBlock)();
  */
 typedef void (^MMServerSessionTimeoutBlock)(MMServerSessionTimeoutRestartLastRequestBlock restartBlock);
 
+/**
+ Keys for the cache validators dictionary used by conditional requests.  The values are the header 
+ values returned by the server for the ETag and Last-Modified response headers.
+ */
+extern NSString * const MMServerEntityTagValidatorKey;
+extern NSString * const MMServerLastModifiedValidatorKey;
+
+/**
+ `MMServerResponseSchema` describes the parts of a response body that will actually be imported, so
+ that a decoder can skip everything else without creating objects for it.  A schema lists the keys 
+ to decode in every dictionary it is applied to.  Each key either has a schema of its own, which is 
+ applied to the value for that key, or no schema, in which case the value is decoded in full.  A 
+ schema applied to an array is applied to each of its elements, and values that are not arrays or 
+ dictionaries are always decoded.
+ 
+ MMRecord builds a schema from the key paths mapped by the record's representation when the 
+ decodesOnlyMappedKeyPaths option is enabled.  Schemas must not be changed once they have been 
+ passed to a request.
+ */
+@interface MMServerResponseSchema : NSObject
+
+/**
+ Indicates that keys which are not listed in the schema are decoded in full rather than skipped.  
+ This is used for the top level of a response, where keys other than the one containing the records
+ may be read by a page manager or a custom response block.
+ */
+@property (nonatomic, assign) BOOL includesUnlistedKeys;
+
+/**
+ Adds a key path to the schema.  Intermediate keys in the key path are added as needed, and adding a
+ key path that is already in the schema merges the two schemas for it.
+ 
+ @param keyPath A key path with keys separated by periods.
+ @param schema The schema for the value at the key path, or nil if the value should be decoded in 
+ full.
+ */
+- (void)addKeyPath:(NSString *)keyPath schema:(MMServerResponseSchema *)schema;
+
+/**
+ Indicates whether the value for a key should be decoded.
+ 
+ @param key A key in a dictionary that the schema is applied to.
+ @param schema Upon return, contains the schema for the value, or nil if the value should be decoded
+ in full.
+ @return YES if the value for the key should be decoded, or NO if it should be skipped.
+ */
+- (BOOL)includesKey:(NSString *)key schema:(MMServerResponseSchema **)schema;
+
+/**
+ Returns the key paths of the record values included in the schema, relative to a record.  The keys
+ of a schema that includes unlisted keys belong to the response around the records, so only the key
+ paths below them are returned.  Values that are decoded in full are returned as a single key path.
+ 
+ @return A sorted array of key paths with keys separated by periods.
+ */
+- (NSArray *)recordKeyPaths;
+
+@end
+
+/**
+ The `MMServerResponseDecoder` protocol is adopted by classes that turn a response body into the 
+ dictionaries and arrays that MMRecord imports records from.  A decoder for JSON is always 
+ available.  Decoders for other wire formats, such as MessagePack or CBOR, can be registered with 
+ MMServer so that servers and the record level cache use them for responses of those content types.
+ */
+@protocol MMServerResponseDecoder <NSObject>
+
+/**
+ The MIME types handled by this decoder, such as application/msgpack.
+ */
++ (NSArray *)contentTypes;
+
+/**
+ Decodes a response body.  Strings, numbers, arrays and dictionaries should be decoded to the 
+ Foundation classes that NSJSONSerialization would use, and null values to NSNull.
+ 
+ @param data The response body.
+ @param error If the body cannot be decoded, upon return contains an error describing the problem.
+ @return The decoded response object, or nil if the body could not be decoded.
+ */
++ (id)responseObjectWithData:(NSData *)data error:(NSError **)error;
+
+@optional
+
+/**
+ Decodes a response body, skipping the values that are not included in the schema.  Decoders that 
+ do not implement this method are passed the whole body instead.
+ 
+ @param data The response body.
+ @param schema The schema describing which values will be imported.
+ @param error If the body cannot be decoded, upon return contains an error describing the problem.
+ @return The decoded response object, or nil if the body could not be decoded.
+ */
++ (id)responseObjectWithData:(NSData *)data schema:(MMServerResponseSchema *)schema error:(NSError **)error;
+
+@end
+
 /**
  `MMServer` provides the primary interface for making a request to a server.  MMServer is designed 
  to be subclassed.  One of the great things about MMServer is that it removes the depency of a 
@@ -57,6 +154,10 @@ typedef void (^MMServerSessionTimeoutBlock)(MMServerSessionTimeoutRestartLastReq
  
  To allow your server to support pagination you should override pageManagerClass and return the 
  class of your MMServerPageManager subclass.
+ 
+ To allow your server to revalidate cached records with HTTP conditional requests you should 
+ override startConditionalRequestWithURN:.  The validator helper methods below can be used to 
+ implement it on top of any HTTP networking framework.
  */
 
 @interface MMServer : NSObject
@@ -73,6 +174,43 @@ typedef void (^MMServerSessionTimeoutBlock)(MMServerSessionTimeoutRestartLastReq
  */
 + (void)cancelRequestsWithDomain:(id)domain;
 
+///--------------------------------------
+/// @name Registering Requests by Domain
+///--------------------------------------
+
+/**
+ Registers a request with a domain so that it can be cancelled along with the other requests for 
+ that domain.  Registries are looked up by domain in a map table, so finding the requests for a 
+ domain does not depend on how many requests are in progress.  The domain is not retained.  When 
+ the domain is deallocated, every request still registered with it is cancelled.  Strings and 
+ numbers that are stored as tagged pointers are never deallocated, so their requests are only 
+ cancelled explicitly.
+ 
+ @param request The request to register.  This can be any object that responds to -cancel, such as
+ an NSOperation.
+ @param domain The domain object the request belongs to.  Domains are compared with isEqual:, so 
+ strings and numbers can be used as domains.  Requests are not associated with every instance of 
+ the domain's class.
+ */
++ (void)registerRequest:(id)request forDomain:(id)domain;
+
+/**
+ Removes a request from the registry for a domain.  Requests should be unregistered once they 
+ finish.
+ 
+ @param request The request to unregister.
+ @param domain The domain object the request was registered with.
+ */
++ (void)unregisterRequest:(id)request forDomain:(id)domain;
+
+/**
+ Cancels and unregisters every request registered with a domain.  Subclasses can call this method 
+ from their implementation of cancelRequestsWithDomain:.
+ 
+ @param domain The domain object whose requests should be cancelled.
+ */
++ (void)cancelRegisteredRequestsForDomain:(id)domain;
+
 /**
  Starts a request.  This method must be implemented by the subclass of MMServer.
  
@@ -109,6 +247,130 @@ typedef void (^MMServerSessionTimeoutBlock)(MMServerSessionTimeoutRestartLastReq
               responseBlock:(void(^)(id responseObject))responseBlock
                failureBlock:(void(^)(NSError *error))failureBlock;
 
+/**
+ Starts a request with a given priority.  This method is called by MMRecord to start every request 
+ that is not a conditional request.  Subclasses that can prioritize requests, for example by 
+ setting the queue priority of an NSOperation, should override this method.
+ 
+ @param URN The base URN for the request endpoint.
+ @param data A dictionary containing request parameters.
+ @param paged A boolean value indicating whether the request is paged or not.
+ @param domain A domain value used for request cancellation.
+ @param batched A boolean value indicating whether or not a request is intended to be batched.
+ @param dispatchGroup A dispatch_group variable to be used for grouping batch requests.
+ @param priority The priority of the request.
+ @param responseBlock A block object to be executed when the request finishes successfully.
+ @param failureBlock A block object to be executed when the request finishes unsuccessfully.
+ @discussion The default implementation ignores the priority and calls startRequestWithURN: above.
+ */
++ (void)startRequestWithURN:(NSString *)URN
+                       data:(NSDictionary *)data
+                      paged:(BOOL)paged
+                     domain:(id)domain
+                    batched:(BOOL)batched
+              dispatchGroup:(dispatch_group_t)dispatchGroup
+                   priority:(MMRecordRequestPriority)priority
+              responseBlock:(void(^)(id responseObject))responseBlock
+               failureBlock:(void(^)(NSError *error))failureBlock;
+
+/**
+ Starts a request whose response only needs to be decoded as far as the given schema.  This method 
+ is called by MMRecord instead of the method above when the decodesOnlyMappedKeyPaths option is 
+ enabled.  Subclasses that decode response bodies should override this method and pass the schema to
+ responseObjectWithData:contentType:schema:error:.
+ 
+ @param URN The base URN for the request endpoint.
+ @param data A dictionary containing request parameters.
+ @param paged A boolean value indicating whether the request is paged or not.
+ @param domain A domain value used for request cancellation.
+ @param batched A boolean value indicating whether or not a request is intended to be batched.
+ @param dispatchGroup A dispatch_group variable to be used for grouping batch requests.
+ @param priority The priority of the request.
+ @param responseSchema The schema describing which values in the response will be imported.
+ @param responseBlock A block object to be executed when the request finishes successfully.
+ @param failureBlock A block object to be executed when the request finishes unsuccessfully.
+ @discussion The default implementation ignores the schema and calls startRequestWithURN: above.
+ */
++ (void)startRequestWithURN:(NSString *)URN
+                       data:(NSDictionary *)data
+                      paged:(BOOL)paged
+                     domain:(id)domain
+                    batched:(BOOL)batched
+              dispatchGroup:(dispatch_group_t)dispatchGroup
+                   priority:(MMRecordRequestPriority)priority
+             responseSchema:(MMServerResponseSchema *)responseSchema
+              responseBlock:(void(^)(id responseObject))responseBlock
+               failureBlock:(void(^)(NSError *error))failureBlock;
+
+/**
+ Starts a conditional request.  This method is called instead of startRequestWithURN: when record 
+ level caching is enabled for a request.  Subclasses that support HTTP cache validation should send 
+ the validators with the request as If-None-Match and If-Modified-Since headers, and call the 
+ notModifiedBlock if the server responds with 304 Not Modified.  When the server responds with a 
+ new body, the validators from that response should be passed to the responseBlock so that MMRecord
+ can store them alongside the cached records.
+ 
+ @param URN The base URN for the request endpoint.
+ @param data A dictionary containing request parameters.
+ @param domain A domain value used for request cancellation.
+ @param batched A boolean value indicating whether or not a request is intended to be batched.
+ @param dispatchGroup A dispatch_group variable to be used for grouping batch requests.
+ @param priority The priority of the request.
+ @param validators The cache validators stored from the previous response for this request.  This 
+ dictionary uses the MMServerEntityTagValidatorKey and MMServerLastModifiedValidatorKey keys, and 
+ may be nil.
+ @param responseBlock A block object to be executed when the request finishes successfully with a 
+ response body.  The block is called with the response object and the validators from the response.
+ @param notModifiedBlock A block object to be executed when the server indicates that the response 
+ has not changed since the validators were issued.
+ @param failureBlock A block object to be executed when the request finishes unsuccessfully.
+ @discussion The default implementation ignores the validators and calls startRequestWithURN: with 
+ paged set to NO and the given priority.  The responseBlock is called with nil validators.
+ */
++ (void)startConditionalRequestWithURN:(NSString *)URN
+                                  data:(NSDictionary *)data
+                                domain:(id)domain
+                               batched:(BOOL)batched
+                         dispatchGroup:(dispatch_group_t)dispatchGroup
+                              priority:(MMRecordRequestPriority)priority
+                            validators:(NSDictionary *)validators
+                         responseBlock:(void(^)(id responseObject, NSDictionary *validators))responseBlock
+                      notModifiedBlock:(void(^)(void))notModifiedBlock
+                          failureBlock:(void(^)(NSError *error))failureBlock;
+
+/**
+ Starts a conditional request whose response only needs to be decoded as far as the given schema.  
+ This method is called by MMRecord instead of the method above when the decodesOnlyMappedKeyPaths 
+ option is enabled.
+ 
+ @param URN The base URN for the request endpoint.
+ @param data A dictionary containing request parameters.
+ @param domain A domain value used for request cancellation.
+ @param batched A boolean value indicating whether or not a request is intended to be batched.
+ @param dispatchGroup A dispatch_group variable to be used for grouping batch requests.
+ @param priority The priority of the request.
+ @param responseSchema The schema describing which values in the response will be imported.
+ @param validators The cache validators stored from the previous response for this request.
+ @param responseBlock A block object to be executed when the request finishes successfully with a 
+ response body.
+ @param notModifiedBlock A block object to be executed when the server indicates that the response 
+ has not changed since the validators were issued.
+ @param failureBlock A block object to be executed when the request finishes unsuccessfully.
+ @discussion The default implementation ignores the schema and calls startConditionalRequestWithURN:
+ above.
+ */
++ (void)startConditionalRequestWithURN:(NSString *)URN
+                                  data:(NSDictionary *)data
+                                domain:(id)domain
+                               batched:(BOOL)batched
+                         dispatchGroup:(dispatch_group_t)dispatchGroup
+                              priority:(MMRecordRequestPriority)priority
+                        responseSchema:(MMServerResponseSchema *)responseSchema
+                            validators:(NSDictionary *)validators
+                         responseBlock:(void(^)(id responseObject, NSDictionary *validators))responseBlock
+                      notModifiedBlock:(void(^)(void))notModifiedBlock
+                          failureBlock:(void(^)(NSError *error))failureBlock;
+
 ///-----------------------------------------------
 /// @name Handling API Request Response Pagination
 ///-----------------------------------------------
@@ -155,4 +417,146 @@ typedef void (^MMServerSessionTimeoutBlock)(MMServerSessionTimeoutRestartLastReq
 + (NSURLRequest *)requestWithURN:(NSString *)URN
                             data:(NSDictionary *)data;
 
+/**
+ Adds the If-None-Match and If-Modified-Since headers for the given validators to a request.
+ 
+ @param validators A dictionary of cache validators.  May be nil.
+ @param request The request to add the conditional headers to.
+ */
++ (void)addValidators:(NSDictionary *)validators toRequest:(NSMutableURLRequest *)request;
+
+/**
+ Returns the cache validators contained in the headers of a response.
+ 
+ @param response The HTTP response returned by the server.
+ @return A dictionary containing the ETag and Last-Modified header values, or nil if the response 
+ contains neither.
+ */
++ (NSDictionary *)validatorsFromResponse:(NSHTTPURLResponse *)response;
+
+
+///----------------------------------
+/// @name Requesting Sparse Fieldsets
+///----------------------------------
+
+/**
+ Returns the name of the query parameter used to ask the server for a subset of each record's 
+ fields, such as fields.  Servers for APIs that support sparse fieldsets should override this 
+ method.  When it returns a name, requests started with a response schema ask for only the fields 
+ that the records map.
+ 
+ @return The parameter name, or nil if the API does not support sparse fieldsets.
+ @discussion The default implementation returns nil.
+ */
++ (NSString *)fieldsetParameterName;
+
+/**
+ Returns the value of the fieldset parameter for a list of record key paths.  Override this method 
+ to match the API's naming convention for nested fields, for example by converting key paths to 
+ snake case or by grouping nested fields in parentheses.
+ 
+ @param keyPaths The sorted key paths of the record values that will be imported.
+ @return The parameter value.
+ @discussion The default implementation joins the key paths with commas.
+ */
++ (NSString *)fieldsetParameterValueForKeyPaths:(NSArray *)keyPaths;
+
+/**
+ Returns the query parameters that ask the server for only the fields in a response schema.  
+ Override this method for APIs whose fieldsets need more than one parameter, such as a parameter per
+ resource type.
+ 
+ @param responseSchema The schema describing which values in the response will be imported.
+ @return A dictionary of parameters, or nil if none should be sent.
+ @discussion The default implementation returns nil if fieldsetParameterName returns nil, or if the 
+ schema has no record key paths.
+ */
++ (NSDictionary *)fieldsetParametersForResponseSchema:(MMServerResponseSchema *)responseSchema;
+
+/**
+ Returns request parameters with the fieldset parameters for a response schema added.  Subclasses 
+ that build requests should pass their parameters through this method.  Parameters that are already
+ present in the data are not replaced.
+ 
+ @param data A dictionary containing request parameters.  May be nil.
+ @param responseSchema The schema describing which values in the response will be imported.  May be 
+ nil.
+ @return The request parameters.
+ */
++ (NSDictionary *)parametersWithData:(NSDictionary *)data responseSchema:(MMServerResponseSchema *)responseSchema;
+
+/**
+ Returns an NSURLRequest configured as it would be for a request started with a response schema.  
+ This is used to find the cached response for requests that ask for a sparse fieldset.
+ 
+ @param URN The base URN for the request endpoint.
+ @param data A dictionary containing request parameters.
+ @param responseSchema The schema describing which values in the response will be imported.
+ @return A configured NSURLRequest.
+ @discussion The default implementation ignores the schema and calls requestWithURN:data:.
+ */
++ (NSURLRequest *)requestWithURN:(NSString *)URN
+                            data:(NSDictionary *)data
+                  responseSchema:(MMServerResponseSchema *)responseSchema;
+
+
+///-------------------------------
+/// @name Decoding Response Bodies
+///-------------------------------
+
+/**
+ Registers a decoder for the content types it handles.  Decoders are preferred in the order they are
+ registered, ahead of the built in JSON decoder.  Registered decoders are shared by every server 
+ class, as well as by the record level cache.
+ 
+ @param decoderClass A class that conforms to the MMServerResponseDecoder protocol.
+ */
++ (void)registerResponseDecoderClass:(Class<MMServerResponseDecoder>)decoderClass;
+
+/**
+ Returns the decoder for a content type.  Parameters such as charset are ignored, and structured 
+ syntax suffixes such as application/vnd.api+json are matched by their suffix.  The JSON decoder 
+ is returned for content types that no decoder handles.
+ 
+ @param contentType The MIME type of a response.
+ @return The decoder class for that content type.
+ */
++ (Class<MMServerResponseDecoder>)responseDecoderClassForContentType:(NSString *)contentType;
+
+/**
+ Returns a value for the Accept header that lists the content types of every registered decoder in
+ order of preference, followed by JSON.  Servers should send this header so that backends which 
+ support a more compact encoding can choose it.
+ 
+ @return The Accept header value.
+ */
++ (NSString *)acceptHeaderValue;
+
+/**
+ Decodes a response body using the decoder for its content type.  An empty body is decoded to nil 
+ without an error.
+ 
+ @param data The response body.
+ @param contentType The MIME type of the response.
+ @param error If the body cannot be decoded, upon return contains an error describing the problem.
+ @return The decoded response object.
+ */
++ (id)responseObjectWithData:(NSData *)data contentType:(NSString *)contentType error:(NSError **)error;
+
+/**
+ Decodes a response body using the decoder for its content type, skipping the values that are not 
+ included in the schema if the decoder supports it.
+ 
+ @param data The response body.
+ @param contentType The MIME type of the response.
+ @param schema The schema describing which values will be imported.  May be nil, in which case the 
+ whole body is decoded.
+ @param error If the body cannot be decoded, upon return contains an error describing the problem.
+ @return The decoded response object.
+ */
++ (id)responseObjectWithData:(NSData *)data
+                 contentType:(NSString *)contentType
+                      schema:(MMServerResponseSchema *)schema
+                       error:(NSError **)error;
+
 @end
\ No newline at end of file
@@ -22,7 +22,87 @@
 
 #import "MMServer.h"
 
+#import <objc/runtime.h>
+#include <xlocale.h>
+
+NSString * const MMServerEntityTagValidatorKey = @"ETag";
+NSString * const MMServerLastModifiedValidatorKey = @"Last-Modified";
+
 static MMServerSessionTimeoutBlock MM_ServerSessionTimeoutBlock;
+static NSMutableArray *MM_registeredResponseDecoderClasses;
+static NSMapTable *MM_requestRegistries;
+static NSUInteger MM_requestRegistryPruneCount;
+static char MMServerDomainSentinelKey;
+
+// The map table of request registries is pruned once it has grown to twice its size after the last
+// prune, but never below this size.
+static const NSUInteger MMServerRequestRegistryMinimumPruneCount = 16;
+
+// Response bodies nested deeper than this are rejected rather than risking a stack overflow.
+static const NSUInteger MMServerJSONMaximumDepth = 512;
+
+typedef struct {
+    const uint8_t *bytes;
+    NSUInteger length;
+    NSUInteger offset;
+} MMServerJSONReader;
+
+// This class holds the requests registered with a domain.  Registries are held in a map table that
+// holds its domains weakly, and a registry cancels its requests when it is released.  Registries are
+// only accessed with the MMServer class lock held.
+@interface MMServerRequestRegistry : NSObject
+
+@property (nonatomic, strong) NSMutableSet *requests;
+
+- (NSArray *)removeAllRequests;
+
+@end
+
+// This class is associated with a domain object so that the requests registered with the domain are
+// cancelled as soon as the domain is deallocated.
+@interface MMServerDomainSentinel : NSObject
+
+@property (nonatomic, strong) MMServerRequestRegistry *registry;
+
+@end
+
+// This class decodes JSON response bodies.  It is always available as the last decoder.  When it is
+// given a schema it scans the body itself, and values that the schema does not include are skipped
+// over without creating any objects for them.
+@interface MMServerJSONDecoder : NSObject <MMServerResponseDecoder>
+@end
+
+@interface MMServerResponseSchema ()
+
+@property (nonatomic, strong) NSMutableDictionary *childSchemas;
+
+- (MMServerResponseSchema *)copiedSchema;
+- (void)addRecordKeyPathsWithPrefix:(NSString *)prefix toArray:(NSMutableArray *)keyPaths;
+- (void)mergeChildSchema:(id)childSchema forKey:(NSString *)key;
+
+@end
+
+// Tagged pointers cannot carry associated objects and are never deallocated.  This mirrors the
+// runtime's layout, which keeps the tag in the low bit on Intel Macs and in the high bit elsewhere.
+static BOOL MMServerIsTaggedPointer(id object) {
+#if __LP64__
+#if TARGET_OS_MAC && !TARGET_OS_IPHONE && __x86_64__
+    return (((uintptr_t)(__bridge void *)object) & 1) != 0;
+#else
+    return (((uintptr_t)(__bridge void *)object) >> 63) != 0;
+#endif
+#else
+    return NO;
+#endif
+}
+
+static void MMServerCancelRequests(NSArray *requests) {
+    for (id request in requests) {
+        if ([request respondsToSelector:@selector(cancel)]) {
+            [request cancel];
+        }
+    }
+}
 
 @implementation MMServer
 
@@ -34,6 +114,111 @@ static MMServerSessionTimeoutBlock MM_ServerSessionTimeoutBlock;
     [self doesNotRecognizeSelector:_cmd];
 }
 
+
+#pragma mark - Request Registry
+
+// Domains are often strings or numbers, which may be tagged pointers that cannot carry associated
+// objects, so registries are kept in a map table keyed by the domain.  A registry is removed when its
+// last request is unregistered.
++ (void)registerRequest:(id)request forDomain:(id)domain {
+    if (request == nil || domain == nil) {
+        return;
+    }
+    
+    NSMapTable *prunedRequestRegistries = nil;
+    
+    @synchronized([MMServer class]) {
+        if (MM_requestRegistries == nil) {
+            MM_requestRegistries = [NSMapTable weakToStrongObjectsMapTable];
+            MM_requestRegistryPruneCount = MMServerRequestRegistryMinimumPruneCount;
+        }
+        
+        MMServerRequestRegistry *registry = [MM_requestRegistries objectForKey:domain];
+        
+        if (registry == nil) {
+            prunedRequestRegistries = [self pruneRequestRegistriesIfNeeded];
+            
+            registry = [[MMServerRequestRegistry alloc] init];
+            [MM_requestRegistries setObject:registry forKey:domain];
+            
+            if (MMServerIsTaggedPointer(domain) == NO) {
+                MMServerDomainSentinel *sentinel = [[MMServerDomainSentinel alloc] init];
+                sentinel.registry = registry;
+                objc_setAssociatedObject(domain, &MMServerDomainSentinelKey, sentinel, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+            }
+        }
+        
+        [registry.requests addObject:request];
+    }
+    
+    // The registries of deallocated domains that were pruned from the table are released here, after
+    // the lock has been dropped, and cancel whatever is still registered with them.
+    prunedRequestRegistries = nil;
+}
+
+// A map table with weak keys does not release the values of keys that have been deallocated until
+// it resizes itself.  Once the table has doubled in size its live entries are copied into a new
+// table, so the cost of pruning is spread over the registrations that grew it.  Returns the previous
+// table, which the caller should release after dropping the lock.  This must be called with the lock
+// held.
++ (NSMapTable *)pruneRequestRegistriesIfNeeded {
+    if ([MM_requestRegistries count] < MM_requestRegistryPruneCount) {
+        return nil;
+    }
+    
+    NSMapTable *previousRequestRegistries = MM_requestRegistries;
+    NSMapTable *requestRegistries = [NSMapTable weakToStrongObjectsMapTable];
+    
+    for (id domain in previousRequestRegistries) {
+        [requestRegistries setObject:[previousRequestRegistries objectForKey:domain] forKey:domain];
+    }
+    
+    MM_requestRegistries = requestRegistries;
+    MM_requestRegistryPruneCount = MAX(MMServerRequestRegistryMinimumPruneCount, [requestRegistries count] * 2);
+    
+    return previousRequestRegistries;
+}
+
++ (void)unregisterRequest:(id)request forDomain:(id)domain {
+    if (request == nil || domain == nil) {
+        return;
+    }
+    
+    @synchronized([MMServer class]) {
+        MMServerRequestRegistry *registry = [MM_requestRegistries objectForKey:domain];
+        
+        if (registry != nil) {
+            [registry.requests removeObject:request];
+            
+            if ([registry.requests count] == 0) {
+                [MM_requestRegistries removeObjectForKey:domain];
+            }
+        }
+    }
+}
+
++ (void)cancelRegisteredRequestsForDomain:(id)domain {
+    if (domain == nil) {
+        return;
+    }
+    
+    NSArray *requests = nil;
+    
+    @synchronized([MMServer class]) {
+        MMServerRequestRegistry *registry = [MM_requestRegistries objectForKey:domain];
+        
+        if (registry != nil) {
+            requests = [registry removeAllRequests];
+            [MM_requestRegistries removeObjectForKey:domain];
+        }
+    }
+    
+    MMServerCancelRequests(requests);
+}
+
+
+#pragma mark - Starting Requests
+
 + (void)startRequestWithURN:(NSString *)URN
                        data:(NSDictionary *)data
                       paged:(BOOL)paged
@@ -45,11 +230,293 @@ static MMServerSessionTimeoutBlock MM_ServerSessionTimeoutBlock;
     [self doesNotRecognizeSelector:_cmd];
 }
 
++ (void)startRequestWithURN:(NSString *)URN
+                       data:(NSDictionary *)data
+                      paged:(BOOL)paged
+                     domain:(id)domain
+                    batched:(BOOL)batched
+              dispatchGroup:(dispatch_group_t)dispatchGroup
+                   priority:(MMRecordRequestPriority)priority
+              responseBlock:(void(^)(id responseObject))responseBlock
+               failureBlock:(void(^)(NSError *error))failureBlock {
+    [self startRequestWithURN:URN
+                         data:data
+                        paged:paged
+                       domain:domain
+                      batched:batched
+                dispatchGroup:dispatchGroup
+                responseBlock:responseBlock
+                 failureBlock:failureBlock];
+}
+
++ (void)startConditionalRequestWithURN:(NSString *)URN
+                                  data:(NSDictionary *)data
+                                domain:(id)domain
+                               batched:(BOOL)batched
+                         dispatchGroup:(dispatch_group_t)dispatchGroup
+                              priority:(MMRecordRequestPriority)priority
+                            validators:(NSDictionary *)validators
+                         responseBlock:(void(^)(id responseObject, NSDictionary *validators))responseBlock
+                      notModifiedBlock:(void(^)(void))notModifiedBlock
+                          failureBlock:(void(^)(NSError *error))failureBlock {
+    [self startRequestWithURN:URN
+                         data:data
+                        paged:NO
+                       domain:domain
+                      batched:batched
+                dispatchGroup:dispatchGroup
+                     priority:priority
+                responseBlock:^(id responseObject) {
+                    if (responseBlock != nil) {
+                        responseBlock(responseObject, nil);
+                    }
+                }
+                 failureBlock:failureBlock];
+}
+
++ (void)startRequestWithURN:(NSString *)URN
+                       data:(NSDictionary *)data
+                      paged:(BOOL)paged
+                     domain:(id)domain
+                    batched:(BOOL)batched
+              dispatchGroup:(dispatch_group_t)dispatchGroup
+                   priority:(MMRecordRequestPriority)priority
+             responseSchema:(MMServerResponseSchema *)responseSchema
+              responseBlock:(void(^)(id responseObject))responseBlock
+               failureBlock:(void(^)(NSError *error))failureBlock {
+    [self startRequestWithURN:URN
+                         data:data
+                        paged:paged
+                       domain:domain
+                      batched:batched
+                dispatchGroup:dispatchGroup
+                     priority:priority
+                responseBlock:responseBlock
+                 failureBlock:failureBlock];
+}
+
++ (void)startConditionalRequestWithURN:(NSString *)URN
+                                  data:(NSDictionary *)data
+                                domain:(id)domain
+                               batched:(BOOL)batched
+                         dispatchGroup:(dispatch_group_t)dispatchGroup
+                              priority:(MMRecordRequestPriority)priority
+                        responseSchema:(MMServerResponseSchema *)responseSchema
+                            validators:(NSDictionary *)validators
+                         responseBlock:(void(^)(id responseObject, NSDictionary *validators))responseBlock
+                      notModifiedBlock:(void(^)(void))notModifiedBlock
+                          failureBlock:(void(^)(NSError *error))failureBlock {
+    [self startConditionalRequestWithURN:URN
+                                    data:data
+                                  domain:domain
+                                 batched:batched
+                           dispatchGroup:dispatchGroup
+                                priority:priority
+                              validators:validators
+                           responseBlock:responseBlock
+                        notModifiedBlock:notModifiedBlock
+                            failureBlock:failureBlock];
+}
+
 + (NSURLRequest *)requestWithURN:URN data:(NSDictionary *)data {
     [self doesNotRecognizeSelector:_cmd];
     return nil;
 }
 
++ (NSURLRequest *)requestWithURN:(NSString *)URN
+                            data:(NSDictionary *)data
+                  responseSchema:(MMServerResponseSchema *)responseSchema {
+    return [self requestWithURN:URN data:data];
+}
+
+
+#pragma mark - Cache Validation
+
++ (void)addValidators:(NSDictionary *)validators toRequest:(NSMutableURLRequest *)request {
+    NSString *entityTag = [validators objectForKey:MMServerEntityTagValidatorKey];
+    NSString *lastModified = [validators objectForKey:MMServerLastModifiedValidatorKey];
+    
+    if (entityTag != nil) {
+        [request setValue:entityTag forHTTPHeaderField:@"If-None-Match"];
+    }
+    
+    if (lastModified != nil) {
+        [request setValue:lastModified forHTTPHeaderField:@"If-Modified-Since"];
+    }
+}
+
++ (NSDictionary *)validatorsFromResponse:(NSHTTPURLResponse *)response {
+    NSMutableDictionary *validators = [NSMutableDictionary dictionary];
+    
+    // Header names are case insensitive, and some versions of Foundation change the case of ETag.
+    [[response allHeaderFields] enumerateKeysAndObjectsUsingBlock:^(NSString *field, id value, BOOL *stop) {
+        if ([field caseInsensitiveCompare:MMServerEntityTagValidatorKey] == NSOrderedSame) {
+            [validators setObject:value forKey:MMServerEntityTagValidatorKey];
+        } else if ([field caseInsensitiveCompare:MMServerLastModifiedValidatorKey] == NSOrderedSame) {
+            [validators setObject:value forKey:MMServerLastModifiedValidatorKey];
+        }
+    }];
+    
+    if ([validators count] == 0) {
+        return nil;
+    }
+    
+    return validators;
+}
+
+
+#pragma mark - Sparse Fieldsets
+
++ (NSString *)fieldsetParameterName {
+    return nil;
+}
+
++ (NSString *)fieldsetParameterValueForKeyPaths:(NSArray *)keyPaths {
+    return [keyPaths componentsJoinedByString:@","];
+}
+
++ (NSDictionary *)fieldsetParametersForResponseSchema:(MMServerResponseSchema *)responseSchema {
+    NSString *parameterName = [self fieldsetParameterName];
+    NSArray *keyPaths = [responseSchema recordKeyPaths];
+    
+    if (parameterName == nil || [keyPaths count] == 0) {
+        return nil;
+    }
+    
+    return @{parameterName : [self fieldsetParameterValueForKeyPaths:keyPaths]};
+}
+
++ (NSDictionary *)parametersWithData:(NSDictionary *)data responseSchema:(MMServerResponseSchema *)responseSchema {
+    if (responseSchema == nil) {
+        return data;
+    }
+    
+    NSDictionary *fieldsetParameters = [self fieldsetParametersForResponseSchema:responseSchema];
+    
+    if ([fieldsetParameters count] == 0) {
+        return data;
+    }
+    
+    NSMutableDictionary *parameters = [NSMutableDictionary dictionaryWithDictionary:fieldsetParameters];
+    [parameters addEntriesFromDictionary:data];
+    
+    return parameters;
+}
+
+
+#pragma mark - Response Decoding
+
++ (void)registerResponseDecoderClass:(Class<MMServerResponseDecoder>)decoderClass {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        MM_registeredResponseDecoderClasses = [NSMutableArray array];
+    });
+    
+    @synchronized(MM_registeredResponseDecoderClasses) {
+        if ([MM_registeredResponseDecoderClasses containsObject:decoderClass] == NO) {
+            [MM_registeredResponseDecoderClasses addObject:decoderClass];
+        }
+    }
+}
+
++ (NSArray *)responseDecoderClasses {
+    NSMutableArray *decoderClasses = [NSMutableArray array];
+    
+    if (MM_registeredResponseDecoderClasses != nil) {
+        @synchronized(MM_registeredResponseDecoderClasses) {
+            [decoderClasses addObjectsFromArray:MM_registeredResponseDecoderClasses];
+        }
+    }
+    
+    [decoderClasses addObject:[MMServerJSONDecoder class]];
+    
+    return decoderClasses;
+}
+
++ (Class<MMServerResponseDecoder>)responseDecoderClassForContentType:(NSString *)contentType {
+    NSString *mediaType = [[[contentType componentsSeparatedByString:@";"] objectAtIndex:0] lowercaseString];
+    mediaType = [mediaType stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+    
+    NSArray *decoderClasses = [self responseDecoderClasses];
+    
+    if ([mediaType length] > 0) {
+        for (Class<MMServerResponseDecoder> decoderClass in decoderClasses) {
+            for (NSString *decoderContentType in [decoderClass contentTypes]) {
+                if ([mediaType isEqualToString:[decoderContentType lowercaseString]]) {
+                    return decoderClass;
+                }
+            }
+        }
+        
+        // Structured syntax suffixes, such as application/vnd.example+msgpack.
+        for (Class<MMServerResponseDecoder> decoderClass in decoderClasses) {
+            for (NSString *decoderContentType in [decoderClass contentTypes]) {
+                NSString *subtype = [[[decoderContentType lowercaseString] componentsSeparatedByString:@"/"] lastObject];
+                
+                if ([mediaType hasSuffix:[@"+" stringByAppendingString:subtype]]) {
+                    return decoderClass;
+                }
+            }
+        }
+    }
+    
+    return [MMServerJSONDecoder class];
+}
+
++ (NSString *)acceptHeaderValue {
+    NSArray *decoderClasses = [self responseDecoderClasses];
+    NSMutableArray *mediaRanges = [NSMutableArray array];
+    NSMutableSet *listedContentTypes = [NSMutableSet set];
+    
+    float quality = 1.0;
+    
+    for (Class<MMServerResponseDecoder> decoderClass in decoderClasses) {
+        for (NSString *contentType in [decoderClass contentTypes]) {
+            // A registered decoder may replace the built in decoder for the same content types.
+            if ([listedContentTypes containsObject:[contentType lowercaseString]]) {
+                continue;
+            }
+            
+            [listedContentTypes addObject:[contentType lowercaseString]];
+            
+            if (quality >= 1.0) {
+                [mediaRanges addObject:contentType];
+            } else {
+                [mediaRanges addObject:[NSString stringWithFormat:@"%@;q=%.1f", contentType, quality]];
+            }
+        }
+        
+        quality = MAX(quality - 0.1, 0.1);
+    }
+    
+    return [mediaRanges componentsJoinedByString:@", "];
+}
+
++ (id)responseObjectWithData:(NSData *)data contentType:(NSString *)contentType error:(NSError **)error {
+    if ([data length] == 0) {
+        return nil;
+    }
+    
+    return [[self responseDecoderClassForContentType:contentType] responseObjectWithData:data error:error];
+}
+
++ (id)responseObjectWithData:(NSData *)data
+                 contentType:(NSString *)contentType
+                      schema:(MMServerResponseSchema *)schema
+                       error:(NSError **)error {
+    if ([data length] == 0) {
+        return nil;
+    }
+    
+    Class<MMServerResponseDecoder> decoderClass = [self responseDecoderClassForContentType:contentType];
+    
+    if (schema != nil && [decoderClass respondsToSelector:@selector(responseObjectWithData:schema:error:)]) {
+        return [decoderClass responseObjectWithData:data schema:schema error:error];
+    }
+    
+    return [decoderClass responseObjectWithData:data error:error];
+}
+
 + (MMServerSessionTimeoutBlock)sessionTimeoutBlock {
     return MM_ServerSessionTimeoutBlock;
 }
@@ -62,3 +529,893 @@ static MMServerSessionTimeoutBlock MM_ServerSessionTimeoutBlock;
 
 @end
 
+
+#pragma mark - MMServerJSONDecoder
+
+// Scans a number that follows the JSON grammar, starting at the reader's offset.  Returns the offset
+// just past the number, or NSNotFound if the bytes there are not a valid number.
+static NSUInteger MMServerJSONNumberEnd(MMServerJSONReader *reader, BOOL *integral) {
+    const uint8_t *bytes = reader->bytes;
+    NSUInteger length = reader->length;
+    NSUInteger offset = reader->offset;
+    *integral = YES;
+    
+    if (offset < length && bytes[offset] == '-') {
+        offset++;
+    }
+    
+    if (offset < length && bytes[offset] == '0') {
+        offset++;
+    } else if (offset < length && bytes[offset] >= '1' && bytes[offset] <= '9') {
+        while (offset < length && isdigit(bytes[offset])) {
+            offset++;
+        }
+    } else {
+        return NSNotFound;
+    }
+    
+    if (offset < length && bytes[offset] == '.') {
+        *integral = NO;
+        offset++;
+        
+        if (offset >= length || isdigit(bytes[offset]) == NO) {
+            return NSNotFound;
+        }
+        
+        while (offset < length && isdigit(bytes[offset])) {
+            offset++;
+        }
+    }
+    
+    if (offset < length && (bytes[offset] == 'e' || bytes[offset] == 'E')) {
+        *integral = NO;
+        offset++;
+        
+        if (offset < length && (bytes[offset] == '+' || bytes[offset] == '-')) {
+            offset++;
+        }
+        
+        if (offset >= length || isdigit(bytes[offset]) == NO) {
+            return NSNotFound;
+        }
+        
+        while (offset < length && isdigit(bytes[offset])) {
+            offset++;
+        }
+    }
+    
+    return offset;
+}
+
+@implementation MMServerJSONDecoder
+
++ (NSArray *)contentTypes {
+    return @[@"application/json", @"text/json", @"text/javascript"];
+}
+
++ (id)responseObjectWithData:(NSData *)data error:(NSError **)error {
+    return [NSJSONSerialization JSONObjectWithData:data options:0 error:error];
+}
+
++ (id)responseObjectWithData:(NSData *)data schema:(MMServerResponseSchema *)schema error:(NSError **)error {
+    MMServerJSONReader reader = { [data bytes], [data length], 0 };
+    
+    [self skipWhitespaceWithReader:&reader];
+    
+    // UTF-16 and UTF-32 bodies, and bodies that are not a dictionary or an array, are left to
+    // NSJSONSerialization.
+    if (reader.offset >= reader.length ||
+        (reader.bytes[reader.offset] != '{' && reader.bytes[reader.offset] != '[') ||
+        memchr(reader.bytes, 0, MIN(reader.length, 4)) != NULL) {
+        return [self responseObjectWithData:data error:error];
+    }
+    
+    id object = [self valueWithReader:&reader schema:schema depth:0 error:error];
+    
+    if (object == nil) {
+        return nil;
+    }
+    
+    [self skipWhitespaceWithReader:&reader];
+    
+    if (reader.offset != reader.length) {
+        return [self invalidDataWithReader:&reader error:error];
+    }
+    
+    return object;
+}
+
+
+#pragma mark - Decoding Values
+
+// A nil schema means that the value is decoded in full.
++ (id)valueWithReader:(MMServerJSONReader *)reader
+               schema:(MMServerResponseSchema *)schema
+                depth:(NSUInteger)depth
+                error:(NSError **)error {
+    [self skipWhitespaceWithReader:reader];
+    
+    if (reader->offset >= reader->length) {
+        return [self invalidDataWithReader:reader error:error];
+    }
+    
+    switch (reader->bytes[reader->offset]) {
+        case '{':
+            return [self dictionaryWithReader:reader schema:schema depth:depth error:error];
+        case '[':
+            return [self arrayWithReader:reader schema:schema depth:depth error:error];
+        case '"':
+            return [self stringWithReader:reader error:error];
+        case 't':
+            return [self literal:"true" value:[NSNumber numberWithBool:YES] reader:reader error:error];
+        case 'f':
+            return [self literal:"false" value:[NSNumber numberWithBool:NO] reader:reader error:error];
+        case 'n':
+            return [self literal:"null" value:[NSNull null] reader:reader error:error];
+        default:
+            return [self numberWithReader:reader error:error];
+    }
+}
+
++ (id)dictionaryWithReader:(MMServerJSONReader *)reader
+                    schema:(MMServerResponseSchema *)schema
+                     depth:(NSUInteger)depth
+                     error:(NSError **)error {
+    if (depth >= MMServerJSONMaximumDepth) {
+        return [self invalidDataWithReader:reader error:error];
+    }
+    
+    NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
+    
+    reader->offset++;
+    [self skipWhitespaceWithReader:reader];
+    
+    if (reader->offset < reader->length && reader->bytes[reader->offset] == '}') {
+        reader->offset++;
+        return dictionary;
+    }
+    
+    while (YES) {
+        [self skipWhitespaceWithReader:reader];
+        
+        if (reader->offset >= reader->length || reader->bytes[reader->offset] != '"') {
+            return [self invalidDataWithReader:reader error:error];
+        }
+        
+        BOOL includesValue = YES;
+        MMServerResponseSchema *childSchema = nil;
+        NSString *key = nil;
+        
+        if (schema == nil) {
+            key = [self stringWithReader:reader error:error];
+        } else {
+            key = [self keyWithReader:reader schema:schema includesValue:&includesValue childSchema:&childSchema error:error];
+        }
+        
+        if (key == nil) {
+            return nil;
+        }
+        
+        [self skipWhitespaceWithReader:reader];
+        
+        if (reader->offset >= reader->length || reader->bytes[reader->offset] != ':') {
+            return [self invalidDataWithReader:reader error:error];
+        }
+        
+        reader->offset++;
+        
+        if (includesValue) {
+            id value = [self valueWithReader:reader schema:childSchema depth:depth + 1 error:error];
+            
+            if (value == nil) {
+                return nil;
+            }
+            
+            [dictionary setObject:value forKey:key];
+        } else if ([self skipValueWithReader:reader depth:depth + 1] == NO) {
+            return [self invalidDataWithReader:reader error:error];
+        }
+        
+        [self skipWhitespaceWithReader:reader];
+        
+        if (reader->offset >= reader->length) {
+            return [self invalidDataWithReader:reader error:error];
+        }
+        
+        uint8_t separator = reader->bytes[reader->offset++];
+        
+        if (separator == '}') {
+            return dictionary;
+        } else if (separator != ',') {
+            reader->offset--;
+            return [self invalidDataWithReader:reader error:error];
+        }
+    }
+}
+
+// Looks up a key in the schema without copying its bytes, so that keys whose values are skipped do
+// not allocate any storage for their characters.  Only keys that are kept are copied.
++ (NSString *)keyWithReader:(MMServerJSONReader *)reader
+                     schema:(MMServerResponseSchema *)schema
+              includesValue:(BOOL *)includesValue
+                childSchema:(MMServerResponseSchema **)childSchema
+                      error:(NSError **)error {
+    NSUInteger start = reader->offset + 1;
+    NSUInteger end = start;
+    
+    while (end < reader->length && reader->bytes[end] != '"' && reader->bytes[end] != '\\' && reader->bytes[end] >= 0x20) {
+        end++;
+    }
+    
+    // Keys with escape sequences are decoded in full, and keys with control characters are rejected
+    // by the full decoding.
+    if (end >= reader->length || reader->bytes[end] != '"') {
+        NSString *key = [self stringWithReader:reader error:error];
+        
+        if (key != nil) {
+            *includesValue = [schema includesKey:key schema:childSchema];
+        }
+        
+        return key;
+    }
+    
+    NSString *key = [[NSString alloc] initWithBytesNoCopy:(void *)(reader->bytes + start)
+                                                   length:end - start
+                                                 encoding:NSUTF8StringEncoding
+                                             freeWhenDone:NO];
+    
+    if (key == nil) {
+        return [self invalidDataWithReader:reader error:error];
+    }
+    
+    *includesValue = [schema includesKey:key schema:childSchema];
+    
+    if (*includesValue) {
+        key = [[NSString alloc] initWithBytes:reader->bytes + start length:end - start encoding:NSUTF8StringEncoding];
+    }
+    
+    reader->offset = end + 1;
+    
+    return key;
+}
+
++ (id)arrayWithReader:(MMServerJSONReader *)reader
+               schema:(MMServerResponseSchema *)schema
+                depth:(NSUInteger)depth
+                error:(NSError **)error {
+    if (depth >= MMServerJSONMaximumDepth) {
+        return [self invalidDataWithReader:reader error:error];
+    }
+    
+    NSMutableArray *array = [NSMutableArray array];
+    
+    reader->offset++;
+    [self skipWhitespaceWithReader:reader];
+    
+    if (reader->offset < reader->length && reader->bytes[reader->offset] == ']') {
+        reader->offset++;
+        return array;
+    }
+    
+    while (YES) {
+        id value = [self valueWithReader:reader schema:schema depth:depth + 1 error:error];
+        
+        if (value == nil) {
+            return nil;
+        }
+        
+        [array addObject:value];
+        
+        [self skipWhitespaceWithReader:reader];
+        
+        if (reader->offset >= reader->length) {
+            return [self invalidDataWithReader:reader error:error];
+        }
+        
+        uint8_t separator = reader->bytes[reader->offset++];
+        
+        if (separator == ']') {
+            return array;
+        } else if (separator != ',') {
+            reader->offset--;
+            return [self invalidDataWithReader:reader error:error];
+        }
+    }
+}
+
++ (id)stringWithReader:(MMServerJSONReader *)reader error:(NSError **)error {
+    NSUInteger start = reader->offset + 1;
+    NSUInteger end = start;
+    
+    while (end < reader->length && reader->bytes[end] != '"' && reader->bytes[end] != '\\') {
+        if (reader->bytes[end] < 0x20) {
+            reader->offset = end;
+            return [self invalidDataWithReader:reader error:error];
+        }
+        
+        end++;
+    }
+    
+    if (end >= reader->length) {
+        reader->offset = end;
+        return [self invalidDataWithReader:reader error:error];
+    }
+    
+    NSString *string = nil;
+    
+    if (reader->bytes[end] == '"') {
+        string = [[NSString alloc] initWithBytes:reader->bytes + start length:end - start encoding:NSUTF8StringEncoding];
+        reader->offset = end + 1;
+    } else {
+        NSMutableData *buffer = [NSMutableData dataWithBytes:reader->bytes + start length:end - start];
+        reader->offset = end;
+        
+        if ([self appendEscapedStringWithReader:reader toBuffer:buffer] == NO) {
+            return [self invalidDataWithReader:reader error:error];
+        }
+        
+        string = [[NSString alloc] initWithData:buffer encoding:NSUTF8StringEncoding];
+    }
+    
+    if (string == nil) {
+        return [self invalidDataWithReader:reader error:error];
+    }
+    
+    return string;
+}
+
+// Appends the rest of a string that contains escape sequences to the buffer, and consumes the
+// closing quote.
++ (BOOL)appendEscapedStringWithReader:(MMServerJSONReader *)reader toBuffer:(NSMutableData *)buffer {
+    while (reader->offset < reader->length) {
+        uint8_t character = reader->bytes[reader->offset++];
+        
+        if (character == '"') {
+            return YES;
+        }
+        
+        if (character < 0x20) {
+            return NO;
+        }
+        
+        if (character != '\\') {
+            [buffer appendBytes:&character length:1];
+            continue;
+        }
+        
+        if (reader->offset >= reader->length) {
+            return NO;
+        }
+        
+        uint8_t escaped = reader->bytes[reader->offset++];
+        uint8_t unescaped = 0;
+        
+        switch (escaped) {
+            case '"':
+            case '\\':
+            case '/':
+                unescaped = escaped;
+                break;
+            case 'b':
+                unescaped = '\b';
+                break;
+            case 'f':
+                unescaped = '\f';
+                break;
+            case 'n':
+                unescaped = '\n';
+                break;
+            case 'r':
+                unescaped = '\r';
+                break;
+            case 't':
+                unescaped = '\t';
+                break;
+            case 'u': {
+                uint32_t codePoint = 0;
+                
+                if ([self readHexCodeUnit:&codePoint reader:reader] == NO) {
+                    return NO;
+                }
+                
+                if (codePoint >= 0xd800 && codePoint <= 0xdbff) {
+                    uint32_t lowSurrogate = 0;
+                    
+                    if (reader->offset + 2 > reader->length ||
+                        reader->bytes[reader->offset] != '\\' ||
+                        reader->bytes[reader->offset + 1] != 'u') {
+                        return NO;
+                    }
+                    
+                    reader->offset += 2;
+                    
+                    if ([self readHexCodeUnit:&lowSurrogate reader:reader] == NO ||
+                        lowSurrogate < 0xdc00 || lowSurrogate > 0xdfff) {
+                        return NO;
+                    }
+                    
+                    codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (lowSurrogate - 0xdc00);
+                } else if (codePoint >= 0xdc00 && codePoint <= 0xdfff) {
+                    return NO;
+                }
+                
+                [self appendCodePoint:codePoint toBuffer:buffer];
+                continue;
+            }
+            default:
+                return NO;
+        }
+        
+        [buffer appendBytes:&unescaped length:1];
+    }
+    
+    return NO;
+}
+
++ (BOOL)readHexCodeUnit:(uint32_t *)codeUnit reader:(MMServerJSONReader *)reader {
+    if (reader->offset + 4 > reader->length) {
+        return NO;
+    }
+    
+    uint32_t value = 0;
+    
+    for (NSUInteger i = 0; i < 4; i++) {
+        uint8_t character = reader->bytes[reader->offset + i];
+        value <<= 4;
+        
+        if (character >= '0' && character <= '9') {
+            value |= character - '0';
+        } else if (character >= 'a' && character <= 'f') {
+            value |= character - 'a' + 10;
+        } else if (character >= 'A' && character <= 'F') {
+            value |= character - 'A' + 10;
+        } else {
+            return NO;
+        }
+    }
+    
+    reader->offset += 4;
+    *codeUnit = value;
+    
+    return YES;
+}
+
++ (void)appendCodePoint:(uint32_t)codePoint toBuffer:(NSMutableData *)buffer {
+    uint8_t bytes[4];
+    NSUInteger length = 0;
+    
+    if (codePoint < 0x80) {
+        bytes[length++] = codePoint;
+    } else if (codePoint < 0x800) {
+        bytes[length++] = 0xc0 | (codePoint >> 6);
+        bytes[length++] = 0x80 | (codePoint & 0x3f);
+    } else if (codePoint < 0x10000) {
+        bytes[length++] = 0xe0 | (codePoint >> 12);
+        bytes[length++] = 0x80 | ((codePoint >> 6) & 0x3f);
+        bytes[length++] = 0x80 | (codePoint & 0x3f);
+    } else {
+        bytes[length++] = 0xf0 | (codePoint >> 18);
+        bytes[length++] = 0x80 | ((codePoint >> 12) & 0x3f);
+        bytes[length++] = 0x80 | ((codePoint >> 6) & 0x3f);
+        bytes[length++] = 0x80 | (codePoint & 0x3f);
+    }
+    
+    [buffer appendBytes:bytes length:length];
+}
+
++ (id)numberWithReader:(MMServerJSONReader *)reader error:(NSError **)error {
+    NSUInteger start = reader->offset;
+    BOOL integral = YES;
+    NSUInteger offset = MMServerJSONNumberEnd(reader, &integral);
+    
+    if (offset == NSNotFound) {
+        return [self invalidDataWithReader:reader error:error];
+    }
+    
+    reader->offset = offset;
+    
+    NSUInteger length = offset - start;
+    char buffer[64];
+    
+    if (length >= sizeof(buffer)) {
+        NSString *string = [[NSString alloc] initWithBytes:reader->bytes + start length:length encoding:NSUTF8StringEncoding];
+        
+        return [NSDecimalNumber decimalNumberWithString:string];
+    }
+    
+    memcpy(buffer, reader->bytes + start, length);
+    buffer[length] = '\0';
+    
+    if (integral) {
+        errno = 0;
+        long long value = strtoll(buffer, NULL, 10);
+        
+        if (errno != ERANGE) {
+            return [NSNumber numberWithLongLong:value];
+        }
+        
+        if (buffer[0] != '-') {
+            errno = 0;
+            unsigned long long unsignedValue = strtoull(buffer, NULL, 10);
+            
+            if (errno != ERANGE) {
+                return [NSNumber numberWithUnsignedLongLong:unsignedValue];
+            }
+        }
+    }
+    
+    return [NSNumber numberWithDouble:strtod_l(buffer, NULL, NULL)];
+}
+
++ (id)literal:(const char *)literal value:(id)value reader:(MMServerJSONReader *)reader error:(NSError **)error {
+    size_t length = strlen(literal);
+    
+    if (reader->offset + length > reader->length ||
+        memcmp(reader->bytes + reader->offset, literal, length) != 0) {
+        return [self invalidDataWithReader:reader error:error];
+    }
+    
+    reader->offset += length;
+    
+    return value;
+}
+
+
+#pragma mark - Skipping Values
+
+// Skips a value that the schema does not include.  Skipped values follow the same grammar as the
+// values that are decoded, so invalid JSON is rejected either way, but no objects are created for
+// them.
++ (BOOL)skipValueWithReader:(MMServerJSONReader *)reader depth:(NSUInteger)depth {
+    [self skipWhitespaceWithReader:reader];
+    
+    if (reader->offset >= reader->length) {
+        return NO;
+    }
+    
+    switch (reader->bytes[reader->offset]) {
+        case '{':
+            return [self skipDictionaryWithReader:reader depth:depth];
+        case '[':
+            return [self skipArrayWithReader:reader depth:depth];
+        case '"':
+            return [self skipStringWithReader:reader];
+        case 't':
+            return ([self literal:"true" value:[NSNull null] reader:reader error:NULL] != nil);
+        case 'f':
+            return ([self literal:"false" value:[NSNull null] reader:reader error:NULL] != nil);
+        case 'n':
+            return ([self literal:"null" value:[NSNull null] reader:reader error:NULL] != nil);
+        default: {
+            BOOL integral = YES;
+            NSUInteger offset = MMServerJSONNumberEnd(reader, &integral);
+            
+            if (offset == NSNotFound) {
+                return NO;
+            }
+            
+            reader->offset = offset;
+            return YES;
+        }
+    }
+}
+
++ (BOOL)skipDictionaryWithReader:(MMServerJSONReader *)reader depth:(NSUInteger)depth {
+    if (depth >= MMServerJSONMaximumDepth) {
+        return NO;
+    }
+    
+    reader->offset++;
+    [self skipWhitespaceWithReader:reader];
+    
+    if (reader->offset < reader->length && reader->bytes[reader->offset] == '}') {
+        reader->offset++;
+        return YES;
+    }
+    
+    while (YES) {
+        [self skipWhitespaceWithReader:reader];
+        
+        if (reader->offset >= reader->length ||
+            reader->bytes[reader->offset] != '"' ||
+            [self skipStringWithReader:reader] == NO) {
+            return NO;
+        }
+        
+        [self skipWhitespaceWithReader:reader];
+        
+        if (reader->offset >= reader->length || reader->bytes[reader->offset] != ':') {
+            return NO;
+        }
+        
+        reader->offset++;
+        
+        if ([self skipValueWithReader:reader depth:depth + 1] == NO) {
+            return NO;
+        }
+        
+        [self skipWhitespaceWithReader:reader];
+        
+        if (reader->offset >= reader->length) {
+            return NO;
+        }
+        
+        uint8_t separator = reader->bytes[reader->offset++];
+        
+        if (separator == '}') {
+            return YES;
+        } else if (separator != ',') {
+            reader->offset--;
+            return NO;
+        }
+    }
+}
+
++ (BOOL)skipArrayWithReader:(MMServerJSONReader *)reader depth:(NSUInteger)depth {
+    if (depth >= MMServerJSONMaximumDepth) {
+        return NO;
+    }
+    
+    reader->offset++;
+    [self skipWhitespaceWithReader:reader];
+    
+    if (reader->offset < reader->length && reader->bytes[reader->offset] == ']') {
+        reader->offset++;
+        return YES;
+    }
+    
+    while (YES) {
+        if ([self skipValueWithReader:reader depth:depth + 1] == NO) {
+            return NO;
+        }
+        
+        [self skipWhitespaceWithReader:reader];
+        
+        if (reader->offset >= reader->length) {
+            return NO;
+        }
+        
+        uint8_t separator = reader->bytes[reader->offset++];
+        
+        if (separator == ']') {
+            return YES;
+        } else if (separator != ',') {
+            reader->offset--;
+            return NO;
+        }
+    }
+}
+
+// Checks control characters and escape sequences the same way that stringWithReader:error: does,
+// without copying the string.
++ (BOOL)skipStringWithReader:(MMServerJSONReader *)reader {
+    reader->offset++;
+    
+    while (reader->offset < reader->length) {
+        uint8_t character = reader->bytes[reader->offset++];
+        
+        if (character == '"') {
+            return YES;
+        }
+        
+        if (character < 0x20) {
+            return NO;
+        }
+        
+        if (character != '\\') {
+            continue;
+        }
+        
+        if (reader->offset >= reader->length) {
+            return NO;
+        }
+        
+        uint8_t escaped = reader->bytes[reader->offset++];
+        
+        if (escaped == 'u') {
+            uint32_t codePoint = 0;
+            
+            if ([self readHexCodeUnit:&codePoint reader:reader] == NO) {
+                return NO;
+            }
+            
+            if (codePoint >= 0xd800 && codePoint <= 0xdbff) {
+                uint32_t lowSurrogate = 0;
+                
+                if (reader->offset + 2 > reader->length ||
+                    reader->bytes[reader->offset] != '\\' ||
+                    reader->bytes[reader->offset + 1] != 'u') {
+                    return NO;
+                }
+                
+                reader->offset += 2;
+                
+                if ([self readHexCodeUnit:&lowSurrogate reader:reader] == NO ||
+                    lowSurrogate < 0xdc00 || lowSurrogate > 0xdfff) {
+                    return NO;
+                }
+            } else if (codePoint >= 0xdc00 && codePoint <= 0xdfff) {
+                return NO;
+            }
+        } else if (strchr("\"\\/bfnrt", escaped) == NULL || escaped == '\0') {
+            return NO;
+        }
+    }
+    
+    return NO;
+}
+
++ (void)skipWhitespaceWithReader:(MMServerJSONReader *)reader {
+    while (reader->offset < reader->length) {
+        uint8_t character = reader->bytes[reader->offset];
+        
+        if (character != ' ' && character != '\t' && character != '\n' && character != '\r') {
+            return;
+        }
+        
+        reader->offset++;
+    }
+}
+
++ (id)invalidDataWithReader:(MMServerJSONReader *)reader error:(NSError **)error {
+    if (error != NULL) {
+        NSString *description = [NSString stringWithFormat:@"The JSON response is not valid around character %lu.", (unsigned long)reader->offset];
+        
+        *error = [NSError errorWithDomain:NSCocoaErrorDomain
+                                     code:NSPropertyListReadCorruptError
+                                 userInfo:@{NSLocalizedDescriptionKey : description}];
+    }
+    
+    return nil;
+}
+
+@end
+
+
+#pragma mark - MMServerResponseSchema
+
+@implementation MMServerResponseSchema
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        _childSchemas = [NSMutableDictionary dictionary];
+    }
+    
+    return self;
+}
+
+- (void)addKeyPath:(NSString *)keyPath schema:(MMServerResponseSchema *)schema {
+    NSArray *keys = [keyPath componentsSeparatedByString:@"."];
+    MMServerResponseSchema *parentSchema = self;
+    
+    // Child schemas may be shared with other schemas, so they are copied before being changed.
+    for (NSUInteger i = 0; i + 1 < [keys count]; i++) {
+        NSString *key = [keys objectAtIndex:i];
+        id childSchema = [parentSchema.childSchemas objectForKey:key];
+        
+        if (childSchema == [NSNull null]) {
+            return;
+        }
+        
+        childSchema = (childSchema == nil) ? [MMServerResponseSchema new] : [childSchema copiedSchema];
+        [parentSchema.childSchemas setObject:childSchema forKey:key];
+        parentSchema = childSchema;
+    }
+    
+    [parentSchema mergeChildSchema:(schema ?: (id)[NSNull null]) forKey:[keys lastObject]];
+}
+
+- (BOOL)includesKey:(NSString *)key schema:(MMServerResponseSchema **)schema {
+    id childSchema = [self.childSchemas objectForKey:key];
+    
+    if (schema != NULL) {
+        *schema = (childSchema == [NSNull null]) ? nil : childSchema;
+    }
+    
+    if (childSchema == nil) {
+        return self.includesUnlistedKeys;
+    }
+    
+    return YES;
+}
+
+- (NSArray *)recordKeyPaths {
+    NSMutableArray *keyPaths = [NSMutableArray array];
+    
+    [self addRecordKeyPathsWithPrefix:nil toArray:keyPaths];
+    
+    return [keyPaths sortedArrayUsingSelector:@selector(compare:)];
+}
+
+- (void)addRecordKeyPathsWithPrefix:(NSString *)prefix toArray:(NSMutableArray *)keyPaths {
+    [self.childSchemas enumerateKeysAndObjectsUsingBlock:^(NSString *key, id childSchema, BOOL *stop) {
+        if (self.includesUnlistedKeys) {
+            if (childSchema != [NSNull null]) {
+                [childSchema addRecordKeyPathsWithPrefix:prefix toArray:keyPaths];
+            }
+            
+            return;
+        }
+        
+        NSString *keyPath = (prefix != nil) ? [NSString stringWithFormat:@"%@.%@", prefix, key] : key;
+        
+        if (childSchema == [NSNull null] || [[childSchema childSchemas] count] == 0) {
+            [keyPaths addObject:keyPath];
+        } else {
+            [childSchema addRecordKeyPathsWithPrefix:keyPath toArray:keyPaths];
+        }
+    }];
+}
+
+- (MMServerResponseSchema *)copiedSchema {
+    MMServerResponseSchema *schema = [MMServerResponseSchema new];
+    schema.includesUnlistedKeys = self.includesUnlistedKeys;
+    [schema.childSchemas addEntriesFromDictionary:self.childSchemas];
+    
+    return schema;
+}
+
+- (void)mergeChildSchema:(id)childSchema forKey:(NSString *)key {
+    id existingSchema = [self.childSchemas objectForKey:key];
+    
+    if (existingSchema == nil || childSchema == [NSNull null]) {
+        [self.childSchemas setObject:childSchema forKey:key];
+    } else if (existingSchema != [NSNull null]) {
+        MMServerResponseSchema *mergedSchema = [existingSchema copiedSchema];
+        mergedSchema.includesUnlistedKeys = mergedSchema.includesUnlistedKeys || [childSchema includesUnlistedKeys];
+        
+        [[childSchema childSchemas] enumerateKeysAndObjectsUsingBlock:^(id childKey, id grandchildSchema, BOOL *stop) {
+            [mergedSchema mergeChildSchema:grandchildSchema forKey:childKey];
+        }];
+        
+        [self.childSchemas setObject:mergedSchema forKey:key];
+    }
+}
+
+@end
+
+
+#pragma mark - MMServerRequestRegistry
+
+@implementation MMServerRequestRegistry
+
+- (instancetype)init {
+    if ((self = [super init])) {
+        _requests = [NSMutableSet set];
+    }
+    
+    return self;
+}
+
+- (NSArray *)removeAllRequests {
+    NSArray *requests = [self.requests allObjects];
+    [self.requests removeAllObjects];
+    return requests;
+}
+
+// Nothing else refers to a registry that is being deallocated, so the lock is not needed here.
+- (void)dealloc {
+    MMServerCancelRequests([self removeAllRequests]);
+}
+
+@end
+
+
+#pragma mark - MMServerDomainSentinel
+
+@implementation MMServerDomainSentinel
+
+// The sentinel is released while its domain is being deallocated, so the registry can no longer be
+// looked up by the domain.  The registry is left in the table without requests until it is pruned.
+- (void)dealloc {
+    NSArray *requests = nil;
+    
+    @synchronized([MMServer class]) {
+        requests = [self.registry removeAllRequests];
+    }
+    
+    MMServerCancelRequests(requests);
+}
+
+@end
+
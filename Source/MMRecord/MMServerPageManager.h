@@ -122,10 +122,52 @@
 - (NSDictionary *)nextPageData;
 
 
+///-------------------------------------------
+/// @name Defining the Requests for Other Pages
+///-------------------------------------------
+
+/**
+ This method should return the URN for the page at the given index, where the page at index 0 is 
+ the first page of the results.  Implementing this method allows the remaining pages of a request 
+ to be requested concurrently once the first page has arrived.  If you implement it then you must 
+ also implement totalResultsCount and resultsPerPage.  The default implementation returns nil, which
+ means that pages can only be requested one after another.
+ 
+ @param pageIndex The zero-based index of the page.
+ @return the URN for the page at the given index
+ */
+- (NSString *)URNForPageAtIndex:(NSInteger)pageIndex;
+
+/**
+ This method should return the parameters for requesting the page at the given index.  If your API
+ uses a page or offset parameter then this will generally be a copy of requestData with that 
+ parameter changed.  The default implementation returns nil.
+ 
+ @param pageIndex The zero-based index of the page.
+ @return the dictionary containing parameters for requesting the page at the given index
+ */
+- (NSDictionary *)dataForPageAtIndex:(NSInteger)pageIndex;
+
+/**
+ The total number of pages.  The default implementation computes this from totalResultsCount and 
+ resultsPerPage.
+ 
+ @return The total number of pages.
+ */
+- (NSInteger)pageCount;
+
+
 ///-------------------------------------------
 /// @name Metadata Describing the Current Page
 ///-------------------------------------------
 
+/**
+ The number of records from this page that were not in the persistent store before the page was 
+ imported.  This is set by MMRecord before the page manager is passed to the result block.  A page 
+ where this is zero contained only records that were already known.
+ */
+@property (nonatomic, assign) NSUInteger insertedRecordCount;
+
 /**
  The total number of results.  This should be the same regardless of which page you're on for a 
  given set of results.
@@ -151,6 +193,58 @@
 - (NSInteger)currentPageIndex;
 
 
+///--------------------------------
+/// @name Supporting a Delta Sync
+///--------------------------------
+
+/**
+ This method should return a value that marks the newest record in this page, such as the maximum 
+ ID or the latest modification date returned by the server.  A delta sync stores the high water mark
+ of its first page and uses it to request only newer records the next time it runs.  The value is 
+ persisted, so it must be a property list object.  The default implementation returns nil.
+ 
+ @return The high water mark for this page.
+ */
+- (id)highWaterMark;
+
+/**
+ This method should return the parameters for requesting only the records that are newer than the 
+ given high water mark, such as a copy of requestData with a since_id parameter added.  The pages 
+ after the first one are requested using nextPageURN and nextPageData as usual, so those should 
+ preserve that parameter.  The default implementation returns requestData unchanged.
+ 
+ @param requestData The parameters of the request that would fetch the newest page of records.
+ @param highWaterMark The high water mark from the previous delta sync.
+ @return the dictionary containing parameters for requesting records newer than the high water mark
+ */
++ (NSDictionary *)requestData:(NSDictionary *)requestData forRecordsNewerThanHighWaterMark:(id)highWaterMark;
+
+
+///-------------------------------
+/// @name Checkpointing a Paged Sync
+///-------------------------------
+
+/**
+ This method should return any state that the page manager needs, in addition to the next page URN
+ and data, in order to continue a paged sync later on.  For example, a page manager that stitches 
+ gaps in a timeline might return the maximum ID it has seen so far.  The dictionary is persisted 
+ after every page of a resumable sync, so it must only contain property list objects.  The default 
+ implementation returns nil.
+ 
+ @return A dictionary describing the page manager's position in the sync.
+ */
+- (NSDictionary *)checkpointCursor;
+
+/**
+ This method is called with the cursor returned by checkpointCursor for the previous page of a 
+ resumable sync, before the page manager is passed to the result block.  This includes the first
+ page after a sync has been resumed from a checkpoint.  The default implementation does nothing.
+ 
+ @param cursor The cursor returned by the previous page's page manager.
+ */
+- (void)restoreCheckpointCursor:(NSDictionary *)cursor;
+
+
 ///------------------------------------
 /// @name Next Page Request Convenience
 ///------------------------------------
@@ -65,6 +65,24 @@
     return nil;
 }
 
+- (NSString *)URNForPageAtIndex:(NSInteger)pageIndex {
+    return nil;
+}
+
+- (NSDictionary *)dataForPageAtIndex:(NSInteger)pageIndex {
+    return nil;
+}
+
+- (NSInteger)pageCount {
+    NSInteger resultsPerPage = [self resultsPerPage];
+    
+    if (resultsPerPage <= 0) {
+        return 0;
+    }
+    
+    return ([self totalResultsCount] + resultsPerPage - 1) / resultsPerPage;
+}
+
 - (NSInteger)totalResultsCount {
     [self doesNotRecognizeSelector:_cmd];
     
@@ -83,6 +101,22 @@
     return 0;
 }
 
+- (id)highWaterMark {
+    return nil;
+}
+
++ (NSDictionary *)requestData:(NSDictionary *)requestData forRecordsNewerThanHighWaterMark:(id)highWaterMark {
+    return requestData;
+}
+
+- (NSDictionary *)checkpointCursor {
+    return nil;
+}
+
+- (void)restoreCheckpointCursor:(NSDictionary *)cursor {
+    
+}
+
 - (void)startNextPageRequestWithContext:(NSManagedObjectContext*)context
                                  domain:(id)domain
                             resultBlock:(void(^)(NSArray *objects, id pageManager, BOOL *requestNextPage))resultBlock
@@ -28,10 +28,20 @@
  This is a basic implementation of `MMServer` that uses a simple configuration along with an 
  AFHTTPClient as the backbone for making requests for MMRecord. This class allows you to register 
  your instance of an AFHTTPClient subclass to be used to make GET requests to whatever web server 
- it is configured for. The AFJSONRequestOperation will be used to make the requests sent to this 
- server, and the response JSON will be returned in the response block. Errors will get forwarded
+ it is configured for. An AFHTTPRequestOperation will be used to make the requests sent to this 
+ server, and the decoded response will be returned in the response block. Errors will get forwarded
  through the failureBlock if the request fails.
  
+ ## Response Decoding
+ 
+ Response bodies are decoded on a background queue using the MMServer decoder registered for the 
+ response's content type, or as JSON if there is none.  Requests send an Accept header listing the 
+ registered decoders unless the AFHTTPClient already sets one, so a backend that supports a binary 
+ encoding such as MessagePack can choose it.  When MMRecord passes a response schema, JSON bodies are
+ decoded without creating objects for the values that the records do not map.  Subclasses for APIs 
+ that support sparse fieldsets can override fieldsetParameterName to also ask the server for only 
+ those values.
+ 
  This server implementation is not intended to be canonical. It is highly likely that this server 
  will not be sufficient for complex use cases and APIs. In those cases, it is highly recommended 
  that you subclass MMServer direction and provide your own implementation to fit your given API and 
@@ -50,9 +60,17 @@
  
  ## Cancellation
  
- This server implementation does support cancellation. In this case, the class name of the domain 
- object is associated with the AFJSONRequestOperation. If the server is asked to cancel requests 
- for a given domain, all AFJSONRequestOperations associated with that domain will be cancelled.
+ This server implementation does support cancellation. Each AFHTTPRequestOperation is registered 
+ with the domain object it was started for. If the server is asked to cancel requests for a given 
+ domain, the operations registered with that domain instance will be cancelled. Requests started for
+ other instances of the same class are not affected. Operations are also cancelled automatically if 
+ their domain is deallocated.
+ 
+ ## Conditional Requests
+ 
+ This server implementation does support conditional requests. The stored ETag and Last-Modified 
+ validators are sent as If-None-Match and If-Modified-Since headers, and a 304 Not Modified response
+ is reported through the notModifiedBlock instead of the failureBlock.
  
  ## Pagination
  
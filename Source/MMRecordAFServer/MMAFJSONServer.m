@@ -22,9 +22,8 @@
 
 #import "MMAFJSONServer.h"
 
-#import <objc/runtime.h>
 #import "AFHTTPClient.h"
-#import "AFJSONRequestOperation.h"
+#import "AFHTTPRequestOperation.h"
 
 static id MMAFHTTPServer_registeredAFHTTPClient;
 
@@ -41,21 +40,7 @@ static id MMAFHTTPServer_registeredAFHTTPClient;
 }
 
 + (void)cancelRequestsWithDomain:(id)domain {
-    id client = MMAFHTTPServer_registeredAFHTTPClient;
-    
-    if (domain) {
-        for (NSOperation *operation in [[client performSelector:@selector(operationQueue)] operations]) {
-            if (![operation isKindOfClass:[AFJSONRequestOperation class]]) {
-                continue;
-            }
-            
-            Class domainClass = [domain class];
-            
-            if ([[self requestOperationDomainForOperation:operation] isEqualToString:NSStringFromClass(domainClass)]) {
-                [operation cancel];
-            }
-        }
-    }
+    [self cancelRegisteredRequestsForDomain:domain];
 }
 
 + (void)startRequestWithURN:(NSString *)URN
@@ -66,41 +51,231 @@ static id MMAFHTTPServer_registeredAFHTTPClient;
               dispatchGroup:(dispatch_group_t)dispatchGroup
               responseBlock:(void (^)(id responseObject))responseBlock
                failureBlock:(void (^)(NSError *error))failureBlock {
-    NSString* newURN = [URN stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding];
-    NSDictionary *newData = data;
-    id client = MMAFHTTPServer_registeredAFHTTPClient;
-    
+    [self startRequestWithURN:URN
+                         data:data
+                        paged:paged
+                       domain:domain
+                      batched:batched
+                dispatchGroup:dispatchGroup
+                     priority:MMRecordRequestPriorityDefault
+                responseBlock:responseBlock
+                 failureBlock:failureBlock];
+}
+
++ (void)startRequestWithURN:(NSString *)URN
+                       data:(NSDictionary *)data
+                      paged:(BOOL)paged
+                     domain:(id)domain
+                    batched:(BOOL)batched
+              dispatchGroup:(dispatch_group_t)dispatchGroup
+                   priority:(MMRecordRequestPriority)priority
+              responseBlock:(void (^)(id responseObject))responseBlock
+               failureBlock:(void (^)(NSError *error))failureBlock {
+    [self startRequestWithURN:URN
+                         data:data
+                        paged:paged
+                       domain:domain
+                      batched:batched
+                dispatchGroup:dispatchGroup
+                     priority:priority
+               responseSchema:nil
+                responseBlock:responseBlock
+                 failureBlock:failureBlock];
+}
+
++ (void)startRequestWithURN:(NSString *)URN
+                       data:(NSDictionary *)data
+                      paged:(BOOL)paged
+                     domain:(id)domain
+                    batched:(BOOL)batched
+              dispatchGroup:(dispatch_group_t)dispatchGroup
+                   priority:(MMRecordRequestPriority)priority
+             responseSchema:(MMServerResponseSchema *)responseSchema
+              responseBlock:(void (^)(id responseObject))responseBlock
+               failureBlock:(void (^)(NSError *error))failureBlock {
     if (paged) {
         
     }
     
-    NSMutableURLRequest *baseRequest = [client requestWithMethod:@"GET" path:newURN parameters:newData];
+    NSMutableURLRequest *baseRequest = [self mutableRequestWithURN:URN data:data responseSchema:responseSchema];
+    
+    __block id operation = nil;
+    __weak id weakDomain = domain;
     
-    id operation = [AFJSONRequestOperation JSONRequestOperationWithRequest:baseRequest success:^(NSURLRequest *request, NSHTTPURLResponse *response, id JSON) {
+    operation = [self requestOperationWithRequest:baseRequest schema:responseSchema success:^(NSHTTPURLResponse *response, id responseObject) {
+        [self unregisterRequest:operation forDomain:weakDomain];
+        operation = nil;
+        
         if (responseBlock) {
-            responseBlock(JSON);
+            responseBlock(responseObject);
         }
-    } failure:^(NSURLRequest *request, NSHTTPURLResponse *response, NSError *error, id JSON) {
+    } failure:^(NSHTTPURLResponse *response, NSError *error) {
+        [self unregisterRequest:operation forDomain:weakDomain];
+        operation = nil;
+        
         if (failureBlock) {
             failureBlock(error);
         }
     }];
     
-    if (domain) {
-        Class domainClass = [domain class];
+    [self enqueueRequestOperation:operation domain:domain priority:priority];
+}
+
++ (void)startConditionalRequestWithURN:(NSString *)URN
+                                  data:(NSDictionary *)data
+                                domain:(id)domain
+                               batched:(BOOL)batched
+                         dispatchGroup:(dispatch_group_t)dispatchGroup
+                              priority:(MMRecordRequestPriority)priority
+                            validators:(NSDictionary *)validators
+                         responseBlock:(void (^)(id responseObject, NSDictionary *validators))responseBlock
+                      notModifiedBlock:(void (^)(void))notModifiedBlock
+                          failureBlock:(void (^)(NSError *error))failureBlock {
+    [self startConditionalRequestWithURN:URN
+                                    data:data
+                                  domain:domain
+                                 batched:batched
+                           dispatchGroup:dispatchGroup
+                                priority:priority
+                          responseSchema:nil
+                              validators:validators
+                           responseBlock:responseBlock
+                        notModifiedBlock:notModifiedBlock
+                            failureBlock:failureBlock];
+}
+
++ (void)startConditionalRequestWithURN:(NSString *)URN
+                                  data:(NSDictionary *)data
+                                domain:(id)domain
+                               batched:(BOOL)batched
+                         dispatchGroup:(dispatch_group_t)dispatchGroup
+                              priority:(MMRecordRequestPriority)priority
+                        responseSchema:(MMServerResponseSchema *)responseSchema
+                            validators:(NSDictionary *)validators
+                         responseBlock:(void (^)(id responseObject, NSDictionary *validators))responseBlock
+                      notModifiedBlock:(void (^)(void))notModifiedBlock
+                          failureBlock:(void (^)(NSError *error))failureBlock {
+    NSMutableURLRequest *baseRequest = [self mutableRequestWithURN:URN data:data responseSchema:responseSchema];
+    [self addValidators:validators toRequest:baseRequest];
+    
+    __block id operation = nil;
+    __weak id weakDomain = domain;
+    
+    operation = [self requestOperationWithRequest:baseRequest schema:responseSchema success:^(NSHTTPURLResponse *response, id responseObject) {
+        [self unregisterRequest:operation forDomain:weakDomain];
+        operation = nil;
+        
+        if (responseBlock) {
+            responseBlock(responseObject, [self validatorsFromResponse:response]);
+        }
+    } failure:^(NSHTTPURLResponse *response, NSError *error) {
+        [self unregisterRequest:operation forDomain:weakDomain];
+        operation = nil;
+        
+        // AFNetworking treats any status code outside of 200-299 as a failure.
+        if ([response statusCode] == 304 && validators != nil) {
+            if (notModifiedBlock) {
+                notModifiedBlock();
+            }
+        } else if (failureBlock) {
+            failureBlock(error);
+        }
+    }];
+    
+    [self enqueueRequestOperation:operation domain:domain priority:priority];
+}
+
+// Response bodies are decoded on a background queue by the decoder registered for their content type,
+// and the success and failure blocks are then called on the main queue.  Decoders that support a
+// schema skip the values in the body that the schema does not include.
++ (AFHTTPRequestOperation *)requestOperationWithRequest:(NSURLRequest *)request
+                                                 schema:(MMServerResponseSchema *)schema
+                                                success:(void (^)(NSHTTPURLResponse *response, id responseObject))success
+                                                failure:(void (^)(NSHTTPURLResponse *response, NSError *error))failure {
+    AFHTTPRequestOperation *operation = [[AFHTTPRequestOperation alloc] initWithRequest:request];
+    operation.successCallbackQueue = [self decodingQueue];
+    
+    [operation setCompletionBlockWithSuccess:^(AFHTTPRequestOperation *requestOperation, id responseData) {
+        NSHTTPURLResponse *response = requestOperation.response;
+        NSError *error = nil;
         
-        [self setRequestOperationDomain:NSStringFromClass(domainClass) onOperation:operation];
-    }
+        id responseObject = [self responseObjectWithData:requestOperation.responseData
+                                             contentType:[response MIMEType]
+                                                  schema:schema
+                                                   error:&error];
+        
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (error != nil) {
+                failure(response, error);
+            } else {
+                success(response, responseObject);
+            }
+        });
+    } failure:^(AFHTTPRequestOperation *requestOperation, NSError *error) {
+        failure(requestOperation.response, error);
+    }];
+    
+    return operation;
+}
+
++ (dispatch_queue_t)decodingQueue {
+    static dispatch_queue_t _decoding_queue = nil;
+    static dispatch_once_t oncePredicate;
+    dispatch_once(&oncePredicate, ^{
+        _decoding_queue = dispatch_queue_create("com.mutualmobile.mmrecord.afserver.decoding", DISPATCH_QUEUE_CONCURRENT);
+    });
+    
+    return _decoding_queue;
+}
+
++ (void)enqueueRequestOperation:(NSOperation *)operation
+                        domain:(id)domain
+                      priority:(MMRecordRequestPriority)priority {
+    id client = MMAFHTTPServer_registeredAFHTTPClient;
+    
+    [self registerRequest:operation forDomain:domain];
+    
+    [operation setQueuePriority:[self queuePriorityForRequestPriority:priority]];
     
     [client enqueueHTTPRequestOperation:operation];
 }
 
-+ (id)requestOperationDomainForOperation:(id)operation {
-    return objc_getAssociatedObject(operation, @"MMRecord_recordClassName");
++ (NSOperationQueuePriority)queuePriorityForRequestPriority:(MMRecordRequestPriority)priority {
+    switch (priority) {
+        case MMRecordRequestPriorityUserInitiated:
+            return NSOperationQueuePriorityHigh;
+        case MMRecordRequestPriorityBackground:
+            return NSOperationQueuePriorityLow;
+        default:
+            return NSOperationQueuePriorityNormal;
+    }
+}
+
++ (NSURLRequest *)requestWithURN:(NSString *)URN data:(NSDictionary *)data {
+    return [self mutableRequestWithURN:URN data:data responseSchema:nil];
+}
+
++ (NSURLRequest *)requestWithURN:(NSString *)URN
+                            data:(NSDictionary *)data
+                  responseSchema:(MMServerResponseSchema *)responseSchema {
+    return [self mutableRequestWithURN:URN data:data responseSchema:responseSchema];
 }
 
-+ (void)setRequestOperationDomain:(id)domain onOperation:(id)operation {
-    objc_setAssociatedObject(operation,  @"MMRecord_recordClassName", domain, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
++ (NSMutableURLRequest *)mutableRequestWithURN:(NSString *)URN
+                                          data:(NSDictionary *)data
+                                responseSchema:(MMServerResponseSchema *)responseSchema {
+    NSString* newURN = [URN stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding];
+    id client = MMAFHTTPServer_registeredAFHTTPClient;
+    NSDictionary *parameters = [self parametersWithData:data responseSchema:responseSchema];
+    
+    NSMutableURLRequest *request = [client requestWithMethod:@"GET" path:newURN parameters:parameters];
+    
+    // An Accept header set on the client takes precedence over the registered decoders.
+    if ([request valueForHTTPHeaderField:@"Accept"] == nil) {
+        [request setValue:[self acceptHeaderValue] forHTTPHeaderField:@"Accept"];
+    }
+    
+    return request;
 }
 
 @end
\ No newline at end of file
@@ -0,0 +1,53 @@
+// MMCBORDecoder.h
+//
+// Copyright (c) 2013 Mutual Mobile (http://www.mutualmobile.com/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "MMServer.h"
+
+/**
+ The error domain for errors returned by MMCBORDecoder.
+ */
+extern NSString * const MMCBORDecoderErrorDomain;
+
+/**
+ The error codes returned by MMCBORDecoder.
+ */
+typedef NS_ENUM(NSInteger, MMCBORDecoderErrorCode) {
+    MMCBORDecoderErrorCodeTruncatedData = 1,
+    MMCBORDecoderErrorCodeInvalidData = 2,
+    MMCBORDecoderErrorCodeNestingTooDeep = 3,
+};
+
+/**
+ `MMCBORDecoder` decodes CBOR (RFC 7049) response bodies into the same structures that 
+ NSJSONSerialization produces, so that records can be imported from them without any other changes.
+ Register it with MMServer to use it for responses with the application/cbor content type.
+ 
+ ## Type Mapping
+ 
+ Maps are decoded to NSDictionary, arrays to NSArray, text strings to NSString, integers, floats and
+ booleans to NSNumber, and null and undefined to NSNull.  Byte strings are decoded to NSData.  Date 
+ tags 0 and 1 are decoded to NSDate, and other tags are decoded to the value they enclose.  
+ Indefinite length strings, arrays and maps are supported.
+ */
+@interface MMCBORDecoder : NSObject <MMServerResponseDecoder>
+
+@end
@@ -0,0 +1,529 @@
+// MMCBORDecoder.m
+//
+// Copyright (c) 2013 Mutual Mobile (http://www.mutualmobile.com/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "MMCBORDecoder.h"
+
+#include <math.h>
+#include <time.h>
+
+NSString * const MMCBORDecoderErrorDomain = @"com.mutualmobile.mmrecord.cbor";
+
+// Arrays and maps nested deeper than this are rejected rather than risking a stack overflow.
+static const NSUInteger MMCBORMaximumDepth = 512;
+
+static const uint8_t MMCBORBreakByte = 0xff;
+static const uint8_t MMCBORIndefiniteLength = 31;
+
+typedef NS_ENUM(uint8_t, MMCBORMajorType) {
+    MMCBORMajorTypeUnsignedInteger = 0,
+    MMCBORMajorTypeNegativeInteger = 1,
+    MMCBORMajorTypeByteString = 2,
+    MMCBORMajorTypeTextString = 3,
+    MMCBORMajorTypeArray = 4,
+    MMCBORMajorTypeMap = 5,
+    MMCBORMajorTypeTag = 6,
+    MMCBORMajorTypeSimple = 7,
+};
+
+typedef struct {
+    const uint8_t *bytes;
+    NSUInteger length;
+    NSUInteger offset;
+} MMCBORReader;
+
+@implementation MMCBORDecoder
+
++ (NSArray *)contentTypes {
+    return @[@"application/cbor"];
+}
+
++ (id)responseObjectWithData:(NSData *)data error:(NSError **)error {
+    MMCBORReader reader = { [data bytes], [data length], 0 };
+    
+    id object = [self objectWithReader:&reader depth:0 error:error];
+    
+    if (object != nil && reader.offset != reader.length) {
+        return [self failWithCode:MMCBORDecoderErrorCodeInvalidData
+                      description:@"Unexpected data after the CBOR object."
+                            error:error];
+    }
+    
+    return object;
+}
+
+
+#pragma mark - Decoding Objects
+
++ (id)objectWithReader:(MMCBORReader *)reader depth:(NSUInteger)depth error:(NSError **)error {
+    if (depth > MMCBORMaximumDepth) {
+        return [self failWithCode:MMCBORDecoderErrorCodeNestingTooDeep
+                      description:@"The CBOR data is nested too deeply."
+                            error:error];
+    }
+    
+    uint8_t initialByte = 0;
+    
+    if ([self readByte:&initialByte reader:reader] == NO) {
+        return [self truncatedDataWithError:error];
+    }
+    
+    MMCBORMajorType majorType = initialByte >> 5;
+    uint8_t additionalInfo = initialByte & 0x1f;
+    
+    if (majorType == MMCBORMajorTypeSimple) {
+        return [self simpleValueWithAdditionalInfo:additionalInfo reader:reader error:error];
+    }
+    
+    BOOL indefinite = (additionalInfo == MMCBORIndefiniteLength);
+    uint64_t argument = 0;
+    
+    if (indefinite) {
+        if (majorType != MMCBORMajorTypeByteString &&
+            majorType != MMCBORMajorTypeTextString &&
+            majorType != MMCBORMajorTypeArray &&
+            majorType != MMCBORMajorTypeMap) {
+            return [self invalidDataWithError:error];
+        }
+    } else if ([self readArgument:&argument additionalInfo:additionalInfo reader:reader error:error] == NO) {
+        return nil;
+    }
+    
+    switch (majorType) {
+        case MMCBORMajorTypeUnsignedInteger:
+            if (argument > LLONG_MAX) {
+                return [NSNumber numberWithUnsignedLongLong:argument];
+            }
+            
+            return [NSNumber numberWithLongLong:(long long)argument];
+        case MMCBORMajorTypeNegativeInteger:
+            // The encoded value is -1 - argument, which only fits in a signed 64 bit integer up to this bound.
+            if (argument > LLONG_MAX) {
+                return [self failWithCode:MMCBORDecoderErrorCodeInvalidData
+                              description:@"A CBOR negative integer is out of range."
+                                    error:error];
+            }
+            
+            return [NSNumber numberWithLongLong:-1 - (long long)argument];
+        case MMCBORMajorTypeByteString:
+        case MMCBORMajorTypeTextString: {
+            NSData *data = nil;
+            
+            if (indefinite) {
+                data = [self indefiniteStringDataWithMajorType:majorType reader:reader error:error];
+            } else {
+                data = [self stringDataWithLength:argument reader:reader error:error];
+            }
+            
+            if (data == nil) {
+                return nil;
+            }
+            
+            if (majorType == MMCBORMajorTypeByteString) {
+                return data;
+            }
+            
+            return [self stringWithData:data error:error];
+        }
+        case MMCBORMajorTypeArray:
+            return [self arrayWithCount:argument indefinite:indefinite reader:reader depth:depth error:error];
+        case MMCBORMajorTypeMap:
+            return [self mapWithCount:argument indefinite:indefinite reader:reader depth:depth error:error];
+        case MMCBORMajorTypeTag:
+            return [self taggedValueWithTag:argument reader:reader depth:depth error:error];
+        default:
+            return [self invalidDataWithError:error];
+    }
+}
+
++ (id)simpleValueWithAdditionalInfo:(uint8_t)additionalInfo reader:(MMCBORReader *)reader error:(NSError **)error {
+    switch (additionalInfo) {
+        case 20:
+            return [NSNumber numberWithBool:NO];
+        case 21:
+            return [NSNumber numberWithBool:YES];
+        case 22:
+        case 23:
+            return [NSNull null];
+        case 25: {
+            uint64_t bits = 0;
+            
+            if ([self readUnsignedInteger:&bits size:2 reader:reader] == NO) {
+                return [self truncatedDataWithError:error];
+            }
+            
+            return [NSNumber numberWithDouble:[self doubleWithHalfPrecisionBits:(uint16_t)bits]];
+        }
+        case 26: {
+            uint64_t bits = 0;
+            
+            if ([self readUnsignedInteger:&bits size:4 reader:reader] == NO) {
+                return [self truncatedDataWithError:error];
+            }
+            
+            uint32_t floatBits = (uint32_t)bits;
+            float value = 0;
+            memcpy(&value, &floatBits, sizeof(value));
+            
+            return [NSNumber numberWithFloat:value];
+        }
+        case 27: {
+            uint64_t bits = 0;
+            
+            if ([self readUnsignedInteger:&bits size:8 reader:reader] == NO) {
+                return [self truncatedDataWithError:error];
+            }
+            
+            double value = 0;
+            memcpy(&value, &bits, sizeof(value));
+            
+            return [NSNumber numberWithDouble:value];
+        }
+        default:
+            // Unassigned simple values, and a break outside of an indefinite length item.
+            return [self invalidDataWithError:error];
+    }
+}
+
++ (double)doubleWithHalfPrecisionBits:(uint16_t)bits {
+    int exponent = (bits >> 10) & 0x1f;
+    int mantissa = bits & 0x3ff;
+    double value = 0;
+    
+    if (exponent == 0) {
+        value = ldexp(mantissa, -24);
+    } else if (exponent != 31) {
+        value = ldexp(mantissa + 1024, exponent - 25);
+    } else {
+        value = (mantissa == 0) ? INFINITY : NAN;
+    }
+    
+    return (bits & 0x8000) ? -value : value;
+}
+
++ (id)arrayWithCount:(uint64_t)count
+          indefinite:(BOOL)indefinite
+              reader:(MMCBORReader *)reader
+               depth:(NSUInteger)depth
+               error:(NSError **)error {
+    // Every element takes at least one byte, which bounds the capacity for malformed counts.
+    if (indefinite == NO && count > reader->length - reader->offset) {
+        return [self truncatedDataWithError:error];
+    }
+    
+    NSMutableArray *array = [NSMutableArray arrayWithCapacity:(NSUInteger)(indefinite ? 0 : count)];
+    
+    for (uint64_t i = 0; indefinite || i < count; i++) {
+        if (indefinite && [self readBreakWithReader:reader]) {
+            break;
+        }
+        
+        id object = [self objectWithReader:reader depth:depth + 1 error:error];
+        
+        if (object == nil) {
+            return nil;
+        }
+        
+        [array addObject:object];
+    }
+    
+    return array;
+}
+
++ (id)mapWithCount:(uint64_t)count
+        indefinite:(BOOL)indefinite
+            reader:(MMCBORReader *)reader
+             depth:(NSUInteger)depth
+             error:(NSError **)error {
+    if (indefinite == NO && count > (reader->length - reader->offset) / 2) {
+        return [self truncatedDataWithError:error];
+    }
+    
+    NSMutableDictionary *dictionary = [NSMutableDictionary dictionaryWithCapacity:(NSUInteger)(indefinite ? 0 : count)];
+    
+    for (uint64_t i = 0; indefinite || i < count; i++) {
+        if (indefinite && [self readBreakWithReader:reader]) {
+            break;
+        }
+        
+        id key = [self objectWithReader:reader depth:depth + 1 error:error];
+        
+        if (key == nil) {
+            return nil;
+        }
+        
+        id value = [self objectWithReader:reader depth:depth + 1 error:error];
+        
+        if (value == nil) {
+            return nil;
+        }
+        
+        [dictionary setObject:value forKey:key];
+    }
+    
+    return dictionary;
+}
+
++ (id)taggedValueWithTag:(uint64_t)tag reader:(MMCBORReader *)reader depth:(NSUInteger)depth error:(NSError **)error {
+    id value = [self objectWithReader:reader depth:depth + 1 error:error];
+    
+    if (value == nil) {
+        return nil;
+    }
+    
+    if (tag == 0) {
+        NSDate *date = [value isKindOfClass:[NSString class]] ? [self dateWithRFC3339String:value] : nil;
+        
+        if (date == nil) {
+            return [self failWithCode:MMCBORDecoderErrorCodeInvalidData
+                          description:@"A CBOR date string is not a valid RFC 3339 date."
+                                error:error];
+        }
+        
+        return date;
+    }
+    
+    if (tag == 1) {
+        if ([value isKindOfClass:[NSNumber class]] == NO) {
+            return [self failWithCode:MMCBORDecoderErrorCodeInvalidData
+                          description:@"A CBOR epoch date is not a number."
+                                error:error];
+        }
+        
+        return [NSDate dateWithTimeIntervalSince1970:[value doubleValue]];
+    }
+    
+    return value;
+}
+
+// Parses the subset of RFC 3339 used by CBOR date strings without an NSDateFormatter, which is not
+// safe to share across the concurrent queues that responses are decoded on.
++ (NSDate *)dateWithRFC3339String:(NSString *)string {
+    const char *characters = [string UTF8String];
+    struct tm time;
+    memset(&time, 0, sizeof(time));
+    
+    double seconds = 0;
+    int consumed = 0;
+    
+    if (sscanf(characters, "%4d-%2d-%2d%*1[Tt ]%2d:%2d:%lf%n",
+               &time.tm_year, &time.tm_mon, &time.tm_mday,
+               &time.tm_hour, &time.tm_min, &seconds, &consumed) != 6) {
+        return nil;
+    }
+    
+    const char *zone = characters + consumed;
+    long offset = 0;
+    
+    if (*zone == 'Z' || *zone == 'z') {
+        zone++;
+    } else if (*zone == '+' || *zone == '-') {
+        int hours = 0;
+        int minutes = 0;
+        int zoneConsumed = 0;
+        
+        if (sscanf(zone + 1, "%2d:%2d%n", &hours, &minutes, &zoneConsumed) != 2) {
+            return nil;
+        }
+        
+        offset = (hours * 3600 + minutes * 60) * (*zone == '-' ? -1 : 1);
+        zone += 1 + zoneConsumed;
+    } else {
+        return nil;
+    }
+    
+    if (*zone != '\0') {
+        return nil;
+    }
+    
+    time.tm_year -= 1900;
+    time.tm_mon -= 1;
+    
+    time_t wholeSeconds = timegm(&time);
+    
+    return [NSDate dateWithTimeIntervalSince1970:(double)wholeSeconds + seconds - offset];
+}
+
+
+#pragma mark - Decoding Strings
+
++ (NSData *)stringDataWithLength:(uint64_t)length reader:(MMCBORReader *)reader error:(NSError **)error {
+    const uint8_t *bytes = [self readBytesWithLength:length reader:reader];
+    
+    if (bytes == NULL) {
+        return [self truncatedDataWithError:error];
+    }
+    
+    return [NSData dataWithBytes:bytes length:(NSUInteger)length];
+}
+
+// Indefinite length strings are a series of definite length chunks of the same major type,
+// terminated by a break.
++ (NSData *)indefiniteStringDataWithMajorType:(MMCBORMajorType)majorType
+                                       reader:(MMCBORReader *)reader
+                                        error:(NSError **)error {
+    NSMutableData *data = [NSMutableData data];
+    
+    while ([self readBreakWithReader:reader] == NO) {
+        uint8_t initialByte = 0;
+        
+        if ([self readByte:&initialByte reader:reader] == NO) {
+            return [self truncatedDataWithError:error];
+        }
+        
+        uint8_t additionalInfo = initialByte & 0x1f;
+        
+        if ((initialByte >> 5) != majorType || additionalInfo == MMCBORIndefiniteLength) {
+            return [self failWithCode:MMCBORDecoderErrorCodeInvalidData
+                          description:@"A CBOR indefinite length string contains an invalid chunk."
+                                error:error];
+        }
+        
+        uint64_t length = 0;
+        
+        if ([self readArgument:&length additionalInfo:additionalInfo reader:reader error:error] == NO) {
+            return nil;
+        }
+        
+        const uint8_t *bytes = [self readBytesWithLength:length reader:reader];
+        
+        if (bytes == NULL) {
+            return [self truncatedDataWithError:error];
+        }
+        
+        [data appendBytes:bytes length:(NSUInteger)length];
+    }
+    
+    return data;
+}
+
++ (id)stringWithData:(NSData *)data error:(NSError **)error {
+    NSString *string = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+    
+    if (string == nil) {
+        return [self failWithCode:MMCBORDecoderErrorCodeInvalidData
+                      description:@"A CBOR text string is not valid UTF-8."
+                            error:error];
+    }
+    
+    return string;
+}
+
+
+#pragma mark - Reading Bytes
+
++ (BOOL)readArgument:(uint64_t *)argument
+      additionalInfo:(uint8_t)additionalInfo
+              reader:(MMCBORReader *)reader
+               error:(NSError **)error {
+    if (additionalInfo < 24) {
+        *argument = additionalInfo;
+        return YES;
+    }
+    
+    if (additionalInfo > 27) {
+        [self invalidDataWithError:error];
+        return NO;
+    }
+    
+    if ([self readUnsignedInteger:argument size:(1 << (additionalInfo - 24)) reader:reader] == NO) {
+        [self truncatedDataWithError:error];
+        return NO;
+    }
+    
+    return YES;
+}
+
+// Consumes a break byte if one is next, ending an indefinite length item.
++ (BOOL)readBreakWithReader:(MMCBORReader *)reader {
+    if (reader->offset < reader->length && reader->bytes[reader->offset] == MMCBORBreakByte) {
+        reader->offset++;
+        return YES;
+    }
+    
+    return NO;
+}
+
++ (BOOL)readByte:(uint8_t *)byte reader:(MMCBORReader *)reader {
+    if (reader->offset >= reader->length) {
+        return NO;
+    }
+    
+    *byte = reader->bytes[reader->offset++];
+    
+    return YES;
+}
+
+// Reads a big endian unsigned integer of the given size in bytes.
++ (BOOL)readUnsignedInteger:(uint64_t *)value size:(NSUInteger)size reader:(MMCBORReader *)reader {
+    if (size > reader->length - reader->offset) {
+        return NO;
+    }
+    
+    uint64_t result = 0;
+    
+    for (NSUInteger i = 0; i < size; i++) {
+        result = (result << 8) | reader->bytes[reader->offset + i];
+    }
+    
+    reader->offset += size;
+    *value = result;
+    
+    return YES;
+}
+
++ (const uint8_t *)readBytesWithLength:(uint64_t)length reader:(MMCBORReader *)reader {
+    if (length > reader->length - reader->offset) {
+        return NULL;
+    }
+    
+    const uint8_t *bytes = reader->bytes + reader->offset;
+    reader->offset += (NSUInteger)length;
+    
+    return bytes;
+}
+
+
+#pragma mark - Errors
+
++ (id)truncatedDataWithError:(NSError **)error {
+    return [self failWithCode:MMCBORDecoderErrorCodeTruncatedData
+                  description:@"The CBOR data ended unexpectedly."
+                        error:error];
+}
+
++ (id)invalidDataWithError:(NSError **)error {
+    return [self failWithCode:MMCBORDecoderErrorCodeInvalidData
+                  description:@"The CBOR data is not valid."
+                        error:error];
+}
+
++ (id)failWithCode:(MMCBORDecoderErrorCode)code description:(NSString *)description error:(NSError **)error {
+    if (error != NULL) {
+        *error = [NSError errorWithDomain:MMCBORDecoderErrorDomain
+                                     code:code
+                                 userInfo:@{NSLocalizedDescriptionKey : description}];
+    }
+    
+    return nil;
+}
+
+@end
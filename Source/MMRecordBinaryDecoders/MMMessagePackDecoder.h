@@ -0,0 +1,54 @@
+// MMMessagePackDecoder.h
+//
+// Copyright (c) 2013 Mutual Mobile (http://www.mutualmobile.com/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "MMServer.h"
+
+/**
+ The error domain for errors returned by MMMessagePackDecoder.
+ */
+extern NSString * const MMMessagePackDecoderErrorDomain;
+
+/**
+ The error codes returned by MMMessagePackDecoder.
+ */
+typedef NS_ENUM(NSInteger, MMMessagePackDecoderErrorCode) {
+    MMMessagePackDecoderErrorCodeTruncatedData = 1,
+    MMMessagePackDecoderErrorCodeInvalidData = 2,
+    MMMessagePackDecoderErrorCodeNestingTooDeep = 3,
+};
+
+/**
+ `MMMessagePackDecoder` decodes MessagePack response bodies into the same structures that 
+ NSJSONSerialization produces, so that records can be imported from them without any other changes.
+ Register it with MMServer to use it for responses with the application/msgpack and 
+ application/x-msgpack content types.
+ 
+ ## Type Mapping
+ 
+ Maps are decoded to NSDictionary, arrays to NSArray, strings to NSString, integers, floats and 
+ booleans to NSNumber, and nil to NSNull.  Binary values are decoded to NSData.  The timestamp 
+ extension type is decoded to NSDate, and other extension types are decoded to NSData containing 
+ their payload.
+ */
+@interface MMMessagePackDecoder : NSObject <MMServerResponseDecoder>
+
+@end
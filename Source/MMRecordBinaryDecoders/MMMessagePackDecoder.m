@@ -0,0 +1,417 @@
+// MMMessagePackDecoder.m
+//
+// Copyright (c) 2013 Mutual Mobile (http://www.mutualmobile.com/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "MMMessagePackDecoder.h"
+
+NSString * const MMMessagePackDecoderErrorDomain = @"com.mutualmobile.mmrecord.messagepack";
+
+// Arrays and maps nested deeper than this are rejected rather than risking a stack overflow.
+static const NSUInteger MMMessagePackMaximumDepth = 512;
+
+static const int8_t MMMessagePackTimestampExtensionType = -1;
+
+typedef struct {
+    const uint8_t *bytes;
+    NSUInteger length;
+    NSUInteger offset;
+} MMMessagePackReader;
+
+@implementation MMMessagePackDecoder
+
++ (NSArray *)contentTypes {
+    return @[@"application/msgpack", @"application/x-msgpack"];
+}
+
++ (id)responseObjectWithData:(NSData *)data error:(NSError **)error {
+    MMMessagePackReader reader = { [data bytes], [data length], 0 };
+    
+    id object = [self objectWithReader:&reader depth:0 error:error];
+    
+    if (object != nil && reader.offset != reader.length) {
+        return [self failWithCode:MMMessagePackDecoderErrorCodeInvalidData
+                      description:@"Unexpected data after the MessagePack object."
+                            error:error];
+    }
+    
+    return object;
+}
+
+
+#pragma mark - Decoding Objects
+
++ (id)objectWithReader:(MMMessagePackReader *)reader depth:(NSUInteger)depth error:(NSError **)error {
+    if (depth > MMMessagePackMaximumDepth) {
+        return [self failWithCode:MMMessagePackDecoderErrorCodeNestingTooDeep
+                      description:@"The MessagePack data is nested too deeply."
+                            error:error];
+    }
+    
+    uint64_t type = 0;
+    
+    if ([self readUnsignedInteger:&type size:1 reader:reader] == NO) {
+        return [self truncatedDataWithError:error];
+    }
+    
+    if (type <= 0x7f) {
+        return [NSNumber numberWithUnsignedChar:(uint8_t)type];
+    }
+    
+    if (type >= 0xe0) {
+        return [NSNumber numberWithChar:(int8_t)type];
+    }
+    
+    if ((type & 0xf0) == 0x80) {
+        return [self mapWithCount:(type & 0x0f) reader:reader depth:depth error:error];
+    }
+    
+    if ((type & 0xf0) == 0x90) {
+        return [self arrayWithCount:(type & 0x0f) reader:reader depth:depth error:error];
+    }
+    
+    if ((type & 0xe0) == 0xa0) {
+        return [self stringWithLength:(type & 0x1f) reader:reader error:error];
+    }
+    
+    switch (type) {
+        case 0xc0:
+            return [NSNull null];
+        case 0xc2:
+            return [NSNumber numberWithBool:NO];
+        case 0xc3:
+            return [NSNumber numberWithBool:YES];
+        case 0xc4:
+        case 0xc5:
+        case 0xc6:
+            return [self dataWithLengthSize:(1 << (type - 0xc4)) reader:reader error:error];
+        case 0xc7:
+        case 0xc8:
+        case 0xc9:
+            return [self extensionWithLengthSize:(1 << (type - 0xc7)) reader:reader error:error];
+        case 0xca:
+            return [self floatWithReader:reader error:error];
+        case 0xcb:
+            return [self doubleWithReader:reader error:error];
+        case 0xcc:
+        case 0xcd:
+        case 0xce:
+        case 0xcf:
+            return [self unsignedIntegerWithSize:(1 << (type - 0xcc)) reader:reader error:error];
+        case 0xd0:
+        case 0xd1:
+        case 0xd2:
+        case 0xd3:
+            return [self signedIntegerWithSize:(1 << (type - 0xd0)) reader:reader error:error];
+        case 0xd4:
+        case 0xd5:
+        case 0xd6:
+        case 0xd7:
+        case 0xd8:
+            return [self extensionWithLength:(1 << (type - 0xd4)) reader:reader error:error];
+        case 0xd9:
+        case 0xda:
+        case 0xdb: {
+            uint64_t length = 0;
+            
+            if ([self readUnsignedInteger:&length size:(1 << (type - 0xd9)) reader:reader] == NO) {
+                return [self truncatedDataWithError:error];
+            }
+            
+            return [self stringWithLength:length reader:reader error:error];
+        }
+        case 0xdc:
+        case 0xdd: {
+            uint64_t count = 0;
+            
+            if ([self readUnsignedInteger:&count size:(type == 0xdc ? 2 : 4) reader:reader] == NO) {
+                return [self truncatedDataWithError:error];
+            }
+            
+            return [self arrayWithCount:count reader:reader depth:depth error:error];
+        }
+        case 0xde:
+        case 0xdf: {
+            uint64_t count = 0;
+            
+            if ([self readUnsignedInteger:&count size:(type == 0xde ? 2 : 4) reader:reader] == NO) {
+                return [self truncatedDataWithError:error];
+            }
+            
+            return [self mapWithCount:count reader:reader depth:depth error:error];
+        }
+        default:
+            return [self failWithCode:MMMessagePackDecoderErrorCodeInvalidData
+                          description:[NSString stringWithFormat:@"Invalid MessagePack type 0x%02llx.", type]
+                                error:error];
+    }
+}
+
++ (id)arrayWithCount:(uint64_t)count reader:(MMMessagePackReader *)reader depth:(NSUInteger)depth error:(NSError **)error {
+    // Every element takes at least one byte, which bounds the capacity for malformed counts.
+    if (count > reader->length - reader->offset) {
+        return [self truncatedDataWithError:error];
+    }
+    
+    NSMutableArray *array = [NSMutableArray arrayWithCapacity:(NSUInteger)count];
+    
+    for (uint64_t i = 0; i < count; i++) {
+        id object = [self objectWithReader:reader depth:depth + 1 error:error];
+        
+        if (object == nil) {
+            return nil;
+        }
+        
+        [array addObject:object];
+    }
+    
+    return array;
+}
+
++ (id)mapWithCount:(uint64_t)count reader:(MMMessagePackReader *)reader depth:(NSUInteger)depth error:(NSError **)error {
+    if (count > (reader->length - reader->offset) / 2) {
+        return [self truncatedDataWithError:error];
+    }
+    
+    NSMutableDictionary *dictionary = [NSMutableDictionary dictionaryWithCapacity:(NSUInteger)count];
+    
+    for (uint64_t i = 0; i < count; i++) {
+        id key = [self objectWithReader:reader depth:depth + 1 error:error];
+        
+        if (key == nil) {
+            return nil;
+        }
+        
+        id value = [self objectWithReader:reader depth:depth + 1 error:error];
+        
+        if (value == nil) {
+            return nil;
+        }
+        
+        [dictionary setObject:value forKey:key];
+    }
+    
+    return dictionary;
+}
+
++ (id)stringWithLength:(uint64_t)length reader:(MMMessagePackReader *)reader error:(NSError **)error {
+    const uint8_t *bytes = [self readBytesWithLength:length reader:reader];
+    
+    if (bytes == NULL) {
+        return [self truncatedDataWithError:error];
+    }
+    
+    NSString *string = [[NSString alloc] initWithBytes:bytes length:(NSUInteger)length encoding:NSUTF8StringEncoding];
+    
+    if (string == nil) {
+        return [self failWithCode:MMMessagePackDecoderErrorCodeInvalidData
+                      description:@"A MessagePack string is not valid UTF-8."
+                            error:error];
+    }
+    
+    return string;
+}
+
++ (id)dataWithLengthSize:(NSUInteger)size reader:(MMMessagePackReader *)reader error:(NSError **)error {
+    uint64_t length = 0;
+    
+    if ([self readUnsignedInteger:&length size:size reader:reader] == NO) {
+        return [self truncatedDataWithError:error];
+    }
+    
+    const uint8_t *bytes = [self readBytesWithLength:length reader:reader];
+    
+    if (bytes == NULL) {
+        return [self truncatedDataWithError:error];
+    }
+    
+    return [NSData dataWithBytes:bytes length:(NSUInteger)length];
+}
+
++ (id)extensionWithLengthSize:(NSUInteger)size reader:(MMMessagePackReader *)reader error:(NSError **)error {
+    uint64_t length = 0;
+    
+    if ([self readUnsignedInteger:&length size:size reader:reader] == NO) {
+        return [self truncatedDataWithError:error];
+    }
+    
+    return [self extensionWithLength:length reader:reader error:error];
+}
+
++ (id)extensionWithLength:(uint64_t)length reader:(MMMessagePackReader *)reader error:(NSError **)error {
+    uint64_t extensionType = 0;
+    
+    if ([self readUnsignedInteger:&extensionType size:1 reader:reader] == NO) {
+        return [self truncatedDataWithError:error];
+    }
+    
+    const uint8_t *bytes = [self readBytesWithLength:length reader:reader];
+    
+    if (bytes == NULL) {
+        return [self truncatedDataWithError:error];
+    }
+    
+    if ((int8_t)extensionType == MMMessagePackTimestampExtensionType) {
+        NSDate *date = [self timestampWithBytes:bytes length:(NSUInteger)length];
+        
+        if (date == nil) {
+            return [self failWithCode:MMMessagePackDecoderErrorCodeInvalidData
+                          description:@"A MessagePack timestamp has an invalid length."
+                                error:error];
+        }
+        
+        return date;
+    }
+    
+    return [NSData dataWithBytes:bytes length:(NSUInteger)length];
+}
+
++ (NSDate *)timestampWithBytes:(const uint8_t *)bytes length:(NSUInteger)length {
+    MMMessagePackReader reader = { bytes, length, 0 };
+    uint64_t seconds = 0;
+    uint64_t nanoseconds = 0;
+    
+    if (length == 4) {
+        [self readUnsignedInteger:&seconds size:4 reader:&reader];
+    } else if (length == 8) {
+        uint64_t value = 0;
+        [self readUnsignedInteger:&value size:8 reader:&reader];
+        
+        nanoseconds = value >> 34;
+        seconds = value & 0x00000003ffffffffULL;
+    } else if (length == 12) {
+        [self readUnsignedInteger:&nanoseconds size:4 reader:&reader];
+        [self readUnsignedInteger:&seconds size:8 reader:&reader];
+        
+        return [NSDate dateWithTimeIntervalSince1970:(int64_t)seconds + nanoseconds / 1e9];
+    } else {
+        return nil;
+    }
+    
+    return [NSDate dateWithTimeIntervalSince1970:seconds + nanoseconds / 1e9];
+}
+
++ (id)unsignedIntegerWithSize:(NSUInteger)size reader:(MMMessagePackReader *)reader error:(NSError **)error {
+    uint64_t value = 0;
+    
+    if ([self readUnsignedInteger:&value size:size reader:reader] == NO) {
+        return [self truncatedDataWithError:error];
+    }
+    
+    if (value > LLONG_MAX) {
+        return [NSNumber numberWithUnsignedLongLong:value];
+    }
+    
+    return [NSNumber numberWithLongLong:(long long)value];
+}
+
++ (id)signedIntegerWithSize:(NSUInteger)size reader:(MMMessagePackReader *)reader error:(NSError **)error {
+    uint64_t value = 0;
+    
+    if ([self readUnsignedInteger:&value size:size reader:reader] == NO) {
+        return [self truncatedDataWithError:error];
+    }
+    
+    // Sign extend the value from its encoded size.
+    NSUInteger shift = 64 - (size * 8);
+    int64_t signedValue = (int64_t)(value << shift) >> shift;
+    
+    return [NSNumber numberWithLongLong:signedValue];
+}
+
++ (id)floatWithReader:(MMMessagePackReader *)reader error:(NSError **)error {
+    uint64_t bits = 0;
+    
+    if ([self readUnsignedInteger:&bits size:4 reader:reader] == NO) {
+        return [self truncatedDataWithError:error];
+    }
+    
+    uint32_t floatBits = (uint32_t)bits;
+    float value = 0;
+    memcpy(&value, &floatBits, sizeof(value));
+    
+    return [NSNumber numberWithFloat:value];
+}
+
++ (id)doubleWithReader:(MMMessagePackReader *)reader error:(NSError **)error {
+    uint64_t bits = 0;
+    
+    if ([self readUnsignedInteger:&bits size:8 reader:reader] == NO) {
+        return [self truncatedDataWithError:error];
+    }
+    
+    double value = 0;
+    memcpy(&value, &bits, sizeof(value));
+    
+    return [NSNumber numberWithDouble:value];
+}
+
+
+#pragma mark - Reading Bytes
+
+// Reads a big endian unsigned integer of the given size in bytes.
++ (BOOL)readUnsignedInteger:(uint64_t *)value size:(NSUInteger)size reader:(MMMessagePackReader *)reader {
+    if (size > reader->length - reader->offset) {
+        return NO;
+    }
+    
+    uint64_t result = 0;
+    
+    for (NSUInteger i = 0; i < size; i++) {
+        result = (result << 8) | reader->bytes[reader->offset + i];
+    }
+    
+    reader->offset += size;
+    *value = result;
+    
+    return YES;
+}
+
++ (const uint8_t *)readBytesWithLength:(uint64_t)length reader:(MMMessagePackReader *)reader {
+    if (length > reader->length - reader->offset) {
+        return NULL;
+    }
+    
+    const uint8_t *bytes = reader->bytes + reader->offset;
+    reader->offset += (NSUInteger)length;
+    
+    return bytes;
+}
+
+
+#pragma mark - Errors
+
++ (id)truncatedDataWithError:(NSError **)error {
+    return [self failWithCode:MMMessagePackDecoderErrorCodeTruncatedData
+                  description:@"The MessagePack data ended unexpectedly."
+                        error:error];
+}
+
++ (id)failWithCode:(MMMessagePackDecoderErrorCode)code description:(NSString *)description error:(NSError **)error {
+    if (error != NULL) {
+        *error = [NSError errorWithDomain:MMMessagePackDecoderErrorDomain
+                                     code:code
+                                 userInfo:@{NSLocalizedDescriptionKey : description}];
+    }
+    
+    return nil;
+}
+
+@end
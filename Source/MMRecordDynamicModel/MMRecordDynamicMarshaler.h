@@ -29,6 +29,8 @@
  as a relationship. This allows you to uptake changes (such as attribute additions/deletions) 
  in the incoming data model without having to reflect the changes in your Core Data model. The
  dictionary stored in the transformable attribute will fluctuate with the incoming data's model.
+ Set the attribute's value transformer to MMRecordDynamicStorageTransformer to store the dictionary
+ in a compact binary encoding instead of a keyed archive.
 */
 @interface MMRecordDynamicMarshaler : MMRecordMarshaler
 
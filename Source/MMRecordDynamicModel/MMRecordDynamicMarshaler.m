@@ -24,7 +24,6 @@
 
 #import "MMRecordDynamicRepresentation.h"
 #import "MMRecordProtoRecord.h"
-#import "MMRecordRepresentation.h"
 
 @interface MMRecordChildlessDataDictionaryTransformer : NSValueTransformer
 
@@ -56,12 +55,13 @@
     if (attributeDescription.attributeType == NSTransformableAttributeType) {
         MMRecordChildlessDataDictionaryTransformer *valueTransformer =
             [MMRecordChildlessDataDictionaryTransformer transformerWithProtoRecord:protoRecord];
-        NSMutableDictionary *data = [valueTransformer transformedValue:dictionary];
+        NSDictionary *data = [valueTransformer transformedValue:dictionary];
         
-        [self setValue:data
-              onRecord:protoRecord.record
-             attribute:attributeDescription
-         dateFormatter:protoRecord.representation.dateFormatter];
+        // The dictionary is assigned directly rather than through the attribute's value transformer,
+        // since Core Data runs that transformer itself when the record is saved.
+        if (data != nil) {
+            [protoRecord.record setValue:data forKey:attributeDescription.name];
+        }
     } else {
         [super populateProtoRecord:protoRecord
               attributeDescription:attributeDescription
@@ -101,17 +101,25 @@
         return nil;
     }
     
-    NSMutableDictionary *data = [value mutableCopy];
-    // Strip out all children in dictionary.
-    MMRecordRepresentation *recordRepresentation = self.sourceProtoRecord.representation;
-    NSArray *relationshipDescriptions = self.sourceProtoRecord.relationshipDescriptions;
-    for (NSRelationshipDescription *relationshipDescription in relationshipDescriptions) {
-        NSArray *keyPaths =
-        [recordRepresentation keyPathsForMappingRelationshipDescription:relationshipDescription];
-        for (NSString *keyPath in keyPaths) {
+    MMRecordDynamicRepresentation *representation =
+        (MMRecordDynamicRepresentation *)self.sourceProtoRecord.representation;
+    NSMutableDictionary *data = nil;
+    
+    // Strip out all children in dictionary, copying it only if it contains any.
+    for (NSString *keyPath in representation.relationshipKeyPaths) {
+        if ([value objectForKey:keyPath] != nil) {
+            if (data == nil) {
+                data = [value mutableCopy];
+            }
+            
             [data removeObjectForKey:keyPath];
         }
     }
+    
+    if (data == nil) {
+        return [value copy];
+    }
+    
     return data;
 }
 
@@ -38,4 +38,11 @@
 */
 @property(nonatomic, strong) NSAttributeDescription *dynamicStorageAttribute;
 
+/**
+ The key paths that the entity's relationships are mapped from. These are left out of the dictionary
+ held by the dynamic storage attribute. They are determined once when the representation is created
+ rather than for each record.
+*/
+@property(nonatomic, copy, readonly) NSSet *relationshipKeyPaths;
+
 @end
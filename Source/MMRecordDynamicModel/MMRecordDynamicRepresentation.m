@@ -24,12 +24,36 @@
 
 #import "MMRecordDynamicMarshaler.h"
 
+@interface MMRecordDynamicRepresentation ()
+
+@property(nonatomic, copy, readwrite) NSSet *relationshipKeyPaths;
+
+@end
+
 @implementation MMRecordDynamicRepresentation
 
+- (instancetype)initWithEntity:(NSEntityDescription *)entity {
+    if ((self = [super initWithEntity:entity])) {
+        NSMutableSet *relationshipKeyPaths = [NSMutableSet set];
+        
+        for (NSRelationshipDescription *relationshipDescription in [self relationshipDescriptions]) {
+            [relationshipKeyPaths addObjectsFromArray:[self keyPathsForMappingRelationshipDescription:relationshipDescription]];
+        }
+        
+        _relationshipKeyPaths = [relationshipKeyPaths copy];
+    }
+    return self;
+}
+
 - (Class)marshalerClass {
   return [MMRecordDynamicMarshaler class];
 }
 
+// The dynamic storage attribute holds every value in the dictionary, so none of them can be skipped.
+- (BOOL)readsUnmappedKeyPaths {
+    return YES;
+}
+
 - (void)setupMappingForProperty:(NSPropertyDescription *)property {
     if ([property isKindOfClass:[NSAttributeDescription class]]) {
         NSAttributeDescription *attributeDescription = (NSAttributeDescription *)property;
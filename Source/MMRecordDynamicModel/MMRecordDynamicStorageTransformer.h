@@ -0,0 +1,79 @@
+// MMRecordDynamicStorageTransformer.h
+//
+// Copyright (c) 2013 Mutual Mobile (http://www.mutualmobile.com/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+
+/**
+ The name under which `MMRecordDynamicStorageTransformer` is registered.  Use this as the Value
+ Transformer Name of the transformable attribute that an `MMRecordDynamicRepresentation` uses for
+ dynamic storage.
+ */
+extern NSString * const MMRecordDynamicStorageTransformerName;
+
+/**
+ This value transformer stores the dictionary held in a dynamic storage attribute in a compact 
+ binary encoding instead of the keyed archive that Core Data uses by default.
+ 
+ ## Encoding
+ 
+ The dictionary is encoded as a MessagePack value that follows a short header.  Each dictionary key
+ is only written out the first time it appears in a record.  Later occurrences, such as the keys of
+ the dictionaries in an array, refer back to it by index.  Decoded keys are shared between records, so
+ a fetch of many records does not hold a separate copy of the same key strings for each one.
+ 
+ Strings, numbers, dates, data, null, arrays and dictionaries with string keys are supported, which
+ covers every value a JSON response can contain.  A dictionary with other values is stored as a keyed
+ archive instead.
+ 
+ ## Lazy Decoding
+ 
+ Reverse transformation returns a dictionary that does not decode its contents until it is first 
+ accessed.  Fetching records does not decode dynamic storage that is never read, and saving a record 
+ whose dynamic storage has not been read or changed writes the original bytes back without decoding
+ them.
+ 
+ ## Migrating
+ 
+ Values stored with the default transformer are still read as keyed archives, so existing stores do 
+ not need to be migrated.  Values written after the transformer is adopted use the compact encoding.
+ */
+@interface MMRecordDynamicStorageTransformer : NSValueTransformer
+
+/**
+ Encodes a dictionary with the compact encoding used by this transformer.
+ 
+ @param dictionary The dictionary to encode.
+ @return The encoded data, or nil if the dictionary contains a value that the encoding does not
+ support.
+ */
++ (NSData *)dataWithDictionary:(NSDictionary *)dictionary;
+
+/**
+ Returns a dictionary backed by data that was encoded by this transformer.  The data is not decoded 
+ until the dictionary is first accessed.
+ 
+ @param data The encoded data.
+ @return The dictionary, or nil if the data was not created with the compact encoding.
+ */
++ (NSDictionary *)dictionaryWithData:(NSData *)data;
+
+@end
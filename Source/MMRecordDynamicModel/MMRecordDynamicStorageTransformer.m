@@ -0,0 +1,817 @@
+// MMRecordDynamicStorageTransformer.m
+//
+// Copyright (c) 2013 Mutual Mobile (http://www.mutualmobile.com/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "MMRecordDynamicStorageTransformer.h"
+
+NSString * const MMRecordDynamicStorageTransformerName = @"MMRecordDynamicStorageTransformer";
+
+// Encoded values start with this header, which ends with the version of the encoding.
+static const uint8_t MMRecordDynamicStorageHeader[] = { 'M', 'M', 'R', 'D', 1 };
+
+// Arrays and dictionaries nested deeper than this are not encoded or decoded.
+static const NSUInteger MMRecordDynamicStorageMaximumDepth = 512;
+
+// The number of keys in a record that can be referred to by index after their first occurrence.
+static const NSUInteger MMRecordDynamicStorageMaximumKeyReferences = 65536;
+
+// The number of distinct decoded keys that are shared between records.
+static const NSUInteger MMRecordDynamicStorageMaximumSharedKeys = 4096;
+
+static const int8_t MMRecordDynamicStorageTimestampExtensionType = -1;
+static const int8_t MMRecordDynamicStorageKeyReferenceExtensionType = 1;
+static const int8_t MMRecordDynamicStorageDecimalExtensionType = 2;
+
+typedef struct {
+    const uint8_t *bytes;
+    NSUInteger length;
+    NSUInteger offset;
+} MMRecordDynamicStorageReader;
+
+
+// This dictionary holds the encoded data from the store and decodes it the first time that any of
+// its contents are accessed.
+@interface MMRecordDynamicStorageDictionary : NSDictionary {
+    NSDictionary *_dictionary;
+}
+
+@property (nonatomic, strong, readonly) NSData *data;
+
+- (instancetype)initWithData:(NSData *)data;
+
+@end
+
+@interface MMRecordDynamicStorageTransformer ()
+
++ (NSDictionary *)decodedDictionaryWithData:(NSData *)data;
+
+@end
+
+
+@implementation MMRecordDynamicStorageTransformer
+
++ (void)load {
+    @autoreleasepool {
+        [NSValueTransformer setValueTransformer:[[self alloc] init]
+                                        forName:MMRecordDynamicStorageTransformerName];
+    }
+}
+
++ (Class)transformedValueClass {
+    return [NSData class];
+}
+
++ (BOOL)allowsReverseTransformation {
+    return YES;
+}
+
+- (id)transformedValue:(id)value {
+    if (value == nil) {
+        return nil;
+    }
+    
+    // Storage that was fetched and never changed is written back without decoding it.
+    if ([value isKindOfClass:[MMRecordDynamicStorageDictionary class]]) {
+        return [(MMRecordDynamicStorageDictionary *)value data];
+    }
+    
+    NSData *data = nil;
+    
+    if ([value isKindOfClass:[NSDictionary class]]) {
+        data = [[self class] dataWithDictionary:value];
+    }
+    
+    if (data == nil) {
+        data = [NSKeyedArchiver archivedDataWithRootObject:value];
+    }
+    
+    return data;
+}
+
+- (id)reverseTransformedValue:(id)value {
+    if ([value isKindOfClass:[NSData class]] == NO) {
+        return nil;
+    }
+    
+    NSDictionary *dictionary = [[self class] dictionaryWithData:value];
+    
+    if (dictionary != nil) {
+        return dictionary;
+    }
+    
+    // Values written by the default transformer, or that the encoding does not support, are keyed
+    // archives.
+    @try {
+        return [NSKeyedUnarchiver unarchiveObjectWithData:value];
+    }
+    @catch (NSException *exception) {
+        return nil;
+    }
+}
+
++ (NSData *)dataWithDictionary:(NSDictionary *)dictionary {
+    NSMutableData *data = [NSMutableData dataWithBytes:MMRecordDynamicStorageHeader
+                                                length:sizeof(MMRecordDynamicStorageHeader)];
+    NSMutableDictionary *keys = [NSMutableDictionary dictionary];
+    
+    if ([self encodeDictionary:dictionary data:data keys:keys depth:0] == NO) {
+        return nil;
+    }
+    
+    return data;
+}
+
++ (NSDictionary *)dictionaryWithData:(NSData *)data {
+    if ([data length] < sizeof(MMRecordDynamicStorageHeader) ||
+        memcmp([data bytes], MMRecordDynamicStorageHeader, sizeof(MMRecordDynamicStorageHeader)) != 0) {
+        return nil;
+    }
+    
+    return [[MMRecordDynamicStorageDictionary alloc] initWithData:[data copy]];
+}
+
++ (NSDictionary *)decodedDictionaryWithData:(NSData *)data {
+    MMRecordDynamicStorageReader reader = { [data bytes], [data length], sizeof(MMRecordDynamicStorageHeader) };
+    NSMutableArray *keys = [NSMutableArray array];
+    
+    id object = [self objectWithReader:&reader keys:keys depth:0];
+    
+    if ([object isKindOfClass:[NSDictionary class]] == NO || reader.offset != reader.length) {
+        return nil;
+    }
+    
+    return object;
+}
+
+
+#pragma mark - Encoding Objects
+
++ (BOOL)encodeObject:(id)object data:(NSMutableData *)data keys:(NSMutableDictionary *)keys depth:(NSUInteger)depth {
+    if (object == nil || object == [NSNull null]) {
+        [self writeType:0xc0 data:data];
+    } else if ([object isKindOfClass:[NSString class]]) {
+        return [self encodeString:object data:data];
+    } else if ([object isKindOfClass:[NSNumber class]]) {
+        return [self encodeNumber:object data:data];
+    } else if ([object isKindOfClass:[NSDictionary class]]) {
+        return [self encodeDictionary:object data:data keys:keys depth:depth];
+    } else if ([object isKindOfClass:[NSArray class]]) {
+        return [self encodeArray:object data:data keys:keys depth:depth];
+    } else if ([object isKindOfClass:[NSDate class]]) {
+        [self encodeDate:object data:data];
+    } else if ([object isKindOfClass:[NSData class]]) {
+        return [self encodeData:object data:data];
+    } else {
+        return NO;
+    }
+    
+    return YES;
+}
+
++ (BOOL)encodeDictionary:(NSDictionary *)dictionary
+                    data:(NSMutableData *)data
+                    keys:(NSMutableDictionary *)keys
+                   depth:(NSUInteger)depth {
+    NSUInteger count = [dictionary count];
+    
+    if (depth > MMRecordDynamicStorageMaximumDepth || count > UINT32_MAX) {
+        return NO;
+    }
+    
+    if (count < 16) {
+        [self writeType:(0x80 | count) data:data];
+    } else if (count <= UINT16_MAX) {
+        [self writeType:0xde unsignedInteger:count size:2 data:data];
+    } else {
+        [self writeType:0xdf unsignedInteger:count size:4 data:data];
+    }
+    
+    __block BOOL success = YES;
+    
+    [dictionary enumerateKeysAndObjectsUsingBlock:^(id key, id object, BOOL *stop) {
+        if ([self encodeKey:key data:data keys:keys] == NO ||
+            [self encodeObject:object data:data keys:keys depth:depth + 1] == NO) {
+            success = NO;
+            *stop = YES;
+        }
+    }];
+    
+    return success;
+}
+
++ (BOOL)encodeArray:(NSArray *)array data:(NSMutableData *)data keys:(NSMutableDictionary *)keys depth:(NSUInteger)depth {
+    NSUInteger count = [array count];
+    
+    if (depth > MMRecordDynamicStorageMaximumDepth || count > UINT32_MAX) {
+        return NO;
+    }
+    
+    if (count < 16) {
+        [self writeType:(0x90 | count) data:data];
+    } else if (count <= UINT16_MAX) {
+        [self writeType:0xdc unsignedInteger:count size:2 data:data];
+    } else {
+        [self writeType:0xdd unsignedInteger:count size:4 data:data];
+    }
+    
+    for (id object in array) {
+        if ([self encodeObject:object data:data keys:keys depth:depth + 1] == NO) {
+            return NO;
+        }
+    }
+    
+    return YES;
+}
+
+// The first occurrence of a key is written as a string, and later occurrences as an extension that
+// holds the index of the first one.
++ (BOOL)encodeKey:(id)key data:(NSMutableData *)data keys:(NSMutableDictionary *)keys {
+    if ([key isKindOfClass:[NSString class]] == NO) {
+        return NO;
+    }
+    
+    NSNumber *index = [keys objectForKey:key];
+    
+    if (index != nil) {
+        NSUInteger indexValue = [index unsignedIntegerValue];
+        NSUInteger size = (indexValue <= UINT8_MAX ? 1 : 2);
+        
+        [self writeType:(size == 1 ? 0xd4 : 0xd5) data:data];
+        [self writeType:(uint8_t)MMRecordDynamicStorageKeyReferenceExtensionType data:data];
+        [self writeUnsignedInteger:indexValue size:size data:data];
+        
+        return YES;
+    }
+    
+    if ([keys count] < MMRecordDynamicStorageMaximumKeyReferences) {
+        [keys setObject:@([keys count]) forKey:key];
+    }
+    
+    return [self encodeString:key data:data];
+}
+
++ (BOOL)encodeString:(NSString *)string data:(NSMutableData *)data {
+    NSUInteger length = [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    
+    if (length == 0 && [string length] > 0) {
+        return NO;
+    }
+    
+    if (length < 32) {
+        [self writeType:(0xa0 | length) data:data];
+    } else if (length <= UINT8_MAX) {
+        [self writeType:0xd9 unsignedInteger:length size:1 data:data];
+    } else if (length <= UINT16_MAX) {
+        [self writeType:0xda unsignedInteger:length size:2 data:data];
+    } else if (length <= UINT32_MAX) {
+        [self writeType:0xdb unsignedInteger:length size:4 data:data];
+    } else {
+        return NO;
+    }
+    
+    // The UTF-8 bytes are written directly into the data without an intermediate copy.
+    NSUInteger offset = [data length];
+    [data increaseLengthBy:length];
+    
+    return [string getBytes:(uint8_t *)[data mutableBytes] + offset
+                  maxLength:length
+                 usedLength:NULL
+                   encoding:NSUTF8StringEncoding
+                    options:0
+                      range:NSMakeRange(0, [string length])
+             remainingRange:NULL];
+}
+
++ (BOOL)encodeNumber:(NSNumber *)number data:(NSMutableData *)data {
+    // Decimal numbers are stored as their string value so they keep their precision.
+    if ([number isKindOfClass:[NSDecimalNumber class]]) {
+        NSData *stringData = [[number stringValue] dataUsingEncoding:NSUTF8StringEncoding];
+        
+        if ([stringData length] > UINT8_MAX) {
+            return NO;
+        }
+        
+        [self writeType:0xc7 unsignedInteger:[stringData length] size:1 data:data];
+        [self writeType:(uint8_t)MMRecordDynamicStorageDecimalExtensionType data:data];
+        [data appendData:stringData];
+        
+        return YES;
+    }
+    
+    if (CFGetTypeID((__bridge CFTypeRef)number) == CFBooleanGetTypeID()) {
+        [self writeType:([number boolValue] ? 0xc3 : 0xc2) data:data];
+    } else if (CFNumberIsFloatType((__bridge CFNumberRef)number)) {
+        double value = [number doubleValue];
+        float floatValue = (float)value;
+        
+        // Doubles that a float holds exactly are stored in half the space.
+        if ((double)floatValue == value) {
+            uint32_t bits = 0;
+            memcpy(&bits, &floatValue, sizeof(bits));
+            [self writeType:0xca unsignedInteger:bits size:4 data:data];
+        } else {
+            uint64_t bits = 0;
+            memcpy(&bits, &value, sizeof(bits));
+            [self writeType:0xcb unsignedInteger:bits size:8 data:data];
+        }
+    } else if (strcmp([number objCType], @encode(unsigned long long)) == 0 &&
+               [number unsignedLongLongValue] > LLONG_MAX) {
+        [self writeType:0xcf unsignedInteger:[number unsignedLongLongValue] size:8 data:data];
+    } else {
+        [self encodeInteger:[number longLongValue] data:data];
+    }
+    
+    return YES;
+}
+
++ (void)encodeInteger:(int64_t)value data:(NSMutableData *)data {
+    if (value >= 0) {
+        if (value <= 0x7f) {
+            [self writeType:(uint8_t)value data:data];
+        } else if (value <= UINT8_MAX) {
+            [self writeType:0xcc unsignedInteger:(uint64_t)value size:1 data:data];
+        } else if (value <= UINT16_MAX) {
+            [self writeType:0xcd unsignedInteger:(uint64_t)value size:2 data:data];
+        } else if (value <= UINT32_MAX) {
+            [self writeType:0xce unsignedInteger:(uint64_t)value size:4 data:data];
+        } else {
+            [self writeType:0xcf unsignedInteger:(uint64_t)value size:8 data:data];
+        }
+    } else {
+        if (value >= -32) {
+            [self writeType:(uint8_t)value data:data];
+        } else if (value >= INT8_MIN) {
+            [self writeType:0xd0 unsignedInteger:(uint64_t)value size:1 data:data];
+        } else if (value >= INT16_MIN) {
+            [self writeType:0xd1 unsignedInteger:(uint64_t)value size:2 data:data];
+        } else if (value >= INT32_MIN) {
+            [self writeType:0xd2 unsignedInteger:(uint64_t)value size:4 data:data];
+        } else {
+            [self writeType:0xd3 unsignedInteger:(uint64_t)value size:8 data:data];
+        }
+    }
+}
+
+// Dates use the 96 bit MessagePack timestamp.
++ (void)encodeDate:(NSDate *)date data:(NSMutableData *)data {
+    NSTimeInterval timeInterval = [date timeIntervalSince1970];
+    double seconds = floor(timeInterval);
+    uint32_t nanoseconds = (uint32_t)MIN((timeInterval - seconds) * 1e9, 999999999.0);
+    
+    [self writeType:0xc7 unsignedInteger:12 size:1 data:data];
+    [self writeType:(uint8_t)MMRecordDynamicStorageTimestampExtensionType data:data];
+    [self writeUnsignedInteger:nanoseconds size:4 data:data];
+    [self writeUnsignedInteger:(uint64_t)(int64_t)seconds size:8 data:data];
+}
+
++ (BOOL)encodeData:(NSData *)value data:(NSMutableData *)data {
+    NSUInteger length = [value length];
+    
+    if (length <= UINT8_MAX) {
+        [self writeType:0xc4 unsignedInteger:length size:1 data:data];
+    } else if (length <= UINT16_MAX) {
+        [self writeType:0xc5 unsignedInteger:length size:2 data:data];
+    } else if (length <= UINT32_MAX) {
+        [self writeType:0xc6 unsignedInteger:length size:4 data:data];
+    } else {
+        return NO;
+    }
+    
+    [data appendData:value];
+    
+    return YES;
+}
+
+
+#pragma mark - Writing Bytes
+
++ (void)writeType:(uint8_t)type data:(NSMutableData *)data {
+    [data appendBytes:&type length:1];
+}
+
++ (void)writeType:(uint8_t)type unsignedInteger:(uint64_t)value size:(NSUInteger)size data:(NSMutableData *)data {
+    [self writeType:type data:data];
+    [self writeUnsignedInteger:value size:size data:data];
+}
+
+// Writes the low bytes of an integer in big endian order.
++ (void)writeUnsignedInteger:(uint64_t)value size:(NSUInteger)size data:(NSMutableData *)data {
+    uint8_t bytes[8];
+    
+    for (NSUInteger i = 0; i < size; i++) {
+        bytes[i] = (uint8_t)(value >> (8 * (size - 1 - i)));
+    }
+    
+    [data appendBytes:bytes length:size];
+}
+
+
+#pragma mark - Decoding Objects
+
+// Returns nil if the data is invalid.  Only the types that the encoder writes are supported.
++ (id)objectWithReader:(MMRecordDynamicStorageReader *)reader keys:(NSMutableArray *)keys depth:(NSUInteger)depth {
+    uint64_t type = 0;
+    
+    if (depth > MMRecordDynamicStorageMaximumDepth || [self readUnsignedInteger:&type size:1 reader:reader] == NO) {
+        return nil;
+    }
+    
+    if (type <= 0x7f) {
+        return [NSNumber numberWithUnsignedChar:(uint8_t)type];
+    }
+    
+    if (type >= 0xe0) {
+        return [NSNumber numberWithChar:(int8_t)type];
+    }
+    
+    if ((type & 0xf0) == 0x80) {
+        return [self dictionaryWithCount:(type & 0x0f) reader:reader keys:keys depth:depth];
+    }
+    
+    if ((type & 0xf0) == 0x90) {
+        return [self arrayWithCount:(type & 0x0f) reader:reader keys:keys depth:depth];
+    }
+    
+    if ((type & 0xe0) == 0xa0) {
+        return [self stringWithLength:(type & 0x1f) reader:reader];
+    }
+    
+    uint64_t value = 0;
+    
+    switch (type) {
+        case 0xc0:
+            return [NSNull null];
+        case 0xc2:
+            return [NSNumber numberWithBool:NO];
+        case 0xc3:
+            return [NSNumber numberWithBool:YES];
+        case 0xc4:
+        case 0xc5:
+        case 0xc6: {
+            if ([self readUnsignedInteger:&value size:(1 << (type - 0xc4)) reader:reader] == NO) {
+                return nil;
+            }
+            
+            const uint8_t *bytes = [self readBytesWithLength:value reader:reader];
+            
+            return (bytes != NULL ? [NSData dataWithBytes:bytes length:(NSUInteger)value] : nil);
+        }
+        case 0xc7:
+            if ([self readUnsignedInteger:&value size:1 reader:reader] == NO) {
+                return nil;
+            }
+            
+            return [self extensionWithLength:value reader:reader];
+        case 0xca: {
+            if ([self readUnsignedInteger:&value size:4 reader:reader] == NO) {
+                return nil;
+            }
+            
+            uint32_t bits = (uint32_t)value;
+            float floatValue = 0;
+            memcpy(&floatValue, &bits, sizeof(floatValue));
+            
+            return [NSNumber numberWithDouble:floatValue];
+        }
+        case 0xcb: {
+            if ([self readUnsignedInteger:&value size:8 reader:reader] == NO) {
+                return nil;
+            }
+            
+            double doubleValue = 0;
+            memcpy(&doubleValue, &value, sizeof(doubleValue));
+            
+            return [NSNumber numberWithDouble:doubleValue];
+        }
+        case 0xcc:
+        case 0xcd:
+        case 0xce:
+        case 0xcf:
+            if ([self readUnsignedInteger:&value size:(1 << (type - 0xcc)) reader:reader] == NO) {
+                return nil;
+            }
+            
+            if (value > LLONG_MAX) {
+                return [NSNumber numberWithUnsignedLongLong:value];
+            }
+            
+            return [NSNumber numberWithLongLong:(long long)value];
+        case 0xd0:
+        case 0xd1:
+        case 0xd2:
+        case 0xd3: {
+            NSUInteger size = (1 << (type - 0xd0));
+            
+            if ([self readUnsignedInteger:&value size:size reader:reader] == NO) {
+                return nil;
+            }
+            
+            // Sign extend the value from its encoded size.
+            NSUInteger shift = 64 - (size * 8);
+            
+            return [NSNumber numberWithLongLong:((int64_t)(value << shift) >> shift)];
+        }
+        case 0xd9:
+        case 0xda:
+        case 0xdb:
+            if ([self readUnsignedInteger:&value size:(1 << (type - 0xd9)) reader:reader] == NO) {
+                return nil;
+            }
+            
+            return [self stringWithLength:value reader:reader];
+        case 0xdc:
+        case 0xdd:
+            if ([self readUnsignedInteger:&value size:(type == 0xdc ? 2 : 4) reader:reader] == NO) {
+                return nil;
+            }
+            
+            return [self arrayWithCount:value reader:reader keys:keys depth:depth];
+        case 0xde:
+        case 0xdf:
+            if ([self readUnsignedInteger:&value size:(type == 0xde ? 2 : 4) reader:reader] == NO) {
+                return nil;
+            }
+            
+            return [self dictionaryWithCount:value reader:reader keys:keys depth:depth];
+        default:
+            return nil;
+    }
+}
+
++ (id)dictionaryWithCount:(uint64_t)count
+                   reader:(MMRecordDynamicStorageReader *)reader
+                     keys:(NSMutableArray *)keys
+                    depth:(NSUInteger)depth {
+    // Every entry takes at least two bytes, which bounds the capacity for malformed counts.
+    if (count > (reader->length - reader->offset) / 2) {
+        return nil;
+    }
+    
+    NSMutableDictionary *dictionary = [NSMutableDictionary dictionaryWithCapacity:(NSUInteger)count];
+    
+    for (uint64_t i = 0; i < count; i++) {
+        NSString *key = [self keyWithReader:reader keys:keys];
+        
+        if (key == nil) {
+            return nil;
+        }
+        
+        id object = [self objectWithReader:reader keys:keys depth:depth + 1];
+        
+        if (object == nil) {
+            return nil;
+        }
+        
+        [dictionary setObject:object forKey:key];
+    }
+    
+    return dictionary;
+}
+
++ (id)arrayWithCount:(uint64_t)count
+              reader:(MMRecordDynamicStorageReader *)reader
+                keys:(NSMutableArray *)keys
+               depth:(NSUInteger)depth {
+    if (count > reader->length - reader->offset) {
+        return nil;
+    }
+    
+    NSMutableArray *array = [NSMutableArray arrayWithCapacity:(NSUInteger)count];
+    
+    for (uint64_t i = 0; i < count; i++) {
+        id object = [self objectWithReader:reader keys:keys depth:depth + 1];
+        
+        if (object == nil) {
+            return nil;
+        }
+        
+        [array addObject:object];
+    }
+    
+    return array;
+}
+
++ (NSString *)keyWithReader:(MMRecordDynamicStorageReader *)reader keys:(NSMutableArray *)keys {
+    uint64_t type = 0;
+    uint64_t value = 0;
+    
+    if ([self readUnsignedInteger:&type size:1 reader:reader] == NO) {
+        return nil;
+    }
+    
+    if (type == 0xd4 || type == 0xd5) {
+        uint64_t extensionType = 0;
+        
+        if ([self readUnsignedInteger:&extensionType size:1 reader:reader] == NO ||
+            (int8_t)extensionType != MMRecordDynamicStorageKeyReferenceExtensionType ||
+            [self readUnsignedInteger:&value size:(type == 0xd4 ? 1 : 2) reader:reader] == NO ||
+            value >= [keys count]) {
+            return nil;
+        }
+        
+        return [keys objectAtIndex:(NSUInteger)value];
+    }
+    
+    if ((type & 0xe0) == 0xa0) {
+        value = type & 0x1f;
+    } else if (type >= 0xd9 && type <= 0xdb) {
+        if ([self readUnsignedInteger:&value size:(1 << (type - 0xd9)) reader:reader] == NO) {
+            return nil;
+        }
+    } else {
+        return nil;
+    }
+    
+    const uint8_t *bytes = [self readBytesWithLength:value reader:reader];
+    
+    if (bytes == NULL) {
+        return nil;
+    }
+    
+    NSString *key = [self sharedKeyWithBytes:bytes length:(NSUInteger)value];
+    
+    if (key != nil && [keys count] < MMRecordDynamicStorageMaximumKeyReferences) {
+        [keys addObject:key];
+    }
+    
+    return key;
+}
+
+// Returns the instance of a key that is shared between all of the records that contain it.
++ (NSString *)sharedKeyWithBytes:(const uint8_t *)bytes length:(NSUInteger)length {
+    static NSMutableDictionary *sharedKeys = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedKeys = [NSMutableDictionary dictionary];
+    });
+    
+    NSString *key = [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+    
+    if (key == nil) {
+        return nil;
+    }
+    
+    @synchronized(sharedKeys) {
+        NSString *sharedKey = [sharedKeys objectForKey:key];
+        
+        if (sharedKey != nil) {
+            return sharedKey;
+        }
+        
+        if ([sharedKeys count] < MMRecordDynamicStorageMaximumSharedKeys) {
+            [sharedKeys setObject:key forKey:key];
+        }
+    }
+    
+    return key;
+}
+
++ (id)stringWithLength:(uint64_t)length reader:(MMRecordDynamicStorageReader *)reader {
+    const uint8_t *bytes = [self readBytesWithLength:length reader:reader];
+    
+    if (bytes == NULL) {
+        return nil;
+    }
+    
+    return [[NSString alloc] initWithBytes:bytes length:(NSUInteger)length encoding:NSUTF8StringEncoding];
+}
+
++ (id)extensionWithLength:(uint64_t)length reader:(MMRecordDynamicStorageReader *)reader {
+    uint64_t extensionType = 0;
+    
+    if ([self readUnsignedInteger:&extensionType size:1 reader:reader] == NO) {
+        return nil;
+    }
+    
+    const uint8_t *bytes = [self readBytesWithLength:length reader:reader];
+    
+    if (bytes == NULL) {
+        return nil;
+    }
+    
+    if ((int8_t)extensionType == MMRecordDynamicStorageTimestampExtensionType && length == 12) {
+        MMRecordDynamicStorageReader timestampReader = { bytes, 12, 0 };
+        uint64_t nanoseconds = 0;
+        uint64_t seconds = 0;
+        
+        [self readUnsignedInteger:&nanoseconds size:4 reader:&timestampReader];
+        [self readUnsignedInteger:&seconds size:8 reader:&timestampReader];
+        
+        return [NSDate dateWithTimeIntervalSince1970:(int64_t)seconds + nanoseconds / 1e9];
+    }
+    
+    if ((int8_t)extensionType == MMRecordDynamicStorageDecimalExtensionType) {
+        NSString *string = [[NSString alloc] initWithBytes:bytes length:(NSUInteger)length encoding:NSUTF8StringEncoding];
+        
+        return (string != nil ? [NSDecimalNumber decimalNumberWithString:string] : nil);
+    }
+    
+    return nil;
+}
+
+
+#pragma mark - Reading Bytes
+
+// Reads a big endian unsigned integer of the given size in bytes.
++ (BOOL)readUnsignedInteger:(uint64_t *)value size:(NSUInteger)size reader:(MMRecordDynamicStorageReader *)reader {
+    if (size > reader->length - reader->offset) {
+        return NO;
+    }
+    
+    uint64_t result = 0;
+    
+    for (NSUInteger i = 0; i < size; i++) {
+        result = (result << 8) | reader->bytes[reader->offset + i];
+    }
+    
+    reader->offset += size;
+    *value = result;
+    
+    return YES;
+}
+
++ (const uint8_t *)readBytesWithLength:(uint64_t)length reader:(MMRecordDynamicStorageReader *)reader {
+    if (length > reader->length - reader->offset) {
+        return NULL;
+    }
+    
+    const uint8_t *bytes = reader->bytes + reader->offset;
+    reader->offset += (NSUInteger)length;
+    
+    return bytes;
+}
+
+@end
+
+
+@implementation MMRecordDynamicStorageDictionary
+
+- (instancetype)initWithData:(NSData *)data {
+    if ((self = [super init])) {
+        _data = data;
+    }
+    
+    return self;
+}
+
+- (NSDictionary *)decodedDictionary {
+    @synchronized(self) {
+        if (_dictionary == nil) {
+            _dictionary = [MMRecordDynamicStorageTransformer decodedDictionaryWithData:_data] ?: @{};
+        }
+        
+        return _dictionary;
+    }
+}
+
+- (NSUInteger)count {
+    return [[self decodedDictionary] count];
+}
+
+- (id)objectForKey:(id)aKey {
+    return [[self decodedDictionary] objectForKey:aKey];
+}
+
+- (NSEnumerator *)keyEnumerator {
+    return [[self decodedDictionary] keyEnumerator];
+}
+
+- (NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState *)state
+                                  objects:(id __unsafe_unretained [])buffer
+                                    count:(NSUInteger)len {
+    return [[self decodedDictionary] countByEnumeratingWithState:state objects:buffer count:len];
+}
+
+- (void)enumerateKeysAndObjectsWithOptions:(NSEnumerationOptions)options
+                                usingBlock:(void (^)(id key, id obj, BOOL *stop))block {
+    [[self decodedDictionary] enumerateKeysAndObjectsWithOptions:options usingBlock:block];
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self;
+}
+
+// Archives of this dictionary do not depend on this class.
+- (Class)classForCoder {
+    return [NSDictionary class];
+}
+
+@end
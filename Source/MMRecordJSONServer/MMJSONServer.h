@@ -36,7 +36,11 @@
  endpoint. If the server gets a request for a URN containing "people", then it would return the 
  "people" JSON file. You can register components individually using the register method, or you can 
  return a complete dictionary of resources and their componenets by subclassing and overriding the 
- -registeredResourceNamesWithPathComponenets method.
+ -registeredResourceNamesWithPathComponenets method. A path component matches whole segments of the 
+ URN's path, so "people" matches "api/people?page=2" but not "api/peoplesearch", and a path component
+ can span several segments, such as "people/friends". The path components are indexed by segment, so
+ the cost of finding a resource does not grow with the number of registered components. If more than
+ one path component is contained in a URN, the one with the most segments wins.
  
  ## Complex Resources
  
@@ -49,6 +53,14 @@
  Once a resource name is located, it will be loaded and parsed as JSON into a JSON object. That 
  object will then be returned in the response block from MMServer back to the caller from MMRecord.
  
+ ## Resource Caching
+ 
+ By default each resource is read from disk and parsed every time it is requested. If you are using 
+ this server to measure the performance of your app, for example the speed at which MMRecord can 
+ import responses, you should override shouldCacheParsedResources to return YES. Each resource will 
+ then be memory mapped and parsed only once, and the same immutable JSON object will be returned for
+ every subsequent request.
+ 
  ## Simulated Delay
  
  One thing that's good about local servers is that they are very fast. When you are dealing with 
@@ -77,9 +89,18 @@
  
  @return Dictionary of registered resource names and path componenents.
  @discussion The key should be the path component string, and the value should be the resource name.
+ The dictionary is indexed the first time a resource is looked up.  If a subclass changes the 
+ dictionary it returns after that, it should call invalidateRegisteredResourceNames.
  */
 + (NSMutableDictionary *)registeredResourceNamesWithPathComponents;
 
+/**
+ This method discards the index of registered path components, so that it is rebuilt from the 
+ current resource names the next time a resource is looked up.  Registering a resource name with 
+ registerResourceName:forPathComponent: does this automatically.
+ */
++ (void)invalidateRegisteredResourceNames;
+
 /** 
  This method allows you to register a resource name for a given path component.
  
@@ -105,6 +126,14 @@
  */
 + (NSTimeInterval)simulatedServerDelayTime;
 
+/**
+ This method allows you to cache the parsed contents of resource files.
+ 
+ @return This method should return YES if a subclass wishes to parse each resource only once.
+ @discussion This method returns NO by default.
+ */
++ (BOOL)shouldCacheParsedResources;
+
 /**
  This method allows you to load a specified JSON file with a given resource name.
  @param resourceName The name of the JSON file you want to load.
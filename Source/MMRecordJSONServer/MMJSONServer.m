@@ -22,13 +22,22 @@
 
 #import "MMJSONServer.h"
 
-@interface NSString (MMJSONServerContains)
+// This class is a node in the tree used to look up the resource registered for a URN.  Each level of
+// the tree matches one segment of a path, so a registered path component such as "users/posts" is
+// found by following two segments of the URN.
+@interface MMJSONServerRouteNode : NSObject
 
-- (BOOL)MMJSONServer_containsString: (NSString*) substring;
+@property (nonatomic, strong) NSMutableDictionary *children;
+@property (nonatomic, copy) NSString *resourceName;
+
+- (void)insertResourceName:(NSString *)resourceName forPathComponent:(NSString *)pathComponent;
+- (NSString *)resourceNameForLongestPathComponentInURN:(NSString *)URN;
 
 @end
 
 static NSMutableDictionary* MM_registeredResourceNames;
+static NSMutableDictionary* MM_routeIndexes;
+static NSMutableDictionary* MM_parsedResources;
 
 @implementation MMJSONServer
 
@@ -42,14 +51,41 @@ static NSMutableDictionary* MM_registeredResourceNames;
 
 + (NSString *)registeredResourceNameFromPathComponentsForURN:(NSString *)URN {
     NSMutableDictionary *dict = [self registeredResourceNames];
+    
+    @synchronized([MMJSONServer class]) {
+        return [[self routeIndexForResourceNames:dict] resourceNameForLongestPathComponentInURN:URN];
+    }
+}
 
-    for (NSString *key in [dict allKeys]) {
-        if ([URN MMJSONServer_containsString:key]) {
-            return [dict objectForKey:key];
-        }
+// Each server class keeps its own index, which is built from its resource names the first time it
+// is needed and kept until the resource names are invalidated.
++ (MMJSONServerRouteNode *)routeIndexForResourceNames:(NSDictionary *)dict {
+    if (MM_routeIndexes == nil) {
+        MM_routeIndexes = [NSMutableDictionary dictionary];
     }
     
-    return nil;
+    NSString *className = NSStringFromClass(self);
+    MMJSONServerRouteNode *routeIndex = [MM_routeIndexes objectForKey:className];
+    
+    if (routeIndex != nil) {
+        return routeIndex;
+    }
+    
+    routeIndex = [[MMJSONServerRouteNode alloc] init];
+    
+    for (NSString *pathComponent in dict) {
+        [routeIndex insertResourceName:[dict objectForKey:pathComponent] forPathComponent:pathComponent];
+    }
+    
+    [MM_routeIndexes setObject:routeIndex forKey:className];
+    
+    return routeIndex;
+}
+
++ (void)invalidateRegisteredResourceNames {
+    @synchronized([MMJSONServer class]) {
+        [MM_routeIndexes removeAllObjects];
+    }
 }
 
 + (NSMutableDictionary *)registeredResourceNames {
@@ -69,7 +105,11 @@ static NSMutableDictionary* MM_registeredResourceNames;
 + (void)registerResourceName:(NSString *)resourceName
             forPathComponent:(NSString *)pathComponent {
     NSMutableDictionary *dict = [self registeredResourceNames];
-    [dict setObject:resourceName forKey:pathComponent];
+    
+    @synchronized([MMJSONServer class]) {
+        [dict setObject:resourceName forKey:pathComponent];
+        [MM_routeIndexes removeAllObjects];
+    }
 }
 
 + (BOOL)shouldSimulateServerDelay {
@@ -80,23 +120,55 @@ static NSMutableDictionary* MM_registeredResourceNames;
     return 0.1;
 }
 
-+ (id)dataForJSONResource:(NSString *)resourceName error:(NSError **)error{
++ (BOOL)shouldCacheParsedResources {
+    return NO;
+}
+
++ (id)dataForJSONResource:(NSString *)resourceName error:(NSError **)error {
+    if ([self shouldCacheParsedResources] == NO) {
+        return [self dataForJSONResource:resourceName readingOptions:NSDataReadingUncached error:error];
+    }
+    
+    @synchronized([MMJSONServer class]) {
+        if (MM_parsedResources == nil) {
+            MM_parsedResources = [NSMutableDictionary dictionary];
+        }
+        
+        id data = [MM_parsedResources objectForKey:resourceName];
+        
+        if (data == nil) {
+            data = [self dataForJSONResource:resourceName readingOptions:NSDataReadingMappedIfSafe error:error];
+            
+            if (data != nil) {
+                [MM_parsedResources setObject:data forKey:resourceName];
+            }
+        }
+        
+        return data;
+    }
+}
+
++ (id)dataForJSONResource:(NSString *)resourceName
+           readingOptions:(NSDataReadingOptions)readingOptions
+                    error:(NSError **)error {
 	id data = nil;
     
     NSURL *jsonURL = [[NSBundle mainBundle] URLForResource:resourceName withExtension:@"json"];
     
 	if (jsonURL != nil) {
-        NSError* parsingError = nil;
-        NSData *jsonData = [NSData dataWithContentsOfURL:jsonURL options:NSDataReadingUncached error:&parsingError];
+        NSError* readingError = nil;
+        NSData *jsonData = [NSData dataWithContentsOfURL:jsonURL options:readingOptions error:&readingError];
         if (jsonData != nil) {
             NSError *jsonError;
             data = [NSJSONSerialization JSONObjectWithData:jsonData options:NSJSONReadingAllowFragments error:&jsonError];
             if (data == nil) {
-                NSLog(@"JSON error: %@", parsingError);
+                NSLog(@"JSON error: %@", jsonError);
                 
                 if (error != nil)
-                    *error = parsingError;
+                    *error = jsonError;
             }
+        } else if (error != nil) {
+            *error = readingError;
         }
 	}
 	
@@ -164,12 +236,78 @@ static NSMutableDictionary* MM_registeredResourceNames;
 @end
 
 
-@implementation NSString(MMJSONServerContains)
+@implementation MMJSONServerRouteNode
+
+// The query and fragment of a URN are not part of its path.
+static NSArray *MMJSONServerPathSegments(NSString *path) {
+    NSRange suffixRange = [path rangeOfCharacterFromSet:[NSCharacterSet characterSetWithCharactersInString:@"?#"]];
+    
+    if (suffixRange.location != NSNotFound) {
+        path = [path substringToIndex:suffixRange.location];
+    }
+    
+    NSMutableArray *segments = [NSMutableArray array];
+    
+    for (NSString *segment in [path componentsSeparatedByString:@"/"]) {
+        if ([segment length] > 0) {
+            [segments addObject:segment];
+        }
+    }
+    
+    return segments;
+}
+
+- (void)insertResourceName:(NSString *)resourceName forPathComponent:(NSString *)pathComponent {
+    MMJSONServerRouteNode *node = self;
+    
+    for (NSString *segment in MMJSONServerPathSegments(pathComponent)) {
+        if (node.children == nil) {
+            node.children = [NSMutableDictionary dictionary];
+        }
+        
+        MMJSONServerRouteNode *child = [node.children objectForKey:segment];
+        
+        if (child == nil) {
+            child = [[MMJSONServerRouteNode alloc] init];
+            [node.children setObject:child forKey:segment];
+        }
+        
+        node = child;
+    }
+    
+    if (node != self) {
+        node.resourceName = resourceName;
+    }
+}
 
-- (BOOL)MMJSONServer_containsString:(NSString *)substring {
-    NSRange range = [self rangeOfString : substring];
-    BOOL found = (range.location != NSNotFound);
-    return found;
+// Walks the tree from each segment of the URN.  Each step is a single dictionary lookup, and a walk
+// only goes as deep as the longest registered path component, so a lookup costs the number of
+// segments in the URN times that depth, which is one for path components of a single segment.
+- (NSString *)resourceNameForLongestPathComponentInURN:(NSString *)URN {
+    NSArray *segments = MMJSONServerPathSegments(URN);
+    NSUInteger count = [segments count];
+    
+    NSString *resourceName = nil;
+    NSUInteger longestMatch = 0;
+    
+    for (NSUInteger start = 0; start < count; start++) {
+        MMJSONServerRouteNode *node = self;
+        
+        for (NSUInteger i = start; i < count && node.children != nil; i++) {
+            node = [node.children objectForKey:[segments objectAtIndex:i]];
+            
+            if (node == nil) {
+                break;
+            }
+            
+            if (node.resourceName != nil && i - start + 1 > longestMatch) {
+                resourceName = node.resourceName;
+                longestMatch = i - start + 1;
+            }
+        }
+    }
+    
+    return resourceName;
 }
 
-@end
\ No newline at end of file
+@end
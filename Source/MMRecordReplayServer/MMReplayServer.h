@@ -0,0 +1,216 @@
+// MMReplayServer.h
+//
+// Copyright (c) 2013 Mutual Mobile (http://www.mutualmobile.com/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "MMServer.h"
+
+@class MMReplayServerLatencyModel;
+
+/**
+ The modes that MMReplayServer can operate in.
+ */
+typedef NS_ENUM(NSInteger, MMReplayServerMode) {
+    MMReplayServerModeReplay = 0,
+    MMReplayServerModeRecord = 1
+};
+
+/**
+ The error domain and codes used by MMReplayServer.
+ */
+extern NSString * const MMReplayServerErrorDomain;
+
+typedef NS_ENUM(NSInteger, MMReplayServerErrorCode) {
+    MMReplayServerErrorCodeMissingRecording = 1,
+    MMReplayServerErrorCodeInjectedFailure  = 2,
+    MMReplayServerErrorCodeMissingLiveServer = 3,
+    MMReplayServerErrorCodeUnacceptableStatusCode = 4
+};
+
+/**
+ This is a server class that records the responses returned by another server, and replays them 
+ later without a network connection. It is meant to be used for reproducing real traffic patterns 
+ locally, for example while investigating the import throughput or tail latency of your app. 
+ 
+ ## Recording
+ 
+ To record responses, register the server class you would normally use, such as MMAFJSONServer, 
+ with registerLiveServerClass:, set a recording directory, and set the mode to 
+ MMReplayServerModeRecord. Every request is built with the live server's 
+ requestWithURN:data:responseSchema:, so that it includes the same parameters a live request would, 
+ and sent with NSURLConnection.  Waiting requests are sent in order of their priority.  The raw response body is written to the recording directory along with 
+ its MIME type, status code and the time it took to arrive, or the error if the request failed.  
+ Requests are identified by their URN and parameters. If the same request is made more than once, 
+ each response is recorded in order.  Requests cannot be recorded without a live server class, and 
+ fail with the MMReplayServerErrorCodeMissingLiveServer error.
+ 
+ ## Replaying
+ 
+ In replay mode the responses for a request are returned in the order they were recorded, starting 
+ over once they have all been returned. Responses are decoded on a background queue after a delay 
+ chosen by the latency model, and the response and failure blocks are called on the main queue in 
+ both modes. Recorded bodies are decoded by the decoder registered with MMServer for
+ their MIME type, using the response schema if one is passed, just as a live server would decode 
+ them.  Responses recorded with a status code outside of 200-299 fail with the 
+ MMReplayServerErrorCodeUnacceptableStatusCode error.  Requests for which no recording exists fail 
+ with the MMReplayServerErrorCodeMissingRecording error.
+ 
+ ## Latency Model
+ 
+ The latency model simulates the network between your app and the server. It samples the latency 
+ of each response from a log-normal distribution, adds jitter, adds the time needed to transfer the 
+ response at a given bandwidth, and can fail a given fraction of requests. The model uses a seeded 
+ random number generator, so the same seed produces the same sequence of delays and failures.
+ 
+ ## Cancellation
+ 
+ Requests are registered with their domain. Cancelled requests call their failure block with an 
+ NSURLErrorCancelled error instead of delivering their response, and in record mode their response
+ is not recorded.
+ */
+
+@interface MMReplayServer : MMServer
+
+/**
+ Registers the server class that builds the requests sent in record mode. The page manager class 
+ and requestWithURN:data: implementation of the live server are used in both modes.  Without a live 
+ server, requestWithURN:data: returns a request whose URL identifies the recording.
+ 
+ @param serverClass A subclass of MMServer.
+ */
++ (void)registerLiveServerClass:(Class)serverClass;
+
+/**
+ Sets the directory that recordings are written to and read from. The directory will be created if
+ it does not exist.
+ 
+ @param directoryURL A file URL for the recording directory.
+ */
++ (void)setRecordingDirectoryURL:(NSURL *)directoryURL;
+
+/**
+ Sets the mode of the server.
+ 
+ @param mode The mode to use for subsequent requests.
+ @discussion The default mode is MMReplayServerModeReplay.
+ */
++ (void)setMode:(MMReplayServerMode)mode;
+
+/**
+ Sets the latency model used to delay replayed responses.
+ 
+ @param latencyModel The latency model to use.  Passing nil removes all simulated delay.
+ */
++ (void)setLatencyModel:(MMReplayServerLatencyModel *)latencyModel;
+
+/**
+ Starts every replayed request over from its first recorded response, and resets the random number 
+ generator of the latency model to its seed. Call this between runs to make them deterministic.
+ */
++ (void)resetReplay;
+
+@end
+
+
+/**
+ This class describes the network conditions that MMReplayServer simulates when replaying responses.
+ */
+
+@interface MMReplayServerLatencyModel : NSObject
+
+/**
+ Returns a latency model with the given seed and no latency.
+ 
+ @param seed The seed for the random number generator.
+ */
++ (instancetype)latencyModelWithSeed:(uint64_t)seed;
+
+/**
+ The seed for the random number generator.
+ */
+@property (nonatomic, assign) uint64_t seed;
+
+/**
+ The median latency of a response, in seconds.
+ 
+ @discussion Default value is 0.
+ */
+@property (nonatomic, assign) NSTimeInterval medianLatency;
+
+/**
+ The standard deviation of the natural logarithm of the latency. Larger values produce a longer 
+ tail of slow responses.
+ 
+ @discussion Default value is 0, which makes every latency equal to the median.
+ */
+@property (nonatomic, assign) double latencyDeviation;
+
+/**
+ The maximum amount of uniformly distributed jitter, in seconds, added to or subtracted from each 
+ latency.
+ 
+ @discussion Default value is 0.
+ */
+@property (nonatomic, assign) NSTimeInterval jitter;
+
+/**
+ The simulated bandwidth in bytes per second. The transfer time of each response is added to its 
+ latency.
+ 
+ @discussion Default value is 0, which means the bandwidth is unlimited.
+ */
+@property (nonatomic, assign) double bandwidth;
+
+/**
+ The fraction of requests, between 0 and 1, that should fail with the 
+ MMReplayServerErrorCodeInjectedFailure error.
+ 
+ @discussion Default value is 0.
+ */
+@property (nonatomic, assign) double failureRate;
+
+/**
+ Use the latency recorded for each response instead of sampling one from the log-normal 
+ distribution. Jitter and bandwidth are still applied.
+ 
+ @discussion Default value is NO.
+ */
+@property (nonatomic, assign) BOOL usesRecordedLatency;
+
+/**
+ Returns the delay for a response.
+ 
+ @param length The length of the response body in bytes.
+ @param recordedLatency The latency that was recorded for the response.
+ @return The delay in seconds.
+ */
+- (NSTimeInterval)delayForResponseWithLength:(NSUInteger)length recordedLatency:(NSTimeInterval)recordedLatency;
+
+/**
+ Returns YES if the next request should fail.
+ */
+- (BOOL)shouldFailRequest;
+
+/**
+ Resets the random number generator to the seed.
+ */
+- (void)reset;
+
+@end
@@ -0,0 +1,631 @@
+// MMReplayServer.m
+//
+// Copyright (c) 2013 Mutual Mobile (http://www.mutualmobile.com/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "MMReplayServer.h"
+
+#import "MMRecordCache.h"
+#import "MMRecordLoggers.h"
+
+NSString * const MMReplayServerErrorDomain = @"com.mutualmobile.mmreplayserver";
+
+static Class MM_liveServerClass;
+static NSURL* MM_recordingDirectoryURL;
+static MMReplayServerMode MM_replayServerMode;
+static MMReplayServerLatencyModel* MM_latencyModel;
+static NSMutableDictionary* MM_recordings;
+static NSMutableDictionary* MM_replayPositions;
+
+// This class represents a replayed request, so that it can be registered with its domain and cancelled.
+@interface MMReplayServerRequest : NSObject
+
+@property (atomic, getter = isCancelled) BOOL cancelled;
+
+- (void)cancel;
+
+@end
+
+
+@implementation MMReplayServer
+
+#pragma mark - Configuration
+
++ (void)registerLiveServerClass:(Class)serverClass {
+    if ([serverClass isSubclassOfClass:[MMServer class]]) {
+        MM_liveServerClass = serverClass;
+    }
+}
+
++ (void)setRecordingDirectoryURL:(NSURL *)directoryURL {
+    [[NSFileManager defaultManager] createDirectoryAtURL:directoryURL
+                             withIntermediateDirectories:YES
+                                              attributes:nil
+                                                   error:NULL];
+    
+    @synchronized([MMReplayServer class]) {
+        MM_recordingDirectoryURL = directoryURL;
+        MM_recordings = nil;
+        MM_replayPositions = nil;
+    }
+}
+
++ (void)setMode:(MMReplayServerMode)mode {
+    MM_replayServerMode = mode;
+}
+
++ (void)setLatencyModel:(MMReplayServerLatencyModel *)latencyModel {
+    MM_latencyModel = latencyModel;
+}
+
++ (void)resetReplay {
+    @synchronized([MMReplayServer class]) {
+        MM_replayPositions = nil;
+    }
+    
+    [MM_latencyModel reset];
+}
+
+
+#pragma mark - MMServer Subclass Methods
+
++ (void)cancelRequestsWithDomain:(id)domain {
+    [self cancelRegisteredRequestsForDomain:domain];
+}
+
++ (Class)pageManagerClass {
+    if (MM_liveServerClass != nil) {
+        return [MM_liveServerClass pageManagerClass];
+    }
+    
+    return [super pageManagerClass];
+}
+
+// Without a live server the request is identified by its recording, so that requests for the same URN
+// and parameters still produce the same URL.
++ (NSURLRequest *)requestWithURN:(NSString *)URN data:(NSDictionary *)data {
+    if (MM_liveServerClass != nil) {
+        return [MM_liveServerClass requestWithURN:URN data:data];
+    }
+    
+    NSString *key = [self recordingKeyForURN:URN data:data];
+    
+    return [NSURLRequest requestWithURL:[NSURL URLWithString:[@"mmreplay://recording/" stringByAppendingString:key]]];
+}
+
++ (void)startRequestWithURN:(NSString *)URN
+                       data:(NSDictionary *)data
+                      paged:(BOOL)paged
+                     domain:(id)domain
+                    batched:(BOOL)batched
+              dispatchGroup:(dispatch_group_t)dispatchGroup
+              responseBlock:(void (^)(id responseObject))responseBlock
+               failureBlock:(void (^)(NSError *error))failureBlock {
+    [self startRequestWithURN:URN
+                         data:data
+                        paged:paged
+                       domain:domain
+                      batched:batched
+                dispatchGroup:dispatchGroup
+                     priority:MMRecordRequestPriorityDefault
+               responseSchema:nil
+                responseBlock:responseBlock
+                 failureBlock:failureBlock];
+}
+
++ (void)startRequestWithURN:(NSString *)URN
+                       data:(NSDictionary *)data
+                      paged:(BOOL)paged
+                     domain:(id)domain
+                    batched:(BOOL)batched
+              dispatchGroup:(dispatch_group_t)dispatchGroup
+                   priority:(MMRecordRequestPriority)priority
+              responseBlock:(void (^)(id responseObject))responseBlock
+               failureBlock:(void (^)(NSError *error))failureBlock {
+    [self startRequestWithURN:URN
+                         data:data
+                        paged:paged
+                       domain:domain
+                      batched:batched
+                dispatchGroup:dispatchGroup
+                     priority:priority
+               responseSchema:nil
+                responseBlock:responseBlock
+                 failureBlock:failureBlock];
+}
+
++ (void)startRequestWithURN:(NSString *)URN
+                       data:(NSDictionary *)data
+                      paged:(BOOL)paged
+                     domain:(id)domain
+                    batched:(BOOL)batched
+              dispatchGroup:(dispatch_group_t)dispatchGroup
+                   priority:(MMRecordRequestPriority)priority
+             responseSchema:(MMServerResponseSchema *)responseSchema
+              responseBlock:(void (^)(id responseObject))responseBlock
+               failureBlock:(void (^)(NSError *error))failureBlock {
+    if (MM_replayServerMode == MMReplayServerModeRecord) {
+        [self recordRequestWithURN:URN
+                              data:data
+                            domain:domain
+                          priority:priority
+                    responseSchema:responseSchema
+                     responseBlock:responseBlock
+                      failureBlock:failureBlock];
+    } else {
+        [self replayRequestWithURN:URN
+                              data:data
+                            domain:domain
+                          priority:priority
+                    responseSchema:responseSchema
+                     responseBlock:responseBlock
+                      failureBlock:failureBlock];
+    }
+}
+
++ (NSURLRequest *)requestWithURN:(NSString *)URN
+                            data:(NSDictionary *)data
+                  responseSchema:(MMServerResponseSchema *)responseSchema {
+    if (MM_liveServerClass != nil) {
+        return [MM_liveServerClass requestWithURN:URN data:data responseSchema:responseSchema];
+    }
+    
+    return [self requestWithURN:URN data:data];
+}
+
+
+#pragma mark - Recording
+
+// The request is built by the live server, including the parameters for the response schema, but 
+// sent here, so that the response body is recorded exactly as it arrived rather than as the object it
+// was decoded into.  Requests are sent from an operation queue so that their priority decides which
+// of the waiting requests is sent next.
++ (void)recordRequestWithURN:(NSString *)URN
+                        data:(NSDictionary *)data
+                      domain:(id)domain
+                    priority:(MMRecordRequestPriority)priority
+              responseSchema:(MMServerResponseSchema *)responseSchema
+               responseBlock:(void (^)(id responseObject))responseBlock
+                failureBlock:(void (^)(NSError *error))failureBlock {
+    NSURLRequest *URLRequest = [MM_liveServerClass requestWithURN:URN data:data responseSchema:responseSchema];
+    
+    if (URLRequest == nil) {
+        MMRLogError(@"MMReplayServer needs a live server class to record requests for URN: %@", URN);
+        
+        [self deliverError:[NSError errorWithDomain:MMReplayServerErrorDomain
+                                               code:MMReplayServerErrorCodeMissingLiveServer
+                                           userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithFormat:@"No live server for URN: %@", URN]}]
+              failureBlock:failureBlock];
+        
+        return;
+    }
+    
+    MMReplayServerRequest *request = [[MMReplayServerRequest alloc] init];
+    [self registerRequest:request forDomain:domain];
+    
+    __weak id weakDomain = domain;
+    
+    NSBlockOperation *operation = [NSBlockOperation blockOperationWithBlock:^{
+        if ([request isCancelled]) {
+            [self unregisterRequest:request forDomain:weakDomain];
+            [self deliverError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil]
+                  failureBlock:failureBlock];
+            
+            return;
+        }
+        
+        CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+        NSURLResponse *response = nil;
+        NSError *connectionError = nil;
+        NSData *responseData = [NSURLConnection sendSynchronousRequest:URLRequest
+                                                     returningResponse:&response
+                                                                 error:&connectionError];
+        NSTimeInterval latency = CFAbsoluteTimeGetCurrent() - startTime;
+        
+        [self unregisterRequest:request forDomain:weakDomain];
+        
+        if ([request isCancelled]) {
+            [self deliverError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil]
+                  failureBlock:failureBlock];
+            
+            return;
+        }
+        
+        if (responseData == nil) {
+            connectionError = connectionError ?: [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorUnknown userInfo:nil];
+            NSDictionary *errorEntry = @{@"domain": [connectionError domain] ?: @"", @"code": @([connectionError code])};
+            
+            [self recordEntry:@{@"latency": @(latency), @"error": errorEntry}
+                         body:nil
+                       forURN:URN
+                         data:data];
+            
+            [self deliverError:connectionError failureBlock:failureBlock];
+            
+            return;
+        }
+         
+        NSInteger statusCode = 200;
+        
+        if ([response isKindOfClass:[NSHTTPURLResponse class]]) {
+            statusCode = [(NSHTTPURLResponse *)response statusCode];
+        }
+        
+        [self recordEntry:@{@"latency": @(latency),
+                            @"status": @(statusCode),
+                            @"MIMEType": [response MIMEType] ?: @""}
+                     body:responseData
+                   forURN:URN
+                     data:data];
+        
+        [self deliverResponseData:responseData
+                         MIMEType:[response MIMEType]
+                       statusCode:statusCode
+                              URN:URN
+                   responseSchema:responseSchema
+                    responseBlock:responseBlock
+                     failureBlock:failureBlock];
+    }];
+    
+    [operation setQueuePriority:[self queuePriorityForRequestPriority:priority]];
+    
+    [[self recordingOperationQueue] addOperation:operation];
+}
+
++ (NSOperationQueuePriority)queuePriorityForRequestPriority:(MMRecordRequestPriority)priority {
+    switch (priority) {
+        case MMRecordRequestPriorityUserInitiated:
+            return NSOperationQueuePriorityHigh;
+        case MMRecordRequestPriorityBackground:
+            return NSOperationQueuePriorityLow;
+        default:
+            return NSOperationQueuePriorityNormal;
+    }
+}
+
+// The body is written to its own file next to the recording, and its file name and length are added
+// to the entry.
++ (void)recordEntry:(NSDictionary *)entry body:(NSData *)body forURN:(NSString *)URN data:(NSDictionary *)data {
+    dispatch_async([self recordingQueue], ^{
+        NSString *key = [self recordingKeyForURN:URN data:data];
+        NSMutableArray *entries = [[self recordedEntriesForKey:key] mutableCopy] ?: [NSMutableArray array];
+        NSMutableDictionary *recordedEntry = [entry mutableCopy];
+        
+        if (body != nil) {
+            NSString *bodyFileName = [NSString stringWithFormat:@"%@.%lu.body", key, (unsigned long)[entries count]];
+            
+            if ([body writeToURL:[MM_recordingDirectoryURL URLByAppendingPathComponent:bodyFileName] atomically:YES] == NO) {
+                MMRLogError(@"MMReplayServer is unable to record the response body for URN: %@", URN);
+                return;
+            }
+            
+            [recordedEntry setObject:bodyFileName forKey:@"body"];
+            [recordedEntry setObject:@([body length]) forKey:@"length"];
+        }
+        
+        [entries addObject:recordedEntry];
+        
+        NSDictionary *recording = @{@"URN": URN ?: @"",
+                                    @"parameters": data ?: [NSNull null],
+                                    @"responses": entries};
+        
+        NSData *recordingData = [NSJSONSerialization dataWithJSONObject:recording options:0 error:NULL];
+        [recordingData writeToURL:[self recordingURLForKey:key] atomically:YES];
+        
+        @synchronized([MMReplayServer class]) {
+            [MM_recordings setObject:entries forKey:key];
+        }
+    });
+}
+
++ (dispatch_queue_t)recordingQueue {
+    static dispatch_queue_t _recording_queue = nil;
+    static dispatch_once_t oncePredicate;
+    dispatch_once(&oncePredicate, ^{
+        _recording_queue = dispatch_queue_create("com.mutualmobile.mmreplayserver", NULL);
+    });
+    
+    return _recording_queue;
+}
+
++ (NSOperationQueue *)recordingOperationQueue {
+    static NSOperationQueue *_recording_operation_queue = nil;
+    static dispatch_once_t oncePredicate;
+    dispatch_once(&oncePredicate, ^{
+        _recording_operation_queue = [[NSOperationQueue alloc] init];
+        _recording_operation_queue.maxConcurrentOperationCount = 4;
+    });
+    
+    return _recording_operation_queue;
+}
+
+
+#pragma mark - Replaying
+
++ (void)replayRequestWithURN:(NSString *)URN
+                        data:(NSDictionary *)data
+                      domain:(id)domain
+                    priority:(MMRecordRequestPriority)priority
+              responseSchema:(MMServerResponseSchema *)responseSchema
+               responseBlock:(void (^)(id responseObject))responseBlock
+                failureBlock:(void (^)(NSError *error))failureBlock {
+    MMReplayServerRequest *request = [[MMReplayServerRequest alloc] init];
+    [self registerRequest:request forDomain:domain];
+    
+    __weak id weakDomain = domain;
+    MMReplayServerLatencyModel *latencyModel = MM_latencyModel;
+    
+    // The response and its delay are chosen in the order that requests are started, so that the
+    // same sequence of requests always replays the same way.
+    NSDictionary *entry = [self nextEntryForURN:URN data:data];
+    
+    NSError *error = nil;
+    
+    if (entry == nil) {
+        error = [NSError errorWithDomain:MMReplayServerErrorDomain
+                                    code:MMReplayServerErrorCodeMissingRecording
+                                userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithFormat:@"No recording for URN: %@", URN]}];
+    } else if ([latencyModel shouldFailRequest]) {
+        error = [NSError errorWithDomain:MMReplayServerErrorDomain
+                                    code:MMReplayServerErrorCodeInjectedFailure
+                                userInfo:nil];
+    } else if ([entry objectForKey:@"error"] != nil) {
+        NSDictionary *errorEntry = [entry objectForKey:@"error"];
+        error = [NSError errorWithDomain:[errorEntry objectForKey:@"domain"]
+                                    code:[[errorEntry objectForKey:@"code"] integerValue]
+                                userInfo:nil];
+    }
+    
+    NSTimeInterval delay = 0;
+    
+    if (latencyModel != nil && entry != nil) {
+        delay = [latencyModel delayForResponseWithLength:[[entry objectForKey:@"length"] unsignedIntegerValue]
+                                         recordedLatency:[[entry objectForKey:@"latency"] doubleValue]];
+    }
+    
+    dispatch_time_t deliveryTime = dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC));
+    dispatch_after(deliveryTime, [self decodingQueueForRequestPriority:priority], ^{
+        [self unregisterRequest:request forDomain:weakDomain];
+        
+        if ([request isCancelled]) {
+            [self deliverError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil]
+                  failureBlock:failureBlock];
+        } else if (error != nil) {
+            [self deliverError:error failureBlock:failureBlock];
+        } else {
+            NSString *bodyFileName = [entry objectForKey:@"body"];
+            NSData *body = nil;
+            
+            if (bodyFileName != nil) {
+                body = [NSData dataWithContentsOfURL:[MM_recordingDirectoryURL URLByAppendingPathComponent:bodyFileName]];
+            }
+            
+            [self deliverResponseData:body
+                             MIMEType:[entry objectForKey:@"MIMEType"]
+                           statusCode:[[entry objectForKey:@"status"] integerValue]
+                                  URN:URN
+                       responseSchema:responseSchema
+                        responseBlock:responseBlock
+                         failureBlock:failureBlock];
+        }
+    });
+}
+
+// Replayed bodies are decoded on a global queue that matches the priority of their request.
++ (dispatch_queue_t)decodingQueueForRequestPriority:(MMRecordRequestPriority)priority {
+    switch (priority) {
+        case MMRecordRequestPriorityUserInitiated:
+            return dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0);
+        case MMRecordRequestPriorityBackground:
+            return dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0);
+        default:
+            return dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    }
+}
+
+// Recorded bodies are decoded by the decoder registered for their MIME type, the same way a live
+// server decodes them, so that replaying includes the cost of decoding.  The response and failure 
+// blocks are then called on the main queue, as they are by MMJSONServer and MMAFJSONServer.
++ (void)deliverResponseData:(NSData *)responseData
+                   MIMEType:(NSString *)MIMEType
+                 statusCode:(NSInteger)statusCode
+                        URN:(NSString *)URN
+             responseSchema:(MMServerResponseSchema *)responseSchema
+              responseBlock:(void (^)(id responseObject))responseBlock
+               failureBlock:(void (^)(NSError *error))failureBlock {
+    NSError *error = nil;
+    id responseObject = nil;
+    
+    if (statusCode < 200 || statusCode >= 300) {
+        error = [NSError errorWithDomain:MMReplayServerErrorDomain
+                                    code:MMReplayServerErrorCodeUnacceptableStatusCode
+                                userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Status code %ld for URN: %@", (long)statusCode, URN]}];
+    } else {
+        responseObject = [self responseObjectWithData:responseData
+                                          contentType:MIMEType
+                                               schema:responseSchema
+                                                error:&error];
+    }
+    
+    if (error != nil) {
+        [self deliverError:error failureBlock:failureBlock];
+    } else {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (responseBlock != nil) {
+                responseBlock(responseObject);
+            }
+        });
+    }
+}
+
++ (void)deliverError:(NSError *)error failureBlock:(void (^)(NSError *error))failureBlock {
+    dispatch_async(dispatch_get_main_queue(), ^{
+        if (failureBlock != nil) {
+            failureBlock(error);
+        }
+    });
+}
+
++ (NSDictionary *)nextEntryForURN:(NSString *)URN data:(NSDictionary *)data {
+    NSString *key = [self recordingKeyForURN:URN data:data];
+    NSArray *entries = [self recordedEntriesForKey:key];
+    
+    if ([entries count] == 0) {
+        return nil;
+    }
+    
+    @synchronized([MMReplayServer class]) {
+        if (MM_replayPositions == nil) {
+            MM_replayPositions = [NSMutableDictionary dictionary];
+        }
+        
+        NSUInteger position = [[MM_replayPositions objectForKey:key] unsignedIntegerValue];
+        [MM_replayPositions setObject:@(position + 1) forKey:key];
+        
+        return [entries objectAtIndex:position % [entries count]];
+    }
+}
+
+
+#pragma mark - Recording Storage
+
++ (NSString *)recordingKeyForURN:(NSString *)URN data:(NSDictionary *)data {
+    return [MMRecordCache fingerprintForResponseObject:@{@"URN": URN ?: @"", @"parameters": data ?: [NSNull null]}];
+}
+
++ (NSURL *)recordingURLForKey:(NSString *)key {
+    return [MM_recordingDirectoryURL URLByAppendingPathComponent:[key stringByAppendingPathExtension:@"json"]];
+}
+
++ (NSArray *)recordedEntriesForKey:(NSString *)key {
+    @synchronized([MMReplayServer class]) {
+        if (MM_recordings == nil) {
+            MM_recordings = [NSMutableDictionary dictionary];
+        }
+        
+        NSArray *entries = [MM_recordings objectForKey:key];
+        
+        if (entries == nil) {
+            NSData *recordingData = [NSData dataWithContentsOfURL:[self recordingURLForKey:key]];
+            NSDictionary *recording = nil;
+            
+            if (recordingData != nil) {
+                recording = [NSJSONSerialization JSONObjectWithData:recordingData options:0 error:NULL];
+            }
+            
+            entries = [recording objectForKey:@"responses"] ?: @[];
+            [MM_recordings setObject:entries forKey:key];
+        }
+        
+        return entries;
+    }
+}
+
+@end
+
+
+#pragma mark - MMReplayServerRequest
+
+@implementation MMReplayServerRequest
+
+- (void)cancel {
+    self.cancelled = YES;
+}
+
+@end
+
+
+#pragma mark - MMReplayServerLatencyModel
+
+@implementation MMReplayServerLatencyModel {
+    uint64_t _state;
+}
+
++ (instancetype)latencyModelWithSeed:(uint64_t)seed {
+    MMReplayServerLatencyModel *latencyModel = [[self alloc] init];
+    latencyModel.seed = seed;
+    return latencyModel;
+}
+
+- (void)setSeed:(uint64_t)seed {
+    @synchronized(self) {
+        _seed = seed;
+        _state = seed;
+    }
+}
+
+- (void)reset {
+    @synchronized(self) {
+        _state = _seed;
+    }
+}
+
+// SplitMix64, which is small, fast and produces the same sequence on every platform.
+- (uint64_t)nextRandomValue {
+    @synchronized(self) {
+        uint64_t z = (_state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+}
+
+// Returns a uniformly distributed value in the interval (0, 1).
+- (double)nextUniformValue {
+    return ((double)([self nextRandomValue] >> 11) + 0.5) / (double)(1ULL << 53);
+}
+
+// Returns a standard normally distributed value using the Box-Muller transform.
+- (double)nextNormalValue {
+    double u1 = [self nextUniformValue];
+    double u2 = [self nextUniformValue];
+    
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+- (NSTimeInterval)delayForResponseWithLength:(NSUInteger)length recordedLatency:(NSTimeInterval)recordedLatency {
+    NSTimeInterval latency = 0;
+    
+    if (self.usesRecordedLatency) {
+        latency = recordedLatency;
+    } else if (self.medianLatency > 0) {
+        latency = self.medianLatency * exp(self.latencyDeviation * [self nextNormalValue]);
+    }
+    
+    if (self.jitter > 0) {
+        latency += self.jitter * (2.0 * [self nextUniformValue] - 1.0);
+    }
+    
+    if (self.bandwidth > 0) {
+        latency += length / self.bandwidth;
+    }
+    
+    return MAX(latency, 0);
+}
+
+- (BOOL)shouldFailRequest {
+    if (self.failureRate <= 0) {
+        return NO;
+    }
+    
+    return [self nextUniformValue] < self.failureRate;
+}
+
+@end
@@ -0,0 +1,47 @@
+// MMSIMDJSONDecoder.h
+//
+// Copyright (c) 2013 Mutual Mobile (http://www.mutualmobile.com/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "MMServer.h"
+
+/**
+ `MMSIMDJSONDecoder` decodes JSON response bodies into the same structures that 
+ NSJSONSerialization produces, using vector instructions to find the structure of the document.  
+ Register it with MMServer to use it in place of the built in JSON decoder.
+ 
+ ## Decoding
+ 
+ Decoding is done in two passes.  The first pass reads the body 64 bytes at a time with SSE2 or NEON
+ instructions, or with portable scalar code on other architectures, and builds an index of the 
+ positions of every bracket, brace, colon, comma and unescaped quote that is not inside a string.  
+ It also notes whether the body contains any non-ASCII bytes.  The second pass walks that index to 
+ create the dictionaries, arrays, strings and numbers, without examining the bytes between 
+ structural characters.  Strings in ASCII bodies are created without UTF-8 decoding.
+ 
+ When MMRecord passes a response schema, values that the schema does not include are skipped by 
+ jumping over their entries in the index.
+ 
+ Errors are reported in the NSCocoaErrorDomain with the same code that NSJSONSerialization uses.  
+ Bodies that are not UTF-8 encoded are passed to NSJSONSerialization.
+ */
+@interface MMSIMDJSONDecoder : NSObject <MMServerResponseDecoder>
+
+@end
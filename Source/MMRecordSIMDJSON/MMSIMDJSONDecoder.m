@@ -0,0 +1,810 @@
+// MMSIMDJSONDecoder.m
+//
+// Copyright (c) 2013 Mutual Mobile (http://www.mutualmobile.com/)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "MMSIMDJSONDecoder.h"
+
+#include <string.h>
+#include <xlocale.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MMSIMDJSON_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define MMSIMDJSON_SSE2 1
+#endif
+
+// Response bodies nested deeper than this are rejected rather than risking a stack overflow.
+static const NSUInteger MMSIMDJSONMaximumDepth = 512;
+
+static const uint64_t MMSIMDJSONEvenBits = 0x5555555555555555ULL;
+
+// The classification of one 64 byte block of a body.  Bit n of each mask describes byte n of the block.
+typedef struct {
+    uint64_t backslashes;
+    uint64_t quotes;
+    uint64_t operators;
+    uint64_t controlCharacters;
+    uint64_t nonASCII;
+} MMSIMDJSONBlock;
+
+// The positions of the structural characters in a body, in order.
+typedef struct {
+    uint32_t *offsets;
+    NSUInteger count;
+    NSUInteger capacity;
+    BOOL ASCII;
+} MMSIMDJSONIndex;
+
+// The state of the second pass.  The position is the next entry in the index, and the offset is the
+// first byte after the last value or structural character that has been read.
+typedef struct {
+    const uint8_t *bytes;
+    NSUInteger length;
+    const uint32_t *offsets;
+    NSUInteger count;
+    NSUInteger position;
+    NSUInteger offset;
+    BOOL ASCII;
+} MMSIMDJSONTape;
+
+
+#pragma mark - Classifying Blocks
+
+#if MMSIMDJSON_NEON
+
+static inline uint16_t MMSIMDJSONMoveMask(uint8x16_t input) {
+    static const uint8_t bitWeights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    
+    uint8x16_t masked = vandq_u8(input, vld1q_u8(bitWeights));
+    uint8x8_t sum = vpadd_u8(vget_low_u8(masked), vget_high_u8(masked));
+    sum = vpadd_u8(sum, sum);
+    sum = vpadd_u8(sum, sum);
+    
+    return vget_lane_u16(vreinterpret_u16_u8(sum), 0);
+}
+
+static void MMSIMDJSONClassifyBlock(const uint8_t *bytes, MMSIMDJSONBlock *block) {
+    memset(block, 0, sizeof(*block));
+    
+    for (NSUInteger i = 0; i < 4; i++) {
+        uint8x16_t chunk = vld1q_u8(bytes + i * 16);
+        uint8x16_t folded = vorrq_u8(chunk, vdupq_n_u8(0x20));
+        uint8x16_t operators = vorrq_u8(vorrq_u8(vceqq_u8(folded, vdupq_n_u8('{')), vceqq_u8(folded, vdupq_n_u8('}'))),
+                                        vorrq_u8(vceqq_u8(chunk, vdupq_n_u8(':')), vceqq_u8(chunk, vdupq_n_u8(','))));
+        NSUInteger shift = i * 16;
+        
+        block->backslashes |= (uint64_t)MMSIMDJSONMoveMask(vceqq_u8(chunk, vdupq_n_u8('\\'))) << shift;
+        block->quotes |= (uint64_t)MMSIMDJSONMoveMask(vceqq_u8(chunk, vdupq_n_u8('"'))) << shift;
+        block->operators |= (uint64_t)MMSIMDJSONMoveMask(operators) << shift;
+        block->controlCharacters |= (uint64_t)MMSIMDJSONMoveMask(vcltq_u8(chunk, vdupq_n_u8(0x20))) << shift;
+        block->nonASCII |= (uint64_t)MMSIMDJSONMoveMask(vcgeq_u8(chunk, vdupq_n_u8(0x80))) << shift;
+    }
+}
+
+#elif MMSIMDJSON_SSE2
+
+static void MMSIMDJSONClassifyBlock(const uint8_t *bytes, MMSIMDJSONBlock *block) {
+    memset(block, 0, sizeof(*block));
+    
+    for (NSUInteger i = 0; i < 4; i++) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(bytes + i * 16));
+        __m128i folded = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+        __m128i operators = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')), _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+                                         _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(':')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8(','))));
+        
+        // SSE2 has no unsigned comparison, but a byte is below 0x20 when its unsigned maximum with 0x1f is 0x1f.
+        __m128i controlCharacters = _mm_cmpeq_epi8(_mm_max_epu8(chunk, _mm_set1_epi8(0x1f)), _mm_set1_epi8(0x1f));
+        NSUInteger shift = i * 16;
+        
+        block->backslashes |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'))) << shift;
+        block->quotes |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"'))) << shift;
+        block->operators |= (uint64_t)(uint16_t)_mm_movemask_epi8(operators) << shift;
+        block->controlCharacters |= (uint64_t)(uint16_t)_mm_movemask_epi8(controlCharacters) << shift;
+        block->nonASCII |= (uint64_t)(uint16_t)_mm_movemask_epi8(chunk) << shift;
+    }
+}
+
+#else
+
+static void MMSIMDJSONClassifyBlock(const uint8_t *bytes, MMSIMDJSONBlock *block) {
+    memset(block, 0, sizeof(*block));
+    
+    for (NSUInteger i = 0; i < 64; i++) {
+        uint8_t character = bytes[i];
+        uint64_t bit = 1ULL << i;
+        
+        if (character == '\\') {
+            block->backslashes |= bit;
+        } else if (character == '"') {
+            block->quotes |= bit;
+        } else if (character == '{' || character == '}' || character == '[' || character == ']' ||
+                   character == ':' || character == ',') {
+            block->operators |= bit;
+        } else if (character < 0x20) {
+            block->controlCharacters |= bit;
+        } else if (character >= 0x80) {
+            block->nonASCII |= bit;
+        }
+    }
+}
+
+#endif
+
+
+#pragma mark - Building the Index
+
+// Returns the characters that are escaped by a backslash, carrying a trailing odd run of backslashes
+// over to the next block.  Runs of backslashes are matched in pairs, so only the character after an
+// odd length run is escaped.
+static inline uint64_t MMSIMDJSONEscapedCharacters(uint64_t backslashes, uint64_t *previousEscaped) {
+    backslashes &= ~*previousEscaped;
+    
+    uint64_t followsEscape = (backslashes << 1) | *previousEscaped;
+    uint64_t oddSequenceStarts = backslashes & ~MMSIMDJSONEvenBits & ~followsEscape;
+    uint64_t sequencesStartingOnEvenBits = oddSequenceStarts + backslashes;
+    
+    *previousEscaped = (sequencesStartingOnEvenBits < backslashes) ? 1 : 0;
+    
+    return (MMSIMDJSONEvenBits ^ (sequencesStartingOnEvenBits << 1)) & followsEscape;
+}
+
+// Sets every bit from each quote up to, but not including, the next quote.
+static inline uint64_t MMSIMDJSONPrefixXOR(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    
+    return bits;
+}
+
+static BOOL MMSIMDJSONReserveIndexCapacity(MMSIMDJSONIndex *index, NSUInteger capacity) {
+    if (capacity <= index->capacity) {
+        return YES;
+    }
+    
+    NSUInteger newCapacity = MAX(capacity, index->capacity * 2);
+    uint32_t *offsets = realloc(index->offsets, newCapacity * sizeof(uint32_t));
+    
+    if (offsets == NULL) {
+        return NO;
+    }
+    
+    index->offsets = offsets;
+    index->capacity = newCapacity;
+    
+    return YES;
+}
+
+// Returns NO if a string is not terminated or contains an unescaped control character.
+static BOOL MMSIMDJSONBuildIndex(const uint8_t *bytes, NSUInteger length, MMSIMDJSONIndex *index) {
+    uint64_t previousEscaped = 0;
+    uint64_t previousInString = 0;
+    uint64_t nonASCII = 0;
+    uint64_t invalidCharacters = 0;
+    
+    if (MMSIMDJSONReserveIndexCapacity(index, length / 8 + 64) == NO) {
+        return NO;
+    }
+    
+    for (NSUInteger blockOffset = 0; blockOffset < length; blockOffset += 64) {
+        const uint8_t *blockBytes = bytes + blockOffset;
+        uint8_t paddedBytes[64];
+        
+        // The last block is padded with whitespace so that it can be classified like the others.
+        if (length - blockOffset < 64) {
+            memset(paddedBytes, ' ', sizeof(paddedBytes));
+            memcpy(paddedBytes, blockBytes, length - blockOffset);
+            blockBytes = paddedBytes;
+        }
+        
+        MMSIMDJSONBlock block;
+        MMSIMDJSONClassifyBlock(blockBytes, &block);
+        
+        uint64_t escaped = MMSIMDJSONEscapedCharacters(block.backslashes, &previousEscaped);
+        uint64_t quotes = block.quotes & ~escaped;
+        uint64_t inString = MMSIMDJSONPrefixXOR(quotes) ^ previousInString;
+        
+        previousInString = (uint64_t)((int64_t)inString >> 63);
+        invalidCharacters |= block.controlCharacters & inString;
+        nonASCII |= block.nonASCII;
+        
+        uint64_t structurals = (block.operators & ~inString) | quotes;
+        
+        if (MMSIMDJSONReserveIndexCapacity(index, index->count + 64) == NO) {
+            return NO;
+        }
+        
+        while (structurals != 0) {
+            index->offsets[index->count++] = (uint32_t)(blockOffset + __builtin_ctzll(structurals));
+            structurals &= structurals - 1;
+        }
+    }
+    
+    index->ASCII = (nonASCII == 0);
+    
+    return (previousInString == 0 && invalidCharacters == 0);
+}
+
+// Checks the bytes against the JSON number grammar without converting them.
+static BOOL MMSIMDJSONIsNumber(const uint8_t *bytes, NSUInteger length, BOOL *integral) {
+    NSUInteger offset = 0;
+    *integral = YES;
+    
+    if (offset < length && bytes[offset] == '-') {
+        offset++;
+    }
+    
+    if (offset < length && bytes[offset] == '0') {
+        offset++;
+    } else if (offset < length && bytes[offset] >= '1' && bytes[offset] <= '9') {
+        while (offset < length && isdigit(bytes[offset])) {
+            offset++;
+        }
+    } else {
+        return NO;
+    }
+    
+    if (offset < length && bytes[offset] == '.') {
+        *integral = NO;
+        offset++;
+        
+        if (offset >= length || isdigit(bytes[offset]) == NO) {
+            return NO;
+        }
+        
+        while (offset < length && isdigit(bytes[offset])) {
+            offset++;
+        }
+    }
+    
+    if (offset < length && (bytes[offset] == 'e' || bytes[offset] == 'E')) {
+        *integral = NO;
+        offset++;
+        
+        if (offset < length && (bytes[offset] == '+' || bytes[offset] == '-')) {
+            offset++;
+        }
+        
+        if (offset >= length || isdigit(bytes[offset]) == NO) {
+            return NO;
+        }
+        
+        while (offset < length && isdigit(bytes[offset])) {
+            offset++;
+        }
+    }
+    
+    return (offset == length);
+}
+
+static BOOL MMSIMDJSONIsScalar(const uint8_t *bytes, NSUInteger length) {
+    BOOL integral = YES;
+    
+    return ((length == 4 && memcmp(bytes, "true", 4) == 0) ||
+            (length == 5 && memcmp(bytes, "false", 5) == 0) ||
+            (length == 4 && memcmp(bytes, "null", 4) == 0) ||
+            MMSIMDJSONIsNumber(bytes, length, &integral));
+}
+
+static inline BOOL MMSIMDJSONIsWhitespace(uint8_t character) {
+    return (character == ' ' || character == '\t' || character == '\n' || character == '\r');
+}
+
+
+#pragma mark - MMSIMDJSONDecoder
+
+@implementation MMSIMDJSONDecoder
+
++ (NSArray *)contentTypes {
+    return @[@"application/json", @"text/json", @"text/javascript"];
+}
+
++ (id)responseObjectWithData:(NSData *)data error:(NSError **)error {
+    return [self responseObjectWithData:data schema:nil error:error];
+}
+
++ (id)responseObjectWithData:(NSData *)data schema:(MMServerResponseSchema *)schema error:(NSError **)error {
+    const uint8_t *bytes = [data bytes];
+    NSUInteger length = [data length];
+    
+    // NSJSONSerialization accepts a UTF-8 byte order mark, so it is skipped rather than rejected.
+    if (length >= 3 && bytes[0] == 0xEF && bytes[1] == 0xBB && bytes[2] == 0xBF) {
+        bytes += 3;
+        length -= 3;
+    }
+    
+    // UTF-16 and UTF-32 bodies have a zero byte in their first four bytes.
+    if (length == 0 || length >= UINT32_MAX || memchr(bytes, 0, MIN(length, 4)) != NULL) {
+        return [NSJSONSerialization JSONObjectWithData:data options:0 error:error];
+    }
+    
+    MMSIMDJSONIndex index = { NULL, 0, 0, NO };
+    id object = nil;
+    
+    if (MMSIMDJSONBuildIndex(bytes, length, &index)) {
+        MMSIMDJSONTape tape = { bytes, length, index.offsets, index.count, 0, 0, index.ASCII };
+        uint8_t structural = [self nextStructuralWithTape:&tape];
+        
+        if (structural == '{' || structural == '[') {
+            object = [self valueWithTape:&tape schema:schema depth:0 error:error];
+        } else {
+            [self invalidDataWithTape:&tape error:error];
+        }
+        
+        if (object != nil && [self isAtEndWithTape:&tape] == NO) {
+            object = [self invalidDataWithTape:&tape error:error];
+        }
+    } else {
+        [self invalidDataWithTape:NULL error:error];
+    }
+    
+    free(index.offsets);
+    
+    return object;
+}
+
+
+#pragma mark - Decoding Values
+
+// A nil schema means that the value is decoded in full.
++ (id)valueWithTape:(MMSIMDJSONTape *)tape
+             schema:(MMServerResponseSchema *)schema
+              depth:(NSUInteger)depth
+              error:(NSError **)error {
+    NSUInteger offset = [self offsetAfterWhitespaceWithTape:tape];
+    
+    if (offset >= tape->length) {
+        return [self invalidDataWithTape:tape error:error];
+    }
+    
+    switch (tape->bytes[offset]) {
+        case '{':
+        case '[':
+        case '"':
+            break;
+        default:
+            return [self scalarWithTape:tape offset:offset error:error];
+    }
+    
+    uint8_t structural = [self nextStructuralWithTape:tape];
+    
+    if (structural == '{') {
+        return [self dictionaryWithTape:tape schema:schema depth:depth error:error];
+    } else if (structural == '[') {
+        return [self arrayWithTape:tape schema:schema depth:depth error:error];
+    } else if (structural == '"') {
+        return [self stringWithTape:tape error:error];
+    }
+    
+    return [self invalidDataWithTape:tape error:error];
+}
+
++ (id)dictionaryWithTape:(MMSIMDJSONTape *)tape
+                  schema:(MMServerResponseSchema *)schema
+                   depth:(NSUInteger)depth
+                   error:(NSError **)error {
+    if (depth >= MMSIMDJSONMaximumDepth) {
+        return [self invalidDataWithTape:tape error:error];
+    }
+    
+    NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
+    
+    [self consumeStructuralWithTape:tape];
+    
+    if ([self nextStructuralWithTape:tape] == '}') {
+        [self consumeStructuralWithTape:tape];
+        return dictionary;
+    }
+    
+    while (YES) {
+        if ([self nextStructuralWithTape:tape] != '"') {
+            return [self invalidDataWithTape:tape error:error];
+        }
+        
+        BOOL includesValue = YES;
+        MMServerResponseSchema *childSchema = nil;
+        NSString *key = nil;
+        
+        if (schema == nil) {
+            key = [self stringWithTape:tape error:error];
+        } else {
+            key = [self keyWithTape:tape schema:schema includesValue:&includesValue childSchema:&childSchema error:error];
+        }
+        
+        if (key == nil) {
+            return nil;
+        }
+        
+        if ([self nextStructuralWithTape:tape] != ':') {
+            return [self invalidDataWithTape:tape error:error];
+        }
+        
+        [self consumeStructuralWithTape:tape];
+        
+        if (includesValue) {
+            id value = [self valueWithTape:tape schema:childSchema depth:depth + 1 error:error];
+            
+            if (value == nil) {
+                return nil;
+            }
+            
+            [dictionary setObject:value forKey:key];
+        } else if ([self skipValueWithTape:tape] == NO) {
+            return [self invalidDataWithTape:tape error:error];
+        }
+        
+        uint8_t separator = [self nextStructuralWithTape:tape];
+        
+        if (separator != ',' && separator != '}') {
+            return [self invalidDataWithTape:tape error:error];
+        }
+        
+        [self consumeStructuralWithTape:tape];
+        
+        if (separator == '}') {
+            return dictionary;
+        }
+    }
+}
+
++ (id)arrayWithTape:(MMSIMDJSONTape *)tape
+             schema:(MMServerResponseSchema *)schema
+              depth:(NSUInteger)depth
+              error:(NSError **)error {
+    if (depth >= MMSIMDJSONMaximumDepth) {
+        return [self invalidDataWithTape:tape error:error];
+    }
+    
+    NSMutableArray *array = [NSMutableArray array];
+    
+    [self consumeStructuralWithTape:tape];
+    
+    if ([self nextStructuralWithTape:tape] == ']') {
+        [self consumeStructuralWithTape:tape];
+        return array;
+    }
+    
+    while (YES) {
+        id value = [self valueWithTape:tape schema:schema depth:depth + 1 error:error];
+        
+        if (value == nil) {
+            return nil;
+        }
+        
+        [array addObject:value];
+        
+        uint8_t separator = [self nextStructuralWithTape:tape];
+        
+        if (separator != ',' && separator != ']') {
+            return [self invalidDataWithTape:tape error:error];
+        }
+        
+        [self consumeStructuralWithTape:tape];
+        
+        if (separator == ']') {
+            return array;
+        }
+    }
+}
+
+// The index contains both quotes of every string, so the closing quote is always the next entry.
++ (id)stringWithTape:(MMSIMDJSONTape *)tape error:(NSError **)error {
+    if (tape->position + 1 >= tape->count) {
+        return [self invalidDataWithTape:tape error:error];
+    }
+    
+    NSUInteger start = tape->offsets[tape->position] + 1;
+    NSUInteger end = tape->offsets[tape->position + 1];
+    NSString *string = nil;
+    
+    if (memchr(tape->bytes + start, '\\', end - start) == NULL) {
+        string = [[NSString alloc] initWithBytes:tape->bytes + start
+                                          length:end - start
+                                        encoding:(tape->ASCII ? NSASCIIStringEncoding : NSUTF8StringEncoding)];
+    } else {
+        // Escape sequences are rare enough that they are left to NSJSONSerialization.
+        NSData *stringData = [NSData dataWithBytesNoCopy:(void *)(tape->bytes + start - 1)
+                                                  length:end - start + 2
+                                            freeWhenDone:NO];
+        string = [NSJSONSerialization JSONObjectWithData:stringData options:NSJSONReadingAllowFragments error:NULL];
+    }
+    
+    if ([string isKindOfClass:[NSString class]] == NO) {
+        return [self invalidDataWithTape:tape error:error];
+    }
+    
+    tape->position += 2;
+    tape->offset = end + 1;
+    
+    return string;
+}
+
+// Looks up a key in the schema without copying its bytes, so that keys whose values are skipped do
+// not allocate any storage for their characters.  Only keys that are kept are copied.
++ (NSString *)keyWithTape:(MMSIMDJSONTape *)tape
+                   schema:(MMServerResponseSchema *)schema
+            includesValue:(BOOL *)includesValue
+              childSchema:(MMServerResponseSchema **)childSchema
+                    error:(NSError **)error {
+    if (tape->position + 1 >= tape->count) {
+        return [self invalidDataWithTape:tape error:error];
+    }
+    
+    NSUInteger start = tape->offsets[tape->position] + 1;
+    NSUInteger end = tape->offsets[tape->position + 1];
+    
+    if (memchr(tape->bytes + start, '\\', end - start) != NULL) {
+        NSString *key = [self stringWithTape:tape error:error];
+        
+        if (key != nil) {
+            *includesValue = [schema includesKey:key schema:childSchema];
+        }
+        
+        return key;
+    }
+    
+    NSStringEncoding encoding = (tape->ASCII ? NSASCIIStringEncoding : NSUTF8StringEncoding);
+    NSString *key = [[NSString alloc] initWithBytesNoCopy:(void *)(tape->bytes + start)
+                                                   length:end - start
+                                                 encoding:encoding
+                                             freeWhenDone:NO];
+    
+    if (key == nil) {
+        return [self invalidDataWithTape:tape error:error];
+    }
+    
+    *includesValue = [schema includesKey:key schema:childSchema];
+    
+    if (*includesValue) {
+        key = [[NSString alloc] initWithBytes:tape->bytes + start length:end - start encoding:encoding];
+    }
+    
+    tape->position += 2;
+    tape->offset = end + 1;
+    
+    return key;
+}
+
+// Numbers and literals are not in the index, so a scalar runs from its first byte up to the next
+// structural character, less any trailing whitespace.
++ (id)scalarWithTape:(MMSIMDJSONTape *)tape offset:(NSUInteger)offset error:(NSError **)error {
+    NSUInteger end = (tape->position < tape->count) ? tape->offsets[tape->position] : tape->length;
+    
+    while (end > offset && MMSIMDJSONIsWhitespace(tape->bytes[end - 1])) {
+        end--;
+    }
+    
+    const uint8_t *bytes = tape->bytes + offset;
+    NSUInteger length = end - offset;
+    id value = nil;
+    
+    if (length == 4 && memcmp(bytes, "true", 4) == 0) {
+        value = [NSNumber numberWithBool:YES];
+    } else if (length == 5 && memcmp(bytes, "false", 5) == 0) {
+        value = [NSNumber numberWithBool:NO];
+    } else if (length == 4 && memcmp(bytes, "null", 4) == 0) {
+        value = [NSNull null];
+    } else {
+        value = [self numberWithBytes:bytes length:length];
+    }
+    
+    if (value == nil) {
+        tape->offset = offset;
+        return [self invalidDataWithTape:tape error:error];
+    }
+    
+    tape->offset = end;
+    
+    return value;
+}
+
++ (NSNumber *)numberWithBytes:(const uint8_t *)bytes length:(NSUInteger)length {
+    BOOL integral = YES;
+    
+    if (MMSIMDJSONIsNumber(bytes, length, &integral) == NO) {
+        return nil;
+    }
+    
+    char buffer[64];
+    
+    if (length >= sizeof(buffer)) {
+        NSString *string = [[NSString alloc] initWithBytes:bytes length:length encoding:NSASCIIStringEncoding];
+        
+        return [NSDecimalNumber decimalNumberWithString:string];
+    }
+    
+    memcpy(buffer, bytes, length);
+    buffer[length] = '\0';
+    
+    if (integral) {
+        errno = 0;
+        long long value = strtoll(buffer, NULL, 10);
+        
+        if (errno != ERANGE) {
+            return [NSNumber numberWithLongLong:value];
+        }
+        
+        if (buffer[0] != '-') {
+            errno = 0;
+            unsigned long long unsignedValue = strtoull(buffer, NULL, 10);
+            
+            if (errno != ERANGE) {
+                return [NSNumber numberWithUnsignedLongLong:unsignedValue];
+            }
+        }
+    }
+    
+    return [NSNumber numberWithDouble:strtod_l(buffer, NULL, NULL)];
+}
+
+
+#pragma mark - Walking the Index
+
++ (NSUInteger)offsetAfterWhitespaceWithTape:(MMSIMDJSONTape *)tape {
+    NSUInteger offset = tape->offset;
+    
+    while (offset < tape->length && MMSIMDJSONIsWhitespace(tape->bytes[offset])) {
+        offset++;
+    }
+    
+    return offset;
+}
+
+// Returns the next structural character if only whitespace comes before it, or zero otherwise.
++ (uint8_t)nextStructuralWithTape:(MMSIMDJSONTape *)tape {
+    if (tape->position >= tape->count ||
+        tape->offsets[tape->position] != [self offsetAfterWhitespaceWithTape:tape]) {
+        return 0;
+    }
+    
+    return tape->bytes[tape->offsets[tape->position]];
+}
+
++ (void)consumeStructuralWithTape:(MMSIMDJSONTape *)tape {
+    tape->offset = tape->offsets[tape->position] + 1;
+    tape->position++;
+}
+
++ (BOOL)isAtEndWithTape:(MMSIMDJSONTape *)tape {
+    return (tape->position == tape->count && [self offsetAfterWhitespaceWithTape:tape] == tape->length);
+}
+
+// Skips a value that the schema does not include by jumping over its entries in the index.  Skipped
+// values are checked for matching brackets, using one bit per level to remember whether each open
+// container is an object or an array, and the numbers and literals between their entries are checked
+// against the grammar without being decoded.
++ (BOOL)skipValueWithTape:(MMSIMDJSONTape *)tape {
+    NSUInteger offset = [self offsetAfterWhitespaceWithTape:tape];
+    
+    if (offset >= tape->length) {
+        return NO;
+    }
+    
+    uint8_t character = tape->bytes[offset];
+    
+    if (character != '{' && character != '[' && character != '"') {
+        return [self skipScalarWithTape:tape allowsEmpty:NO];
+    }
+    
+    if ([self nextStructuralWithTape:tape] != character) {
+        return NO;
+    }
+    
+    uint64_t objectLevels[MMSIMDJSONMaximumDepth / 64] = { 0 };
+    NSUInteger level = 0;
+    
+    while (tape->position < tape->count) {
+        if (level > 0 && [self skipScalarWithTape:tape allowsEmpty:YES] == NO) {
+            return NO;
+        }
+        
+        character = tape->bytes[tape->offsets[tape->position]];
+        
+        if (character == '"') {
+            if (tape->position + 1 >= tape->count) {
+                return NO;
+            }
+            
+            tape->position++;
+        } else if (character == '{' || character == '[') {
+            if (level >= MMSIMDJSONMaximumDepth) {
+                return NO;
+            }
+            
+            uint64_t bit = 1ULL << (level % 64);
+            
+            if (character == '{') {
+                objectLevels[level / 64] |= bit;
+            } else {
+                objectLevels[level / 64] &= ~bit;
+            }
+            
+            level++;
+        } else if (character == '}' || character == ']') {
+            if (level == 0) {
+                return NO;
+            }
+            
+            level--;
+            
+            BOOL closesObject = (objectLevels[level / 64] & (1ULL << (level % 64))) != 0;
+            
+            if (closesObject != (character == '}')) {
+                return NO;
+            }
+        }
+        
+        [self consumeStructuralWithTape:tape];
+        
+        if (level == 0) {
+            return YES;
+        }
+    }
+    
+    return NO;
+}
+
+// Skips the number or literal that runs from the current offset up to the next structural character.
+// Inside a container the gap between two structural characters may also be empty.
++ (BOOL)skipScalarWithTape:(MMSIMDJSONTape *)tape allowsEmpty:(BOOL)allowsEmpty {
+    NSUInteger offset = [self offsetAfterWhitespaceWithTape:tape];
+    NSUInteger end = (tape->position < tape->count) ? tape->offsets[tape->position] : tape->length;
+    
+    while (end > offset && MMSIMDJSONIsWhitespace(tape->bytes[end - 1])) {
+        end--;
+    }
+    
+    if (end <= offset) {
+        return allowsEmpty;
+    }
+    
+    if (MMSIMDJSONIsScalar(tape->bytes + offset, end - offset) == NO) {
+        tape->offset = offset;
+        return NO;
+    }
+    
+    tape->offset = end;
+    
+    return YES;
+}
+
+
+#pragma mark - Errors
+
++ (id)invalidDataWithTape:(MMSIMDJSONTape *)tape error:(NSError **)error {
+    if (error != NULL) {
+        NSUInteger offset = (tape != NULL) ? tape->offset : 0;
+        NSString *description = [NSString stringWithFormat:@"The JSON response is not valid around character %lu.", (unsigned long)offset];
+        
+        *error = [NSError errorWithDomain:NSCocoaErrorDomain
+                                     code:NSPropertyListReadCorruptError
+                                 userInfo:@{NSLocalizedDescriptionKey : description}];
+    }
+    
+    return nil;
+}
+
+@end